@@ -0,0 +1,44 @@
+# The base64 benchmark encodes 48MB of bytes and decodes the result
+# back, both in one call and a chunk at a time.
+
+import base64
+
+var block = bytes(0)
+iter var i = 0; i < 3072; i++ {
+  block.append((i * 73 + 11) % 256)
+}
+var data = bytes(0)
+iter var i = 0; i < 16 * 1024; i++ {
+  data.extend(block)
+}
+
+var start = time()
+var text = base64.encode(data)
+echo 'encode 48MB = ${time() - start}'
+
+start = time()
+var decoded = base64.decode(text)
+echo 'decode 48MB = ${time() - start}'
+echo decoded.length() == data.length()
+
+# 64KB at a time, as read from a file
+var chunk = 65536
+
+start = time()
+var encoder = base64.Encoder(), length = 0
+iter var i = 0; i < data.length(); i += chunk {
+  length += encoder.update(data[i, min(i + chunk, data.length())]).length()
+}
+length += encoder.finish().length()
+echo 'chunked encode 48MB = ${time() - start}'
+
+var input = text.to_bytes()
+start = time()
+var decoder = base64.Decoder()
+length = 0
+iter var i = 0; i < input.length(); i += chunk {
+  length += decoder.update(input[i, min(i + chunk, input.length())]).length()
+}
+length += decoder.finish().length()
+echo 'chunked decode 48MB = ${time() - start}'
+echo length == data.length()
@@ -0,0 +1,13 @@
+def make(a, b, c) {
+  return || { return a + b + c }
+}
+
+var start = time()
+var sum = 0
+iter var i = 0; i < 2000000; i++ {
+  var f = make(i, 1, 2)
+  sum += f()
+}
+
+echo sum
+echo 'Time taken = ${time() - start}'
@@ -0,0 +1,32 @@
+# Exercises the instruction sequences covered by the vm superinstructions:
+# adding two locals, comparing a local against a constant in a loop
+# condition, reading a field off a local and invoking a method on a local.
+# The correct result is 50000005000000.
+
+class Point {
+  Point(x, y) {
+    self.x = x
+    self.y = y
+  }
+}
+
+def run() {
+  var total = 0
+  var step = 1
+  var point = Point(1, 2)
+  var items = []
+
+  var i = 0
+  while i < 10000000 {
+    total = total + i
+    i = i + step
+    var x = point.x
+    if i < 100 items.append(x)
+  }
+
+  return total + i
+}
+
+var start = time()
+echo run()
+echo 'Time taken = ${time() - start}'
@@ -0,0 +1,31 @@
+# Tight numeric loops over locals and lists, the kind of code the
+# loop jit (blade -x) compiles to machine code.
+#
+# The correct result is 24999990000000 and 148933.
+
+def sum(n) {
+  var total = 0
+  iter var i = 0; i < n; i++ {
+    total += i * 2 - 1
+  }
+  return total
+}
+
+def sieve(n) {
+  var flags = [true] * (n + 1)
+  var count = 0
+  iter var i = 2; i <= n; i++ {
+    if flags[i] {
+      count++
+      iter var j = i * 2; j <= n; j += i {
+        flags[j] = false
+      }
+    }
+  }
+  return count
+}
+
+var start = time()
+echo sum(5000000)
+echo sieve(2000000)
+echo 'Time taken = ${time() - start}'
@@ -0,0 +1,40 @@
+# The sha benchmark hashes a 16MB string with sha1 and sha256, signs
+# 20000 short messages with hmac_sha256 and hashes 20000 short
+# messages one at a time and with sha256_many().
+
+import hash
+
+var block = ''
+iter var i = 0; i < 1024; i++ {
+  block += chr(i % 95 + 32)
+}
+var data = block * (16 * 1024)
+
+var start = time()
+hash.sha1(data)
+echo 'sha1 16MB = ${time() - start}'
+
+start = time()
+hash.sha256(data)
+echo 'sha256 16MB = ${time() - start}'
+
+var messages = []
+iter var i = 0; i < 20000; i++ {
+  messages.append('message number ${i}')
+}
+
+start = time()
+for message in messages {
+  hash.hmac_sha256(message, 'secret key')
+}
+echo 'hmac_sha256 x20000 = ${time() - start}'
+
+start = time()
+for message in messages {
+  hash.sha256(message)
+}
+echo 'sha256 x20000 = ${time() - start}'
+
+start = time()
+hash.sha256_many(messages)
+echo 'sha256_many x20000 = ${time() - start}'
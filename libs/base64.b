@@ -6,23 +6,181 @@
 #
 
 import _base64
+import io
+
+# the size of the chunks encode_file() and decode_file() read. a
+# multiple of three and four so that no chunk leaves input pending.
+var _file_chunk_size = 786432
 
 /**
- * encode(data: bytes)
+ * encode(data: bytes [, url_safe: bool])
  *
  * Encodes a bytes into a base64 string
+ *
+ * when url_safe is true, the URL and filename safe alphabet is used
+ * (- and _ instead of + and /)
  * @return string
  */
-def encode(data) {
-  return _base64.encode(data)
+def encode(data, url_safe) {
+  return _base64.encode(data, url_safe)
 }
 
 /**
- * decode(data: string)
+ * decode(data: string [, url_safe: bool])
  *
  * Decodes a base64 string into it's corresponding bytes
+ *
+ * when url_safe is true, the URL and filename safe alphabet is used
+ * and the padding at the end of the string may be left out.
  * @return bytes
  */
-def decode(data) {
-  return _base64.decode(data)
-}
\ No newline at end of file
+def decode(data, url_safe) {
+  return _base64.decode(data, url_safe)
+}
+
+/**
+ * @class Encoder
+ *
+ * encodes data to base64 a chunk at a time, so that large inputs such
+ * as files never have to be held in memory at once.
+ *
+ * @example
+ * var encoder = base64.Encoder()
+ * var result = encoder.update(part1) + encoder.update(part2) + encoder.finish()
+ */
+class Encoder {
+
+  # true when the URL and filename safe alphabet is used
+  var url_safe = false
+
+  # the bytes that do not yet make up a complete group of three
+  var _state
+
+  /**
+   * Encoder([url_safe: bool])
+   * @constructor
+   */
+  Encoder(url_safe) {
+    self.url_safe = url_safe == true
+    self._state = bytes(4)
+  }
+
+  /**
+   * update(data: string | bytes)
+   *
+   * encodes the next chunk of the input.
+   * @return string the base64 text for the complete groups so far
+   */
+  update(data) {
+    return _base64.encode_update(self._state, data, self.url_safe)
+  }
+
+  /**
+   * finish()
+   *
+   * encodes what is left of the input with its padding. the encoder
+   * can be used for a new input afterwards.
+   * @return string
+   */
+  finish() {
+    return _base64.encode_finish(self._state, self.url_safe)
+  }
+}
+
+/**
+ * @class Decoder
+ *
+ * decodes base64 text a chunk at a time. line breaks, spaces and
+ * padding in the input are skipped, so MIME bodies can be decoded as
+ * they are read.
+ *
+ * @example
+ * var decoder = base64.Decoder()
+ * var result = decoder.update(part1).extend(decoder.update(part2)).extend(decoder.finish())
+ */
+class Decoder {
+
+  # true when the URL and filename safe alphabet is used
+  var url_safe = false
+
+  # the characters that do not yet make up a complete group of four
+  var _state
+
+  /**
+   * Decoder([url_safe: bool])
+   * @constructor
+   */
+  Decoder(url_safe) {
+    self.url_safe = url_safe == true
+    self._state = bytes(4)
+  }
+
+  /**
+   * update(data: string | bytes)
+   *
+   * decodes the next chunk of the input.
+   * @return bytes the bytes of the complete groups so far
+   */
+  update(data) {
+    return _base64.decode_update(self._state, data, self.url_safe)
+  }
+
+  /**
+   * finish()
+   *
+   * decodes what is left of the input. the decoder can be used for a
+   * new input afterwards.
+   * @return bytes or nil if the input ended in the middle of a byte
+   */
+  finish() {
+    return _base64.decode_finish(self._state, self.url_safe)
+  }
+}
+
+# converts coder output to what a file in the given mode writes
+def _file_output(output, binary) {
+  if binary and is_string(output) return output.to_bytes()
+  if !binary and is_bytes(output) return output.to_string()
+  return output
+}
+
+# pipes source through a coder into destination a chunk at a time
+def _pipe_file(coder, source, destination) {
+  var binary = destination.mode().index_of('b') > -1
+
+  # writes to unbuffered files close them
+  destination.set_buffer(io.BUFFER_FULL)
+
+  while true {
+    var chunk = source.read(_file_chunk_size)
+    if !chunk break
+    destination.write(_file_output(coder.update(chunk), binary))
+  }
+
+  var tail = coder.finish()
+  if tail == nil die Exception('invalid base64 input')
+  destination.write(_file_output(tail, binary))
+  destination.close()
+}
+
+/**
+ * encode_file(source: file, destination: file [, url_safe: bool])
+ *
+ * writes the base64 encoding of the source file into the destination
+ * file without reading the whole source into memory. like
+ * file.write(), the destination is closed afterwards.
+ */
+def encode_file(source, destination, url_safe) {
+  _pipe_file(Encoder(url_safe), source, destination)
+}
+
+/**
+ * decode_file(source: file, destination: file [, url_safe: bool])
+ *
+ * writes the data decoded from the base64 source file into the
+ * destination file without reading the whole source into memory. like
+ * file.write(), the destination is closed afterwards.
+ */
+def decode_file(source, destination, url_safe) {
+  _pipe_file(Decoder(url_safe), source, destination)
+}
@@ -0,0 +1,370 @@
+#
+# @module event
+#
+# Provides a single threaded event loop that watches many sockets
+# at once and runs timers without a thread per connection.
+# Sockets are watched with epoll, so idle connections cost nothing
+# until they become ready.
+# @copyright 2021, Ore Richard Muyiwa
+#
+
+import _event {
+  IN,
+  OUT,
+  RDHUP,
+  ERR,
+  HUP,
+  ET,
+  ONESHOT,
+  CTL_ADD,
+  CTL_MOD,
+  CTL_DEL,
+
+  _create,
+  _ctl,
+  _wait,
+  _close,
+  _setblocking,
+  _error
+}
+import socket { Socket }
+
+# events that wake up a read callback
+var _readable = IN | RDHUP | HUP | ERR
+
+# events that wake up a write callback
+var _writable = OUT | HUP | ERR
+
+/**
+ * @class EventException
+ * exception class thrown from event loops
+ */
+class EventException < Exception {
+  EventException(message) {
+    self.message = message
+  }
+
+  @to_string() {
+    return '<EventException: ${self.message}>'
+  }
+}
+
+# returns the time in milliseconds used to schedule timers
+def _now() {
+  return microtime() / 1000
+}
+
+/**
+ * @class EventLoop
+ *
+ * runs callbacks when watched sockets become readable or writable
+ * and when timers expire.
+ *
+ * @example
+ * var loop = EventLoop()
+ * loop.watch(server, |s| {
+ *   loop.watch(s.accept(), |client| { ... })
+ * })
+ * loop.run()
+ */
+class EventLoop {
+
+  # the id of the epoll instance on the host machine
+  var id = -1
+
+  # true while run() is running
+  var is_running = false
+
+  # socket id -> [target, on_read, on_write]
+  var _watches
+
+  # min-heap of [due, sequence, callback, interval] ordered by due time
+  # and then by the order the timers were created.
+  # cleared timers have their callback set to nil.
+  var _timers
+
+  # timer id -> heap entry
+  var _timer_ids
+  var _sequence = 0
+
+  EventLoop() {
+    self._watches = {}
+    self._timers = []
+    self._timer_ids = {}
+    self.id = self._check_error(_create())
+  }
+
+  # returns a code if it is valid or throws an EventException otherwise
+  _check_error(code) {
+    if code == -1 die EventException(_error(code))
+    return code
+  }
+
+  # returns the socket id of a Socket or of a plain id
+  _socket_id(socket) {
+    if is_number(socket) return socket
+    if is_instance(socket, Socket) and socket.id >= 0 and !socket.is_closed
+      return socket.id
+    die EventException('socket or socket id expected')
+  }
+
+  /**
+   * watch(socket: Socket | number, on_read: function [, on_write: function [, edge: bool]])
+   *
+   * calls on_read(socket) whenever the socket has data to read (or has
+   * been closed by the peer) and on_write(socket) whenever it can be
+   * written to. either callback may be nil.
+   * - watching a socket again replaces its callbacks
+   * - when edge is true, callbacks only run when new data arrives and
+   * the socket is switched to non-blocking mode. the callback must then
+   * read until nothing is left.
+   */
+  watch(socket, on_read, on_write, edge) {
+    if on_read != nil and !is_function(on_read)
+      die EventException('function expected for on_read, ${typeof(on_read)} given')
+    if on_write != nil and !is_function(on_write)
+      die EventException('function expected for on_write, ${typeof(on_write)} given')
+    if on_read == nil and on_write == nil
+      die EventException('on_read or on_write callback required')
+    if self.id == -1 die EventException('event loop is closed')
+
+    var fd = self._socket_id(socket)
+    var events = 0
+    if on_read events |= IN | RDHUP
+    if on_write events |= OUT
+    if edge {
+      events |= ET
+      self._check_error(_setblocking(fd, false))
+    }
+
+    var op = self._watches.contains(fd) ? CTL_MOD : CTL_ADD
+    self._check_error(_ctl(self.id, op, fd, events))
+    self._watches[fd] = [socket, on_read, on_write]
+  }
+
+  /**
+   * unwatch(socket: Socket | number)
+   *
+   * stops watching a socket. this must be called before the socket
+   * is closed.
+   */
+  unwatch(socket) {
+    var fd = self._socket_id(socket)
+    if self._watches.contains(fd) {
+      self._watches.remove(fd)
+      # the socket may already be closed, which removes it from epoll
+      _ctl(self.id, CTL_DEL, fd, 0)
+      return true
+    }
+    return false
+  }
+
+  # adds a timer to the heap and returns its id
+  _add_timer(callback, delay, interval) {
+    if !is_function(callback)
+      die EventException('function expected for callback, ${typeof(callback)} given')
+    if !is_number(delay) or delay < 0
+      die EventException('non-negative number expected for delay')
+
+    self._sequence++
+    var timer = [_now() + delay, self._sequence, callback, interval ? delay : nil]
+    self._timer_ids[self._sequence] = timer
+    self._push_timer(timer)
+    return self._sequence
+  }
+
+  /**
+   * set_timeout(callback: function, delay: number)
+   *
+   * calls callback() once after delay milliseconds.
+   * @return number the id of the timer
+   */
+  set_timeout(callback, delay) {
+    return self._add_timer(callback, delay, false)
+  }
+
+  /**
+   * set_interval(callback: function, delay: number)
+   *
+   * calls callback() every delay milliseconds until the timer is cleared.
+   * @return number the id of the timer
+   */
+  set_interval(callback, delay) {
+    return self._add_timer(callback, delay, true)
+  }
+
+  /**
+   * clear_timer(id: number)
+   *
+   * cancels a timer created by set_timeout() or set_interval().
+   */
+  clear_timer(id) {
+    if self._timer_ids.contains(id) {
+      self._timer_ids[id][2] = nil
+      self._timer_ids.remove(id)
+      return true
+    }
+    return false
+  }
+
+  _timer_before(a, b) {
+    return a[0] < b[0] or (a[0] == b[0] and a[1] < b[1])
+  }
+
+  _push_timer(timer) {
+    var heap = self._timers
+    heap.append(timer)
+
+    var i = heap.length() - 1
+    while i > 0 {
+      var above = (i - 1) // 2
+      if !self._timer_before(heap[i], heap[above]) break
+      var swap = heap[i]
+      heap[i] = heap[above]
+      heap[above] = swap
+      i = above
+    }
+  }
+
+  _pop_timer() {
+    var heap = self._timers
+    var top = heap[0]
+    var last = heap.pop()
+
+    if heap.length() > 0 {
+      heap[0] = last
+      var i = 0, count = heap.length()
+      while true {
+        var smallest = i, left = 2 * i + 1, right = left + 1
+        if left < count and self._timer_before(heap[left], heap[smallest]) smallest = left
+        if right < count and self._timer_before(heap[right], heap[smallest]) smallest = right
+        if smallest == i break
+        var swap = heap[i]
+        heap[i] = heap[smallest]
+        heap[smallest] = swap
+        i = smallest
+      }
+    }
+    return top
+  }
+
+  # drops cleared timers from the top of the heap
+  _prune_timers() {
+    while self._timers.length() > 0 and self._timers[0][2] == nil
+      self._pop_timer()
+  }
+
+  # runs the timers that are due and returns how many ran
+  _run_timers() {
+    var ran = 0, now = _now()
+    self._prune_timers()
+
+    while self._timers.length() > 0 and self._timers[0][0] <= now {
+      var timer = self._pop_timer()
+      var callback = timer[2]
+
+      if timer[3] != nil {
+        # schedule from the original due time so intervals do not drift,
+        # but skip the ticks that were missed while the loop was busy
+        timer[0] += timer[3]
+        if timer[0] <= now timer[0] = now + timer[3]
+        self._push_timer(timer)
+      } else {
+        self._timer_ids.remove(timer[1])
+      }
+
+      callback()
+      ran++
+      self._prune_timers()
+    }
+    return ran
+  }
+
+  /**
+   * run_once([timeout: number])
+   *
+   * waits at most timeout milliseconds (forever if not given or -1) for
+   * sockets to become ready or the next timer to expire and runs the
+   * callbacks that are due.
+   * @return number the number of callbacks that ran
+   */
+  run_once(timeout) {
+    if timeout == nil timeout = -1
+    if !is_number(timeout)
+      die EventException('number expected for timeout, ${typeof(timeout)} given')
+    if self.id == -1 die EventException('event loop is closed')
+
+    self._prune_timers()
+    if self._timers.length() > 0 {
+      var wait = max(0, self._timers[0][0] - _now())
+      if timeout < 0 or wait < timeout timeout = wait
+    }
+
+    var ready = self._check_error(_wait(self.id, timeout))
+    var ran = 0
+
+    iter var i = 0; i < ready.length(); i += 2 {
+      var fd = ready[i], events = ready[i + 1]
+
+      # an earlier callback may have stopped watching the socket
+      if !self._watches.contains(fd) continue
+      var watch = self._watches[fd]
+
+      if watch[1] and (events & _readable) != 0 {
+        watch[1](watch[0])
+        ran++
+        if !self._watches.contains(fd) continue
+        watch = self._watches[fd]
+      }
+
+      if watch[2] and (events & _writable) != 0 {
+        watch[2](watch[0])
+        ran++
+      }
+    }
+
+    return ran + self._run_timers()
+  }
+
+  /**
+   * run()
+   *
+   * runs the loop until stop() is called or there are no sockets or
+   * timers left to wait for.
+   */
+  run() {
+    self.is_running = true
+    while self.is_running {
+      self._prune_timers()
+      if self._watches.length() == 0 and self._timers.length() == 0 break
+      self.run_once()
+    }
+    self.is_running = false
+  }
+
+  /**
+   * stop()
+   *
+   * stops run() after the callbacks that are already running.
+   */
+  stop() {
+    self.is_running = false
+  }
+
+  /**
+   * close()
+   *
+   * releases the event loop. watched sockets are not closed.
+   */
+  close() {
+    if self.id == -1 return false
+
+    self.stop()
+    _close(self.id)
+    self.id = -1
+    self._watches = {}
+    self._timers = []
+    self._timer_ids = {}
+    return true
+  }
+}
@@ -6,7 +6,6 @@
 #
 
 import _hash
-import convert
 
 /**
  * hash(value: any)
@@ -46,6 +45,19 @@ def crc32(str, value) {
   return _hash.crc32(str, value)
 }
 
+/**
+ * crc32c(str: string | bytes, [value: number])
+ * returns the crc32c (Castagnoli) value of the given string or bytes
+ * as used by iSCSI, ext4 and SCTP.
+ *
+ * if value is given, it is used as the base value of the crc32c
+ * computation. Else, 0 is used.
+ * @return number
+ */
+def crc32c(str, value) {
+  return _hash.crc32c(str, value)
+}
+
 /**
  * md2(str: string | bytes)
  * 
@@ -116,6 +128,18 @@ def sha256(str) {
   return _hash.sha256(str)
 }
 
+/**
+ * sha256_many(items: list)
+ *
+ * returns a list of the sha256 hashes of the strings or bytes in items.
+ * this is faster than calling sha256() for each item since several
+ * items can be hashed at once.
+ * @return list
+ */
+def sha256_many(items) {
+  return _hash.sha256_many(items)
+}
+
 /**
  * sha384(str: string | bytes)
  * 
@@ -209,6 +233,15 @@ def siphash(key, str) {
     die Exception('str must be string or bytes')
   }
 
+  if is_string(str) str = str.to_bytes()
+  return _hash.siphash(_siphash_key(key), str)
+}
+
+# pads a siphash key to the 16 bytes it must be
+def _siphash_key(key) {
+  if !is_string(key) and !is_bytes(key)
+    die Exception('key must be string or bytes')
+
   if key.length() > 16
     die Exception('key must be maximum of 16 characters/bytes long')
   else if key.length() < 16 {
@@ -217,9 +250,7 @@ def siphash(key, str) {
   }
 
   if is_string(key) key = key.to_bytes()
-  if is_string(str) str = str.to_bytes()
-
-  return _hash.siphash(key, str)
+  return key
 }
 
 /**
@@ -242,6 +273,14 @@ var _hmac_allowed = [
   gost 
 ]
 
+# the names the native hmac knows the methods above by
+var _hmac_names = [
+  'md2', 'md4', 'md5', 'sha1',
+  'sha224', 'sha256', 'sha384',
+  'sha512', 'whirlpool', 'snefru',
+  'gost'
+]
+
 /**
  * hmac(method: function, key: string | bytes, str: string | bytes)
  * 
@@ -249,38 +288,11 @@ var _hmac_allowed = [
  * @return string
  */
 def hmac(method, key, str) {
-  if !_hmac_allowed.contains(method)
+  var index = _hmac_allowed.index_of(method)
+  if index == -1
     die Exception('invalid HMAC method')
 
-  # convert key and str to array of bytes.
-  key = key.to_bytes()
-  str = str.to_bytes()
-
-  var BLOCK_SIZE = 64
-
-  # Keys longer than blockSize are shortened by hashing them
-  if key.length() > BLOCK_SIZE {
-    # key is outputSize bytes long
-    key = convert.hex_to_bytes(method(key))
-  }
-
-  # Keys shorter than blockSize are padded to blockSize by 
-  # padding with zeros on the right
-  iter var i = key.length(); i < BLOCK_SIZE; i++ key.append(0x00)
-
-  # Outer padded key
-  var outer = bytes(BLOCK_SIZE)
-  iter var i = 0; i < key.length(); i++ outer[i] = 0x5C ^ key[i]
-  iter var i = key.length(); i < BLOCK_SIZE; i++ outer[i] = 0x5C ^ 0x00
-
-  # Inner padded key
-  var inner = bytes(BLOCK_SIZE)
-  iter var i = 0; i < key.length(); i++ inner[i] = 0x36 ^ key[i]
-  iter var i = key.length(); i < BLOCK_SIZE; i++ inner[i] = 0x36 ^ 0x00
-
-  var inner_hash = convert.hex_to_bytes(method(inner.extend(str)))
-
-  return method(outer.extend(inner_hash))
+  return _hash.hmac_digest(_hmac_names[index], key, str)
 }
 
 /**
@@ -393,3 +405,440 @@ def hmac_gost(key, str) {
   return hmac(gost, key, str)
 }
 
+/**
+ * @class HashContext
+ *
+ * computes a hash of data that arrives in pieces, such as a stream or a
+ * file too large to hold in memory. the digest is the same as that of
+ * the matching hash function called with all of the data at once.
+ *
+ * @example
+ * var ctx = hash.sha256_ctx()
+ * ctx.update('hello, ')
+ * ctx.update('world')
+ * echo ctx.digest() # same as hash.sha256('hello, world')
+ */
+class HashContext {
+
+  # the name of the hash algorithm
+  var algorithm
+
+  # the state of the algorithm and the key it was created with
+  var _state
+  var _key
+
+  HashContext(algorithm, key) {
+    self.algorithm = algorithm
+    if key != nil {
+      self._key = _siphash_key(key)
+      self._state = _hash.new_context(algorithm, self._key)
+    } else {
+      self._state = _hash.new_context(algorithm)
+    }
+  }
+
+  /**
+   * update(data: string | bytes)
+   *
+   * adds data to the hash.
+   * @return HashContext
+   */
+  update(data) {
+    _hash.update_context(self._state, data)
+    return self
+  }
+
+  /**
+   * digest()
+   *
+   * returns the hash of all the data added so far. more data can still
+   * be added afterwards.
+   * @return string | number
+   */
+  digest() {
+    return _hash.context_digest(self._state)
+  }
+
+  /**
+   * copy()
+   *
+   * returns a new context with the same state, so that data with a
+   * common prefix only has to hash the prefix once.
+   * @return HashContext
+   */
+  copy() {
+    var ctx = HashContext(self.algorithm, self._key)
+    ctx._state = _hash.copy_context(self._state)
+    return ctx
+  }
+}
+
+/**
+ * adler32_ctx()
+ *
+ * returns a HashContext that computes the adler32 value of the data added to it
+ * @return HashContext
+ */
+def adler32_ctx() {
+  return HashContext('adler32', nil)
+}
+
+/**
+ * adler32_file(file: file)
+ *
+ * returns the adler32 value of the given file
+ * @return number
+ */
+def adler32_file(file) {
+  return _hash.file_digest('adler32', file)
+}
+
+/**
+ * crc32_ctx()
+ *
+ * returns a HashContext that computes the crc32 value of the data added to it
+ * @return HashContext
+ */
+def crc32_ctx() {
+  return HashContext('crc32', nil)
+}
+
+/**
+ * crc32_file(file: file)
+ *
+ * returns the crc32 value of the given file
+ * @return number
+ */
+def crc32_file(file) {
+  return _hash.file_digest('crc32', file)
+}
+
+/**
+ * crc32c_ctx()
+ *
+ * returns a HashContext that computes the crc32c value of the data added to it
+ * @return HashContext
+ */
+def crc32c_ctx() {
+  return HashContext('crc32c', nil)
+}
+
+/**
+ * crc32c_file(file: file)
+ *
+ * returns the crc32c value of the given file
+ * @return number
+ */
+def crc32c_file(file) {
+  return _hash.file_digest('crc32c', file)
+}
+
+/**
+ * md2_ctx()
+ *
+ * returns a HashContext that computes the md2 hash of the data added to it
+ * @return HashContext
+ */
+def md2_ctx() {
+  return HashContext('md2', nil)
+}
+
+/**
+ * md2_file(file: file)
+ *
+ * returns the md2 hash of the given file
+ * @return string
+ */
+def md2_file(file) {
+  return _hash.file_digest('md2', file)
+}
+
+/**
+ * md4_ctx()
+ *
+ * returns a HashContext that computes the md4 hash of the data added to it
+ * @return HashContext
+ */
+def md4_ctx() {
+  return HashContext('md4', nil)
+}
+
+/**
+ * md4_file(file: file)
+ *
+ * returns the md4 hash of the given file
+ * @return string
+ */
+def md4_file(file) {
+  return _hash.file_digest('md4', file)
+}
+
+/**
+ * md5_ctx()
+ *
+ * returns a HashContext that computes the md5 hash of the data added to it
+ * @return HashContext
+ */
+def md5_ctx() {
+  return HashContext('md5', nil)
+}
+
+/**
+ * sha1_ctx()
+ *
+ * returns a HashContext that computes the sha1 hash of the data added to it
+ * @return HashContext
+ */
+def sha1_ctx() {
+  return HashContext('sha1', nil)
+}
+
+/**
+ * sha1_file(file: file)
+ *
+ * returns the sha1 hash of the given file
+ * @return string
+ */
+def sha1_file(file) {
+  return _hash.file_digest('sha1', file)
+}
+
+/**
+ * sha224_ctx()
+ *
+ * returns a HashContext that computes the sha224 hash of the data added to it
+ * @return HashContext
+ */
+def sha224_ctx() {
+  return HashContext('sha224', nil)
+}
+
+/**
+ * sha224_file(file: file)
+ *
+ * returns the sha224 hash of the given file
+ * @return string
+ */
+def sha224_file(file) {
+  return _hash.file_digest('sha224', file)
+}
+
+/**
+ * sha256_ctx()
+ *
+ * returns a HashContext that computes the sha256 hash of the data added to it
+ * @return HashContext
+ */
+def sha256_ctx() {
+  return HashContext('sha256', nil)
+}
+
+/**
+ * sha256_file(file: file)
+ *
+ * returns the sha256 hash of the given file
+ * @return string
+ */
+def sha256_file(file) {
+  return _hash.file_digest('sha256', file)
+}
+
+/**
+ * sha384_ctx()
+ *
+ * returns a HashContext that computes the sha384 hash of the data added to it
+ * @return HashContext
+ */
+def sha384_ctx() {
+  return HashContext('sha384', nil)
+}
+
+/**
+ * sha384_file(file: file)
+ *
+ * returns the sha384 hash of the given file
+ * @return string
+ */
+def sha384_file(file) {
+  return _hash.file_digest('sha384', file)
+}
+
+/**
+ * sha512_ctx()
+ *
+ * returns a HashContext that computes the sha512 hash of the data added to it
+ * @return HashContext
+ */
+def sha512_ctx() {
+  return HashContext('sha512', nil)
+}
+
+/**
+ * sha512_file(file: file)
+ *
+ * returns the sha512 hash of the given file
+ * @return string
+ */
+def sha512_file(file) {
+  return _hash.file_digest('sha512', file)
+}
+
+/**
+ * fnv1_ctx()
+ *
+ * returns a HashContext that computes the 32 bit fnv1 hash of the data added to it
+ * @return HashContext
+ */
+def fnv1_ctx() {
+  return HashContext('fnv1', nil)
+}
+
+/**
+ * fnv1_file(file: file)
+ *
+ * returns the 32 bit fnv1 hash of the given file
+ * @return string
+ */
+def fnv1_file(file) {
+  return _hash.file_digest('fnv1', file)
+}
+
+/**
+ * fnv1_64_ctx()
+ *
+ * returns a HashContext that computes the 64 bit fnv1 hash of the data added to it
+ * @return HashContext
+ */
+def fnv1_64_ctx() {
+  return HashContext('fnv1_64', nil)
+}
+
+/**
+ * fnv1_64_file(file: file)
+ *
+ * returns the 64 bit fnv1 hash of the given file
+ * @return string
+ */
+def fnv1_64_file(file) {
+  return _hash.file_digest('fnv1_64', file)
+}
+
+/**
+ * fnv1a_ctx()
+ *
+ * returns a HashContext that computes the 32 bit fnv1a hash of the data added to it
+ * @return HashContext
+ */
+def fnv1a_ctx() {
+  return HashContext('fnv1a', nil)
+}
+
+/**
+ * fnv1a_file(file: file)
+ *
+ * returns the 32 bit fnv1a hash of the given file
+ * @return string
+ */
+def fnv1a_file(file) {
+  return _hash.file_digest('fnv1a', file)
+}
+
+/**
+ * fnv1a_64_ctx()
+ *
+ * returns a HashContext that computes the 64 bit fnv1a hash of the data added to it
+ * @return HashContext
+ */
+def fnv1a_64_ctx() {
+  return HashContext('fnv1a_64', nil)
+}
+
+/**
+ * fnv1a_64_file(file: file)
+ *
+ * returns the 64 bit fnv1a hash of the given file
+ * @return string
+ */
+def fnv1a_64_file(file) {
+  return _hash.file_digest('fnv1a_64', file)
+}
+
+/**
+ * whirlpool_ctx()
+ *
+ * returns a HashContext that computes the whirlpool hash of the data added to it
+ * @return HashContext
+ */
+def whirlpool_ctx() {
+  return HashContext('whirlpool', nil)
+}
+
+/**
+ * whirlpool_file(file: file)
+ *
+ * returns the whirlpool hash of the given file
+ * @return string
+ */
+def whirlpool_file(file) {
+  return _hash.file_digest('whirlpool', file)
+}
+
+/**
+ * snefru_ctx()
+ *
+ * returns a HashContext that computes the snefru hash of the data added to it
+ * @return HashContext
+ */
+def snefru_ctx() {
+  return HashContext('snefru', nil)
+}
+
+/**
+ * snefru_file(file: file)
+ *
+ * returns the snefru hash of the given file
+ * @return string
+ */
+def snefru_file(file) {
+  return _hash.file_digest('snefru', file)
+}
+
+/**
+ * gost_ctx()
+ *
+ * returns a HashContext that computes the gost hash of the data added to it
+ * @return HashContext
+ */
+def gost_ctx() {
+  return HashContext('gost', nil)
+}
+
+/**
+ * gost_file(file: file)
+ *
+ * returns the gost hash of the given file
+ * @return string
+ */
+def gost_file(file) {
+  return _hash.file_digest('gost', file)
+}
+
+/**
+ * siphash_ctx(key: string | bytes)
+ *
+ * returns a HashContext that computes the siphash of the data added to it
+ * @return HashContext
+ */
+def siphash_ctx(key) {
+  return HashContext('siphash', key)
+}
+
+/**
+ * siphash_file(key: string | bytes, file: file)
+ *
+ * returns the siphash of the given file
+ * @return string
+ */
+def siphash_file(key, file) {
+  return _hash.file_digest('siphash', file, _siphash_key(key))
+}
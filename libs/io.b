@@ -12,6 +12,16 @@ var SEEK_SET = 0
 var SEEK_CUR = 1
 var SEEK_END = 2
 
+ # for file mmap access hints
+var MMAP_NORMAL = 0
+var MMAP_RANDOM = 1
+var MMAP_SEQUENTIAL = 2
+
+ # for file write buffering
+var BUFFER_NONE = 0
+var BUFFER_LINE = 1
+var BUFFER_FULL = 2
+
 
 /**
  * @class TTY
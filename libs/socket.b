@@ -89,6 +89,11 @@ import _socket {
   SHUT_WR,
   SHUT_RDWR,
 
+  MSG_OOB,
+  MSG_PEEK,
+  MSG_WAITALL,
+  MSG_DONTWAIT,
+
   SOMAXCONN,
 
 
@@ -99,7 +104,9 @@ import _socket {
   _bind,
   _listen,
   _recv,
+  _recv_into,
   _send,
+  _sendfile,
   _setsockopt,
   _shutdown,
   _close,
@@ -107,9 +114,7 @@ import _socket {
   _getsockinfo,
   _getsockopt
 }
-import _os
-
-var _platform = _os.platform
+import _os { _platform }
 
 
 
@@ -245,7 +250,8 @@ class Socket {
   bind(host, port) {
     if !host host = self.host
 
-    if !port die SocketException('port not specified')
+    # port 0 lets the system pick a free port
+    if port == nil die SocketException('port not specified')
     if !is_string(host) 
       die SocketException('string expected for host, ${typeof(host)} given')
     if !is_int(port) 
@@ -286,15 +292,39 @@ class Socket {
     return self._check_error(_send(self.id, message, flags))
   }
 
-  receive(length, flags) {
-    if !length length = -1
-    if !flags flags = 0
+  /**
+   * send_file(file: file [, offset: number [, count: number]])
+   *
+   * sends count bytes of file starting at offset (or the rest of the file
+   * when count is not given) without reading it into memory. pipes are
+   * streamed until they are closed and ignore the offset.
+   * - returns the number of bytes sent, which may be less than count
+   * for non-blocking sockets. send the rest when the socket is writable.
+   */
+  send_file(file, offset, count) {
+    if !offset offset = 0
+    if count == nil count = -1
 
-    if !is_int(length) 
-      die SocketException('integer expected for length, ${typeof(length)} given')
-    if !is_int(flags) 
-      die SocketException('integer expected for flags, ${typeof(flags)} given')
+    if !is_file(file)
+      die SocketException('file expected, ${typeof(file)} given')
+    if !is_int(offset) or offset < 0
+      die SocketException('non-negative integer expected for offset')
+    if !is_int(count)
+      die SocketException('integer expected for count, ${typeof(count)} given')
+
+    if self.id == -1 or self.is_closed or (self.is_shutdown and 
+      (self.shutdown_reason == SHUT_WR or 
+        self.shutdown_reason == SHUT_RDWR)) 
+      die SocketException('socket is in an illegal state')
+
+    if !self.is_listening and !self.is_connected
+      die SocketException('socket not listening or connected')
+
+    return self._check_error(_sendfile(self.id, file, offset, count))
+  }
 
+  # validates the socket can be read from
+  _check_readable() {
     if self.id == -1 or self.is_closed or (self.is_shutdown and 
       (self.shutdown_reason == SHUT_RD or 
         self.shutdown_reason == SHUT_RDWR)) 
@@ -302,13 +332,80 @@ class Socket {
 
     if !self.is_listening and !self.is_connected
       die SocketException('socket not listening or connected')
+  }
+
+  receive(length, flags) {
+    if !length length = -1
+    if !flags flags = 0
+
+    if !is_int(length) 
+      die SocketException('integer expected for length, ${typeof(length)} given')
+    if !is_int(flags) 
+      die SocketException('integer expected for flags, ${typeof(flags)} given')
+
+    self._check_readable()
     
-    var result = _recv(self.id, length, flags)
+    var result = _recv(self.id, length, flags, false)
     if is_string(result) or result == nil return result
 
     return self._check_error(result)
   }
 
+  /**
+   * receive_bytes([length: number [, flags: number]])
+   *
+   * same as receive(), but returns the data as bytes so binary data is
+   * not converted to a string.
+   * - with MSG_WAITALL in flags, waits until length bytes have been
+   * received or the peer stops sending.
+   */
+  receive_bytes(length, flags) {
+    if !length length = -1
+    if !flags flags = 0
+
+    if !is_int(length) 
+      die SocketException('integer expected for length, ${typeof(length)} given')
+    if !is_int(flags) 
+      die SocketException('integer expected for flags, ${typeof(flags)} given')
+
+    self._check_readable()
+
+    var result = _recv(self.id, length, flags, true)
+    if is_bytes(result) or result == nil return result
+
+    return self._check_error(result)
+  }
+
+  /**
+   * receive_into(buffer: bytes [, offset: number [, length: number [, flags: number]]])
+   *
+   * reads at most length bytes (or up to the end of buffer) into buffer
+   * starting at offset so that the same buffer can be reused for every
+   * read without allocating.
+   * - with MSG_WAITALL in flags, waits until length bytes have been
+   * received or the peer stops sending.
+   * - returns the number of bytes read or 0 when the peer has closed
+   * the connection.
+   */
+  receive_into(buffer, offset, length, flags) {
+    if !offset offset = 0
+    if length == nil length = -1
+    if !flags flags = 0
+
+    if !is_bytes(buffer) 
+      die SocketException('bytes expected for buffer, ${typeof(buffer)} given')
+    if !is_int(offset) 
+      die SocketException('integer expected for offset, ${typeof(offset)} given')
+    if !is_int(length) 
+      die SocketException('integer expected for length, ${typeof(length)} given')
+    if !is_int(flags) 
+      die SocketException('integer expected for flags, ${typeof(flags)} given')
+
+    self._check_readable()
+
+    return self._check_error(_recv_into(self.id, buffer, offset, length, flags))
+  }
+
   listen(queue_length) {
     if !queue_length queue_length = SOMAXCONN # default to 128 simulataneous clients...
 
@@ -6,6 +6,7 @@
 #else
 #include "blade_unistd.h"
 #endif /* ifdef HAVE_UNISTD_H */
+#include "jit.h"
 #include "module.h"
 
 #include <stdio.h>
@@ -199,6 +200,10 @@ static void run_file(b_vm *vm, const char *file) {
 
   fflush(stdout);
 
+  if (vm->op_profile != NULL) {
+    print_op_profile(vm->op_profile);
+  }
+
   if (result == PTR_COMPILE_ERR)
     exit(EXIT_COMPILE);
   if (result == PTR_RUNTIME_ERR)
@@ -206,13 +211,18 @@ static void run_file(b_vm *vm, const char *file) {
 }
 
 void show_usage(char *argv[], bool fail) {
-  fprintf(stderr, "Usage: %s [-[h | d | j | v | g]] [filename]\n", argv[0]);
+  fprintf(stderr, "Usage: %s [-[h | d | j | p | r | x | v | g]] [filename]\n", argv[0]);
   fprintf(stderr, "   -h    Show this help message.\n");
   fprintf(stderr, "   -v    Show version string.\n");
   fprintf(stderr, "   -b    Buffer terminal outputs.\n");
   fprintf(stderr, "         [This will cause the output to be buffered with 1kb]\n");
   fprintf(stderr, "   -d    Show generated bytecode.\n");
   fprintf(stderr, "   -j    Show stack objects during execution.\n");
+  fprintf(stderr, "   -p    Count the opcode pairs and triples executed and show\n"
+                  "         the most frequent ones on exit.\n");
+  fprintf(stderr, "   -f    Fuse local assignments into register-style instructions\n"
+                  "         that operate on frame slots directly.\n");
+  fprintf(stderr, "   -x    Compile the loops of hot functions to machine code.\n");
   fprintf(stderr, "   -g    Sets the minimum heap size in kilobytes before the GC\n"
                   "         can start. [Default = %d (%dmb)]\n", DEFAULT_GC_START / 1024,
           DEFAULT_GC_START / (1024 * 1024));
@@ -224,11 +234,14 @@ int main(int argc, char *argv[]) {
   bool should_debug_stack = false;
   bool should_print_bytecode = false;
   bool should_buffer_stdout = false;
+  bool should_profile_ops = false;
+  bool use_fused_locals = false;
+  bool use_jit = false;
   int next_gc_start = DEFAULT_GC_START;
 
   if (argc > 1) {
     int opt;
-    while ((opt = getopt(argc, argv, "hdbjvg:")) != -1) {
+    while ((opt = getopt(argc, argv, "hdbjpfxvg:")) != -1) {
       switch (opt) {
         case 'h': {
           show_usage(argv, false);
@@ -243,6 +256,15 @@ int main(int argc, char *argv[]) {
         case 'j':
           should_debug_stack = true;
           break;
+        case 'p':
+          should_profile_ops = true;
+          break;
+        case 'f':
+          use_fused_locals = true;
+          break;
+        case 'x':
+          use_jit = true;
+          break;
         case 'v': {
           printf("Blade " BLADE_VERSION_STRING " (running on BladeVM " BVM_VERSION ")\n");
           return EXIT_SUCCESS;
@@ -270,7 +292,12 @@ int main(int argc, char *argv[]) {
     // set vm options...
     vm->should_debug_stack = should_debug_stack;
     vm->should_print_bytecode = should_print_bytecode;
+    vm->use_fused_locals = use_fused_locals;
+    vm->use_jit = use_jit && jit_is_supported();
     vm->next_gc = next_gc_start;
+    if (should_profile_ops) {
+      vm->op_profile = new_op_profile();
+    }
 
     if (should_buffer_stdout) {
       // forcing printf buffering for TTYs and terminals
@@ -11,6 +11,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <limits.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif /* ifdef HAVE_SYS_MMAN_H */
+
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif /* ifdef HAVE_SYS_UIO_H */
 
 #ifdef _MSC_VER
 #include <sys/utime.h>
@@ -48,9 +57,218 @@
 
 #define SET_DICT_STRING(d, n, l, v) dict_add_entry(vm, d, GC_L_STRING(n, l), v)
 
+#define PREPARE_READ()                                                         \
+  if (!is_std_file(file)) {                                                    \
+    /* file is in read mode and file does not exist */                         \
+    if (strstr(file->mode->chars, "r") != NULL &&                              \
+        !file_exists(file->path->chars)) {                                     \
+      FILE_ERROR(NotFound, "no such file or directory");                       \
+    }                                                                          \
+    /* file is in write only mode */                                           \
+    else if (strstr(file->mode->chars, "w") != NULL &&                         \
+             strstr(file->mode->chars, "+") == NULL) {                         \
+      FILE_ERROR(Unsupported, "cannot read file in write mode");               \
+    }                                                                          \
+                                                                               \
+    if (!file->is_open) { /* open the file if it isn't open */                 \
+      file_open(file);                                                         \
+    }                                                                          \
+                                                                               \
+    if (file->file == NULL) {                                                  \
+      FILE_ERROR(Read, "could not read file");                                 \
+    }                                                                          \
+  } else if (fileno(stdout) == fileno(file->file) ||                           \
+             fileno(stderr) == fileno(file->file)) {                           \
+    /* stdout should not read */                                               \
+    FILE_ERROR(Unsupported, "cannot read from output file");                   \
+  }
+
+#define PREPARE_WRITE()                                                        \
+  if (!is_std_file(file)) {                                                    \
+    /* file is in read only mode */                                            \
+    if (strstr(file->mode->chars, "r") != NULL &&                              \
+        strstr(file->mode->chars, "+") == NULL) {                              \
+      FILE_ERROR(Unsupported, "cannot write file in read mode");               \
+    }                                                                          \
+                                                                               \
+    if (!file->is_open) { /* open the file if it isn't open */                 \
+      file_open(file);                                                         \
+    }                                                                          \
+                                                                               \
+    if (file->file == NULL) {                                                  \
+      FILE_ERROR(Write, "could not write to file");                            \
+    }                                                                          \
+                                                                               \
+    file_sync(file);                                                           \
+  } else if (fileno(stdin) == fileno(file->file)) {                            \
+    /* stdin should not write */                                               \
+    FILE_ERROR(Unsupported, "cannot write to input file");                     \
+  }
+
+#define RETURN_READ(data, length)                                              \
+  if (strstr(file->mode->chars, "b") == NULL) {                                \
+    RETURN_T_STRING(data, length);                                             \
+  }                                                                            \
+  RETURN_OBJ(take_bytes(vm, (unsigned char *) (data), length));
+
 bool is_std_file(b_obj_file *file) { return file->mode->length == 0; }
 
+/**
+ * drops the bytes read ahead of the reader, moving the stream back over
+ * them so that writes, seeks and full reads start where it stopped.
+ */
+static void file_sync(b_obj_file *file) {
+  size_t pending = file->buffer_end - file->buffer_start;
+  if (pending > 0 && file->file != NULL && !is_std_file(file)) {
+    fseek(file->file, -(long) pending, SEEK_CUR);
+  }
+  file->buffer_start = file->buffer_end = 0;
+}
+
+/**
+ * refills the read ahead buffer and returns false at the end of the file.
+ * std files are filled a line at a time so that nothing past the line is
+ * taken from other readers of the stream.
+ */
+static bool file_fill(b_vm *vm, b_obj_file *file) {
+  if (file->buffer == NULL) {
+    file->buffer = ALLOCATE(char, FILE_READ_BUFFER_SIZE);
+  }
+
+  file->buffer_start = 0;
+  if (is_std_file(file)) {
+    if (fgets(file->buffer, FILE_READ_BUFFER_SIZE, file->file) != NULL) {
+      file->buffer_end = strlen(file->buffer);
+    } else {
+      file->buffer_end = 0;
+    }
+  } else {
+    file->buffer_end =
+        fread(file->buffer, sizeof(char), FILE_READ_BUFFER_SIZE, file->file);
+  }
+  return file->buffer_end > 0;
+}
+
+/**
+ * reads up to the next newline, leaving out the newline and a carriage
+ * return before it. returns NULL at the end of the file.
+ */
+static char *file_read_line(b_vm *vm, b_obj_file *file, size_t *length) {
+  char *line = NULL;
+  size_t count = 0, capacity = 0;
+
+  for (;;) {
+    if (file->buffer_start == file->buffer_end && !file_fill(vm, file)) {
+      if (line == NULL)
+        return NULL;
+      break;
+    }
+
+    char *start = file->buffer + file->buffer_start;
+    size_t available = file->buffer_end - file->buffer_start;
+    char *newline = memchr(start, '\n', available);
+    size_t take = newline != NULL ? (size_t) (newline - start) : available;
+
+    if (count + take + 1 > capacity) {
+      size_t old_capacity = capacity;
+      capacity = count + take + 1;
+      line = GROW_ARRAY(char, line, old_capacity, capacity);
+    }
+
+    memcpy(line + count, start, take);
+    count += take;
+    file->buffer_start += take;
+
+    if (newline != NULL) {
+      file->buffer_start++; // skip the newline
+      break;
+    }
+  }
+
+  if (count > 0 && line[count - 1] == '\r') {
+    line = GROW_ARRAY(char, line, capacity, count);
+    capacity = count--;
+  }
+
+  line[count] = '\0';
+  *length = count;
+  return line;
+}
+
+/**
+ * reads up to length bytes, serving them from the read ahead buffer
+ * first. reads of a buffer or more go straight to the stream.
+ * returns NULL at the end of the file.
+ */
+static char *file_read_chunk(b_vm *vm, b_obj_file *file, size_t length,
+                             size_t *count) {
+  // never allocate more than a regular file has left
+  struct stat stats;
+  if (fstat(fileno(file->file), &stats) == 0 && S_ISREG(stats.st_mode)) {
+    long position = ftell(file->file);
+    if (position >= 0) {
+      size_t left = file->buffer_end - file->buffer_start;
+      if (stats.st_size > position) {
+        left += (size_t) (stats.st_size - position);
+      }
+      if (left == 0 && length > 0)
+        return NULL;
+      if (length > left)
+        length = left;
+    }
+  }
+
+  char *chunk = ALLOCATE(char, length + 1);
+  size_t total = 0;
+
+  while (total < length) {
+    if (file->buffer_start == file->buffer_end) {
+      if (length - total >= FILE_READ_BUFFER_SIZE) {
+        total += fread(chunk + total, sizeof(char), length - total, file->file);
+        break;
+      }
+      if (!file_fill(vm, file))
+        break;
+    }
+
+    size_t take = file->buffer_end - file->buffer_start;
+    if (take > length - total) {
+      take = length - total;
+    }
+
+    memcpy(chunk + total, file->buffer + file->buffer_start, take);
+    file->buffer_start += take;
+    total += take;
+  }
+
+  if (total == 0 && length > 0) {
+    FREE_ARRAY(char, chunk, length + 1);
+    return NULL;
+  }
+
+  if (total < length) {
+    chunk = GROW_ARRAY(char, chunk, length + 1, total + 1);
+  }
+
+  chunk[total] = '\0';
+  *count = total;
+  return chunk;
+}
+
+/**
+ * hands the buffer chosen with set_buffer() to the stream.
+ */
+static void file_set_buffer(b_obj_file *file) {
+  if (file->file == NULL || file->buffer_mode == -1)
+    return;
+
+  static const int modes[] = {_IONBF, _IOLBF, _IOFBF};
+  setvbuf(file->file, file->write_buffer, modes[file->buffer_mode],
+          file->write_buffer_size);
+}
+
 static void file_close(b_obj_file *file) {
+  file->buffer_start = file->buffer_end = 0;
   if (file->file != NULL && !is_std_file(file)) {
     fflush(file->file);
     fclose(file->file);
@@ -68,6 +286,34 @@ static void file_open(b_obj_file *file) {
     }
     file->file = fopen(file->path->chars, mode);
     file->is_open = true;
+    file_set_buffer(file);
+  }
+}
+
+/**
+ * closes and reopens the stream where it was so that a new buffer can
+ * be set before the stream is used again, as setvbuf() requires.
+ * a file being written is reopened for update to keep what it holds.
+ */
+static void file_reopen(b_obj_file *file) {
+  long position = ftell(file->file);
+  fclose(file->file);
+
+  char mode[4] = "r+";
+  if (strstr(file->mode->chars, "w") == NULL) {
+    strncpy(mode, file->mode->chars, sizeof(mode) - 1);
+  } else if (strstr(file->mode->chars, "+") != NULL) {
+    strcpy(mode, "a+");
+  }
+  if (strstr(file->mode->chars, "b") != NULL && strstr(mode, "b") == NULL) {
+    strcat(mode, "b");
+  }
+
+  file->file = fopen(file->path->chars, mode);
+  file->is_open = file->file != NULL;
+  file_set_buffer(file);
+  if (file->file != NULL && position > 0) {
+    fseek(file->file, position, SEEK_SET);
   }
 }
 
@@ -134,28 +380,23 @@ DECLARE_FILE_METHOD(read) {
   }
 
   b_obj_file *file = AS_FILE(METHOD_OBJECT);
+  PREPARE_READ();
 
   bool in_binary_mode = strstr(file->mode->chars, "b") != NULL;
 
   if (!is_std_file(file)) {
-    // file is in read mode and file does not exist
-    if (strstr(file->mode->chars, "r") != NULL &&
-        !file_exists(file->path->chars)) {
-      FILE_ERROR(NotFound, "no such file or directory");
-    }
-    // file is in write only mode
-    else if (strstr(file->mode->chars, "w") != NULL &&
-             strstr(file->mode->chars, "+") == NULL) {
-      FILE_ERROR(Unsupported, "cannot read file in write mode");
-    }
-
-    if (!file->is_open) { // open the file if it isn't open
-      file_open(file);
+    // chunked reads keep the file open and carry on from where they stopped
+    if (arg_count == 1) {
+      size_t count;
+      char *chunk = file_read_chunk(vm, file, file_size, &count);
+      if (chunk == NULL) {
+        RETURN;
+      }
+      RETURN_READ(chunk, count);
     }
 
-    if (file->file == NULL) {
-      FILE_ERROR(Read, "could not read file");
-    }
+    file_sync(file);
+    long position = ftell(file->file);
 
     // Get file size
     struct stat stats; // stats is super faster on large files
@@ -165,19 +406,16 @@ DECLARE_FILE_METHOD(read) {
       // fallback
       fseek(file->file, 0L, SEEK_END);
       file_size_real = ftell(file->file);
-      rewind(file->file);
+      fseek(file->file, position, SEEK_SET);
     }
 
-    if (file_size == (size_t) -1 || file_size > file_size_real) {
-      file_size = file_size_real;
+    // read whatever is left from the current position
+    if (position > 0) {
+      file_size_real = (size_t) position < file_size_real
+                       ? file_size_real - (size_t) position : 0;
     }
+    file_size = file_size_real;
   } else {
-    // stdout should not read
-    if (fileno(stdout) == fileno(file->file) ||
-        fileno(stderr) == fileno(file->file)) {
-      FILE_ERROR(Unsupported, "cannot read from output file");
-    }
-
     // for non-file objects such as stdin
     // minimum read bytes should be 1
     if (file_size == (size_t) -1) {
@@ -214,6 +452,105 @@ DECLARE_FILE_METHOD(read) {
   RETURN_OBJ(take_bytes(vm, (unsigned char *) buffer, bytes_read));
 }
 
+DECLARE_FILE_METHOD(read_line) {
+  ENFORCE_ARG_COUNT(read_line, 0);
+  b_obj_file *file = AS_FILE(METHOD_OBJECT);
+  PREPARE_READ();
+
+  size_t length;
+  char *line = file_read_line(vm, file, &length);
+  if (line == NULL) {
+    RETURN;
+  }
+  RETURN_READ(line, length);
+}
+
+DECLARE_FILE_METHOD(mmap) {
+  ENFORCE_ARG_RANGE(mmap, 0, 1);
+  int access = 0;
+  if (arg_count == 1) {
+    ENFORCE_ARG_TYPE(mmap, 0, IS_NUMBER);
+    access = AS_NUMBER(args[0]);
+  }
+
+  b_obj_file *file = AS_FILE(METHOD_OBJECT);
+  DENY_STD();
+
+#ifdef HAVE_SYS_MMAN_H
+  PREPARE_READ();
+
+  struct stat stats;
+  if (fstat(fileno(file->file), &stats) != 0) {
+    FILE_ERROR(Read, strerror(errno));
+  }
+
+  // bytes are int indexed
+  if (stats.st_size > INT_MAX) {
+    FILE_ERROR(Buffer, "file too large to map");
+  }
+
+  int length = (int) stats.st_size;
+  if (length == 0) {
+    RETURN_OBJ(new_bytes(vm, 0));
+  }
+
+  void *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fileno(file->file), 0);
+  if (data == MAP_FAILED) {
+    FILE_ERROR(Read, strerror(errno));
+  }
+
+  switch (access) {
+    case 1: madvise(data, length, MADV_RANDOM); break;
+    case 2: madvise(data, length, MADV_SEQUENTIAL); break;
+    default: break;
+  }
+
+  RETURN_OBJ(new_mapped_bytes(vm, (unsigned char *) data, length));
+#else
+  RETURN_ERROR("not available: OS does not support mmap");
+#endif /* ifdef HAVE_SYS_MMAN_H */
+}
+
+void flush_file(b_obj_file *file) {
+  if (file->file != NULL && !is_std_file(file)) {
+    file_sync(file);
+    fflush(file->file);
+  }
+}
+
+void unmap_bytes(b_obj_bytes *bytes) {
+#ifdef HAVE_SYS_MMAN_H
+  munmap(bytes->bytes.bytes, bytes->bytes.count);
+#endif /* ifdef HAVE_SYS_MMAN_H */
+}
+
+DECLARE_FILE_METHOD(__iter__) {
+  ENFORCE_ARG_COUNT(__iter__, 1);
+  RETURN_VALUE(AS_FILE(METHOD_OBJECT)->line);
+}
+
+DECLARE_FILE_METHOD(__itern__) {
+  ENFORCE_ARG_COUNT(__itern__, 1);
+  b_obj_file *file = AS_FILE(METHOD_OBJECT);
+  PREPARE_READ();
+
+  size_t length;
+  char *line = file_read_line(vm, file, &length);
+  if (line == NULL) {
+    file->line = NIL_VAL;
+    RETURN_FALSE;
+  }
+
+  if (strstr(file->mode->chars, "b") == NULL) {
+    file->line = OBJ_VAL(take_string(vm, line, (int) length));
+  } else {
+    file->line = OBJ_VAL(take_bytes(vm, (unsigned char *) line, (int) length));
+  }
+
+  // the key is the number of the line, counting from zero
+  RETURN_NUMBER(IS_NIL(args[0]) ? 0 : AS_NUMBER(args[0]) + 1);
+}
+
 DECLARE_FILE_METHOD(write) {
   ENFORCE_ARG_COUNT(write, 1);
 
@@ -231,29 +568,16 @@ DECLARE_FILE_METHOD(write) {
     bytes = AS_BYTES(args[0]);
   }
 
-  // file is in read only mode
-  if (!is_std_file(file)) {
-    if (strstr(file->mode->chars, "r") != NULL &&
-        strstr(file->mode->chars, "+") == NULL) {
-      FILE_ERROR(Unsupported, "cannot read file in write mode");
-    }
-
-    if ((!in_binary_mode ? string->length : bytes->bytes.count) == 0) {
-      FILE_ERROR(Write, "cannot write empty buffer to file");
-    }
-
-    if (!file->is_open) { // open the file if it isn't open
-      file_open(file);
-    }
+  PREPARE_WRITE();
 
-    if (file->file == NULL) {
-      FILE_ERROR(Write, "could not write to file");
-    }
-  } else {
-    // stdin should not write
-    if (fileno(stdin) == fileno(file->file)) {
-      FILE_ERROR(Unsupported, "cannot write to input file");
+  size_t length = !in_binary_mode ? (size_t) string->length
+                                  : (size_t) bytes->bytes.count;
+  if (length == 0) {
+    // an empty write still ends the write like any other
+    if (file->buffer_mode == -1) {
+      file_close(file);
     }
+    RETURN_TRUE;
   }
 
   size_t count;
@@ -265,9 +589,8 @@ DECLARE_FILE_METHOD(write) {
                    bytes->bytes.count, file->file);
   }
 
-  // close file
-  if (count ==
-      (size_t) (in_binary_mode ? bytes->bytes.count : string->length)) {
+  // close file unless the writes are being buffered
+  if (count == length && file->buffer_mode == -1) {
     file_close(file);
   }
 
@@ -277,6 +600,141 @@ DECLARE_FILE_METHOD(write) {
   RETURN_FALSE;
 }
 
+DECLARE_FILE_METHOD(write_all) {
+  ENFORCE_ARG_COUNT(write_all, 1);
+  ENFORCE_ARG_TYPE(write_all, 0, IS_LIST);
+
+  b_obj_file *file = AS_FILE(METHOD_OBJECT);
+  b_obj_list *list = AS_LIST(args[0]);
+  bool in_binary_mode = strstr(file->mode->chars, "b") != NULL;
+
+  size_t length = 0;
+  for (int i = 0; i < list->items.count; i++) {
+    b_value item = list->items.values[i];
+    if (!in_binary_mode && IS_STRING(item)) {
+      length += AS_STRING(item)->length;
+    } else if (in_binary_mode && IS_BYTES(item)) {
+      length += AS_BYTES(item)->bytes.count;
+    } else {
+      RETURN_ERROR("write_all() expects a list of %s", in_binary_mode ? "bytes" : "strings");
+    }
+  }
+
+  PREPARE_WRITE();
+
+  size_t count = 0;
+
+#ifdef HAVE_SYS_UIO_H
+  // anything already buffered must reach the file first
+  fflush(file->file);
+
+  struct iovec batch[FILE_WRITE_BATCH_SIZE];
+  int fd = fileno(file->file);
+
+  for (int i = 0; i < list->items.count;) {
+    int batch_count = 0;
+    for (; i < list->items.count && batch_count < FILE_WRITE_BATCH_SIZE; i++) {
+      b_value item = list->items.values[i];
+      struct iovec *vec = &batch[batch_count];
+      if (!in_binary_mode) {
+        vec->iov_base = AS_STRING(item)->chars;
+        vec->iov_len = AS_STRING(item)->length;
+      } else {
+        vec->iov_base = AS_BYTES(item)->bytes.bytes;
+        vec->iov_len = AS_BYTES(item)->bytes.count;
+      }
+      if (vec->iov_len > 0) {
+        batch_count++;
+      }
+    }
+
+    // writev may stop short, so carry on from where it stopped
+    struct iovec *vec = batch;
+    while (batch_count > 0) {
+      ssize_t written = writev(fd, vec, batch_count);
+      if (written < 0) {
+        if (errno == EINTR)
+          continue;
+        FILE_ERROR(Write, strerror(errno));
+      }
+
+      count += (size_t) written;
+      while (batch_count > 0 && (size_t) written >= vec->iov_len) {
+        written -= (ssize_t) vec->iov_len;
+        vec++;
+        batch_count--;
+      }
+      if (batch_count > 0) {
+        vec->iov_base = (char *) vec->iov_base + written;
+        vec->iov_len -= (size_t) written;
+      }
+    }
+  }
+#else
+  for (int i = 0; i < list->items.count; i++) {
+    b_value item = list->items.values[i];
+    if (!in_binary_mode) {
+      count += fwrite(AS_STRING(item)->chars, sizeof(char),
+                      AS_STRING(item)->length, file->file);
+    } else {
+      count += fwrite(AS_BYTES(item)->bytes.bytes, sizeof(unsigned char),
+                      AS_BYTES(item)->bytes.count, file->file);
+    }
+  }
+#endif /* ifdef HAVE_SYS_UIO_H */
+
+  // close file unless the writes are being buffered
+  if (count == length && file->buffer_mode == -1) {
+    file_close(file);
+  }
+
+  RETURN_BOOL(count == length);
+}
+
+DECLARE_FILE_METHOD(set_buffer) {
+  ENFORCE_ARG_RANGE(set_buffer, 1, 2);
+  ENFORCE_ARG_TYPE(set_buffer, 0, IS_NUMBER);
+
+  int policy = AS_NUMBER(args[0]);
+  if (policy < 0 || policy > 2) {
+    RETURN_ERROR("invalid buffer policy %d", policy);
+  }
+
+  size_t size = FILE_WRITE_BUFFER_SIZE;
+  if (arg_count == 2) {
+    ENFORCE_ARG_TYPE(set_buffer, 1, IS_NUMBER);
+    if (AS_NUMBER(args[1]) < 1) {
+      RETURN_ERROR("buffer size must be greater than zero");
+    }
+    size = (size_t) AS_NUMBER(args[1]);
+  }
+
+  b_obj_file *file = AS_FILE(METHOD_OBJECT);
+  if (file->file != NULL) {
+    file_sync(file);
+    fflush(file->file);
+  }
+
+  // the old buffer may still be in use by the stream until it is replaced
+  char *old_buffer = file->write_buffer;
+  size_t old_size = file->write_buffer_size;
+
+  // standard streams outlive the file object, so they keep their own buffer
+  bool own_buffer = policy != 0 && !is_std_file(file);
+
+  file->buffer_mode = policy;
+  file->write_buffer = own_buffer ? ALLOCATE(char, size) : NULL;
+  file->write_buffer_size = own_buffer ? size : 0;
+  if (file->file != NULL && !is_std_file(file)) {
+    file_reopen(file);
+  } else {
+    file_set_buffer(file);
+  }
+
+  FREE_ARRAY(char, old_buffer, old_size);
+  RETURN;
+}
+
 DECLARE_FILE_METHOD(number) {
   ENFORCE_ARG_COUNT(number, 0);
   b_obj_file *file = AS_FILE(METHOD_OBJECT);
@@ -305,6 +763,13 @@ DECLARE_FILE_METHOD(flush) {
     FILE_ERROR(Unsupported, "i/o operation on closed file");
   }
 
+  // nothing has been written since the file was last closed
+  if (file->file == NULL) {
+    RETURN;
+  }
+
+  file_sync(file);
+
 #if defined(IS_UNIX)
   // using fflush on stdin have undesired effect on unix environments
   if (fileno(stdin) == fileno(file->file)) {
@@ -655,6 +1120,7 @@ DECLARE_FILE_METHOD(seek) {
 
   long position = (long) AS_NUMBER(args[0]);
   int seek_type = AS_NUMBER(args[1]);
+  file_sync(file);
   RETURN_STATUS(fseek(file->file, position, seek_type));
 }
 
@@ -662,10 +1128,14 @@ DECLARE_FILE_METHOD(tell) {
   ENFORCE_ARG_COUNT(tell, 0);
   b_obj_file *file = AS_FILE(METHOD_OBJECT);
   DENY_STD();
-  RETURN_NUMBER(ftell(file->file));
+  // bytes read ahead of the reader have not been read yet
+  RETURN_NUMBER(ftell(file->file) - (long) (file->buffer_end - file->buffer_start));
 }
 
 #undef FILE_ERROR
+#undef PREPARE_READ
+#undef PREPARE_WRITE
+#undef RETURN_READ
 #undef RETURN_STATUS
 #undef SET_DICT_STRING
 #undef DENY_STD
@@ -66,20 +66,77 @@ DECLARE_FILE_METHOD(is_closed);
  * reads the contents of an opened file and return it as string or bytes when
  * opened in binary mode
  * - this requires mode 'r' (which is the default) on the file
- * - when reading binary files (mode 'b'), you will have to close it yourself if
- * you didn't read the entire file
+ * - without a size, reads the rest of the file and closes it
+ * - with a size, reads up to size bytes and leaves the file open so the next
+ * read carries on from there. returns nil at the end of the file
  */
 DECLARE_FILE_METHOD(read);
 
+/**
+ * file.read_line()
+ *
+ * reads the next line of a file without its line ending and returns it as
+ * string or bytes when opened in binary mode
+ * - returns nil at the end of the file
+ * - lines are also available through iteration i.e. `for line in file {}`
+ */
+DECLARE_FILE_METHOD(read_line);
+
+/**
+ * file.mmap([access: number])
+ *
+ * maps the file into memory and returns its contents as read-only bytes
+ * without reading it. pages are loaded as they are touched and are shared
+ * with other processes mapping the same file.
+ * - access hints how the bytes will be read and must be one of:
+ *    - io.MMAP_NORMAL (0)
+ *    - io.MMAP_RANDOM (1)
+ *    - io.MMAP_SEQUENTIAL (2)
+ * - the bytes are copied the first time they are modified
+ */
+DECLARE_FILE_METHOD(mmap);
+
+DECLARE_FILE_METHOD(__iter__);
+
+DECLARE_FILE_METHOD(__itern__);
+
 /**
  * file.write(data: string)
  *
  * writes a string or bytes to an opened file.
  * - this requires mode 'w', 'a' or 'r+'
  * - when writing binary (mode 'b'), you will have to close it yourself if you
+ * - files with a buffer set by set_buffer() stay open after the write and
+ * are only guaranteed to reach the disk after flush() or close()
  */
 DECLARE_FILE_METHOD(write);
 
+/**
+ * file.write_all(data: list)
+ *
+ * writes a list of strings (or bytes in mode 'b') to an opened file
+ * in as few system calls as possible.
+ * - returns true if all the data was written
+ */
+DECLARE_FILE_METHOD(write_all);
+
+/**
+ * file.set_buffer(policy: number [, size: number])
+ *
+ * sets how writes to the file are buffered. policy must be one of:
+ *    - io.BUFFER_NONE (0): every write goes straight to the file
+ *    - io.BUFFER_LINE (1): buffered writes are flushed on every newline
+ *    - io.BUFFER_FULL (2): buffered writes are flushed when size bytes
+ *      are pending
+ * - size defaults to 64KiB
+ * - once set, write() no longer closes the file and data may be pending
+ * until flush(), close() or the file is garbage collected
+ * - an open file is reopened where it was to take the new buffer, while
+ * the standard streams take it at once, which is only portable before
+ * they are first used
+ */
+DECLARE_FILE_METHOD(set_buffer);
+
 /**
  * file.number()
  *
@@ -222,4 +279,13 @@ DECLARE_FILE_METHOD(tell);
 
 bool is_std_file(b_obj_file *file);
 
+/**
+ * writes out what the stream of an open file holds on to and drops what
+ * it read ahead, so that the descriptor of the stream can be read from
+ * directly.
+ */
+void flush_file(b_obj_file *file);
+
+void unmap_bytes(b_obj_bytes *bytes);
+
 #endif
\ No newline at end of file
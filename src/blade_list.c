@@ -1,17 +1,97 @@
 #include "blade_list.h"
+#include "blade_set.h"
 
 #include <stdlib.h>
 
+/**
+ * makes room for at least _needed_ items starting at items.values.
+ *
+ * free slots in front of the list (left behind by shift()) are reclaimed
+ * by sliding the items back to the start of the allocation only when they
+ * make up at least half of it. otherwise the allocation grows, so that a
+ * list used as a FIFO queue never pays O(n) for every append.
+ */
+static void ensure_list_capacity(b_vm *vm, b_obj_list *list, int needed) {
+  if (list->items.capacity >= needed)
+    return;
+
+  if (list->head > 0 && list->head >= list->items.count
+      && list->head + list->items.capacity >= needed) {
+    b_value *base = list->items.values - list->head;
+    memmove(base, list->items.values, sizeof(b_value) * list->items.count);
+    list->items.values = base;
+    list->items.capacity += list->head;
+    list->head = 0;
+    return;
+  }
+
+  int old_size = list->head + list->items.capacity;
+  int new_size = GROW_CAPACITY(old_size);
+  while (new_size - list->head < needed) {
+    new_size = GROW_CAPACITY(new_size);
+  }
+
+  b_value *base = GROW_ARRAY(b_value, list->items.values - list->head, old_size, new_size);
+  list->items.values = base + list->head;
+  list->items.capacity = new_size - list->head;
+}
+
+/**
+ * adds an item to the front of a list in amortized O(1).
+ *
+ * when there is no free slot in front of the list, a new allocation is made
+ * that reserves as many front slots as there are items.
+ */
+static void unshift_list(b_vm *vm, b_obj_list *list, b_value value) {
+  if (list->head == 0) {
+    int reserve = GROW_CAPACITY(list->items.count);
+    int old_size = list->items.capacity;
+
+    b_value *base = ALLOCATE(b_value, (size_t) reserve + old_size + 1);
+    if (list->items.count > 0) {
+      memcpy(base + reserve, list->items.values, sizeof(b_value) * list->items.count);
+    }
+    FREE_ARRAY(b_value, list->items.values, old_size);
+
+    list->items.values = base + reserve;
+    list->items.capacity = old_size + 1;
+    list->head = reserve;
+  }
+
+  list->head--;
+  list->items.values--;
+  list->items.capacity++;
+  list->items.values[0] = value;
+  list->items.count++;
+}
+
+/**
+ * removes the first item of a list in O(1) by advancing the head.
+ */
+static b_value shift_list(b_obj_list *list) {
+  b_value value = list->items.values[0];
+  list->head++;
+  list->items.values++;
+  list->items.capacity--;
+  list->items.count--;
+  return value;
+}
+
 void write_list(b_vm *vm, b_obj_list *list, b_value value) {
-  write_value_arr(vm, &list->items, value);
+  unshare_list(vm, list);
+  ensure_list_capacity(vm, list, list->items.count + 1);
+  list->items.values[list->items.count++] = value;
 }
 
 b_obj_list *copy_list(b_vm *vm, b_obj_list *list, int start, int length) {
-  b_obj_list *_list = new_list(vm);
+  b_obj_list *_list = (b_obj_list *) GC(new_list(vm));
 
-  _list->items.values = &list->items.values[start];
-  _list->items.count = length;
-  _list->items.capacity = length;
+  if (length > 0) {
+    _list->items.values = ALLOCATE(b_value, length);
+    memcpy(_list->items.values, &list->items.values[start], sizeof(b_value) * length);
+    _list->items.count = length;
+    _list->items.capacity = length;
+  }
 
   return _list;
 }
@@ -29,7 +109,14 @@ DECLARE_LIST_METHOD(append) {
 
 DECLARE_LIST_METHOD(clear) {
   ENFORCE_ARG_COUNT(clear, 0);
-  free_value_arr(vm, &AS_LIST(METHOD_OBJECT)->items);
+  b_obj_list *list = AS_LIST(METHOD_OBJECT);
+  if (list->owner == NULL) {
+    FREE_ARRAY(b_value, list->items.values - list->head,
+               (size_t) list->head + list->items.capacity);
+  }
+  init_value_arr(&list->items);
+  list->head = 0;
+  list->owner = NULL;
   RETURN;
 }
 
@@ -87,8 +174,31 @@ DECLARE_LIST_METHOD(insert) {
 
   b_obj_list *list = AS_LIST(METHOD_OBJECT);
   int index = (int) AS_NUMBER(args[1]);
+  if (index < 0) {
+    RETURN_ERROR("list index %d out of range at insert()", index);
+  }
 
-  insert_value_arr(vm, &list->items, args[0], index);
+  unshare_list(vm, list);
+  if (index == 0) {
+    unshift_list(vm, list, args[0]);
+    RETURN;
+  }
+
+  if (index <= list->items.count) {
+    ensure_list_capacity(vm, list, list->items.count + 1);
+    memmove(&list->items.values[index + 1], &list->items.values[index],
+            sizeof(b_value) * (list->items.count - index));
+  } else {
+    // nil out overflow indices
+    ensure_list_capacity(vm, list, index + 1);
+    for (int i = list->items.count; i < index; i++) {
+      list->items.values[i] = NIL_VAL;
+    }
+    list->items.count = index;
+  }
+
+  list->items.values[index] = args[0];
+  list->items.count++;
   RETURN;
 }
 
@@ -114,24 +224,18 @@ DECLARE_LIST_METHOD(shift) {
   }
 
   b_obj_list *list = AS_LIST(METHOD_OBJECT);
-  if (count >= list->items.count || list->items.count == 1) {
-    list->items.count = 0;
-    RETURN;
+  if (count > list->items.count) {
+    count = list->items.count;
+  }
+
+  if (count == 1) {
+    RETURN_VALUE(shift_list(list));
   } else if (count > 0) {
-    b_obj_list *n_list = (b_obj_list *) GC(new_list(vm));
+    b_obj_list *n_list = copy_list(vm, list, 0, count);
     for (int i = 0; i < count; i++) {
-      write_list(vm, n_list, list->items.values[0]);
-      for (int j = 0; j < list->items.count; j++) {
-        list->items.values[j] = list->items.values[j + 1];
-      }
-      list->items.count -= 1;
-    }
-
-    if (count == 1) {
-      RETURN_VALUE(n_list->items.values[0]);
-    } else {
-      RETURN_OBJ(n_list);
+      shift_list(list);
     }
+    RETURN_OBJ(n_list);
   }
   RETURN;
 }
@@ -146,8 +250,13 @@ DECLARE_LIST_METHOD(remove_at) {
     RETURN_ERROR("list index %d out of range at remove_at()", index);
   }
 
+  if (index == 0) {
+    RETURN_VALUE(shift_list(list));
+  }
+
+  unshare_list(vm, list);
   b_value value = list->items.values[index];
-  for (int i = index; i < list->items.count; i++) {
+  for (int i = index; i < list->items.count - 1; i++) {
     list->items.values[i] = list->items.values[i + 1];
   }
   list->items.count--;
@@ -166,8 +275,11 @@ DECLARE_LIST_METHOD(remove) {
     }
   }
 
-  if (index != -1) {
-    for (int i = index; i < list->items.count; i++) {
+  if (index == 0) {
+    shift_list(list);
+  } else if (index != -1) {
+    unshare_list(vm, list);
+    for (int i = index; i < list->items.count - 1; i++) {
       list->items.values[i] = list->items.values[i + 1];
     }
     list->items.count--;
@@ -202,7 +314,8 @@ DECLARE_LIST_METHOD(sort) {
   ENFORCE_ARG_COUNT(sort, 0);
 
   b_obj_list *list = AS_LIST(METHOD_OBJECT);
-  sort_values(list->items.values, list->items.count);
+  unshare_list(vm, list);
+  sort_values(vm, list->items.values, list->items.count);
   RETURN;
 }
 
@@ -239,6 +352,7 @@ DECLARE_LIST_METHOD(delete) {
     RETURN_ERROR("invalid upper limit %d at delete()", upper_index);
   }
 
+  unshare_list(vm, list);
   for (int i = 0; i < list->items.count - upper_index; i++) {
     list->items.values[lower_index + i] =
         list->items.values[i + upper_index + 1];
@@ -322,20 +436,18 @@ DECLARE_LIST_METHOD(unique) {
   b_obj_list *list = AS_LIST(METHOD_OBJECT);
   b_obj_list *n_list = (b_obj_list *) GC(new_list(vm));
 
-  for (int i = 0; i < list->items.count; i++) {
-    bool found = false;
-    for (int j = 0; j < n_list->items.count; j++) {
-      if (values_equal(n_list->items.values[j], list->items.values[i])) {
-        found = true;
-        continue;
-      }
-    }
+  // table_set() reports whether the key was new, so a single pass over
+  // the list is enough to keep the first occurrence of every value.
+  b_table seen;
+  init_table(&seen);
 
-    if (!found) {
+  for (int i = 0; i < list->items.count; i++) {
+    if (table_set(vm, &seen, list->items.values[i], TRUE_VAL)) {
       write_list(vm, n_list, list->items.values[i]);
     }
   }
 
+  free_table(vm, &seen);
   RETURN_OBJ(n_list);
 }
 
@@ -379,6 +491,20 @@ DECLARE_LIST_METHOD(to_dict) {
   RETURN_OBJ(dict);
 }
 
+DECLARE_LIST_METHOD(to_set) {
+  ENFORCE_ARG_COUNT(to_set, 0);
+
+  b_obj_set *set = (b_obj_set *) GC(new_set(vm));
+  b_obj_list *list = AS_LIST(METHOD_OBJECT);
+  for (int i = 0; i < list->items.count; i++) {
+    if (IS_NIL(list->items.values[i])) {
+      RETURN_ERROR("to_set() does not accept nil as a set member");
+    }
+    set_add_value(vm, set, list->items.values[i]);
+  }
+  RETURN_OBJ(set);
+}
+
 DECLARE_LIST_METHOD(__iter__) {
   ENFORCE_ARG_COUNT(__iter__, 1);
   ENFORCE_ARG_TYPE(__iter__, 0, IS_NUMBER);
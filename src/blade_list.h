@@ -199,6 +199,14 @@ DECLARE_LIST_METHOD(zip);
  */
 DECLARE_LIST_METHOD(to_dict);
 
+/**
+ * list.to_set()
+ *
+ * returns a set containing the unique values in the list.
+ * use it for repeated membership tests on a large list.
+ */
+DECLARE_LIST_METHOD(to_set);
+
 /**
  * list.@iter()
  *
@@ -0,0 +1,237 @@
+#include "blade_set.h"
+
+#include <stdlib.h>
+
+#define ENFORCE_VALID_SET_MEMBER(name, index)                                  \
+  if (IS_NIL(args[index])) {                                                   \
+    RETURN_ERROR(#name "() does not accept nil as a set member");              \
+  }
+
+bool set_add_value(b_vm *vm, b_obj_set *set, b_value value) {
+  if (table_set(vm, &set->items, value, TRUE_VAL)) {
+    set->count++;
+    return true;
+  }
+  return false;
+}
+
+bool set_has_value(b_obj_set *set, b_value value) {
+  b_value dummy;
+  return table_get(&set->items, value, &dummy);
+}
+
+bool set_is_subset(b_obj_set *a, b_obj_set *b) {
+  if (a->count > b->count)
+    return false;
+
+  for (int i = 0; i < a->items.capacity; i++) {
+    b_value key = a->items.entries[i].key;
+    if (!IS_EMPTY(key) && !set_has_value(b, key)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool sets_equal(b_obj_set *a, b_obj_set *b) {
+  return a == b || (a->count == b->count && set_is_subset(a, b));
+}
+
+DECLARE_NATIVE(set) {
+  ENFORCE_ARG_RANGE(set, 0, 1);
+
+  b_obj_set *set = (b_obj_set *) GC(new_set(vm));
+  if (arg_count == 1) {
+    ENFORCE_ARG_TYPE(set, 0, IS_LIST);
+
+    b_obj_list *list = AS_LIST(args[0]);
+    for (int i = 0; i < list->items.count; i++) {
+      if (IS_NIL(list->items.values[i])) {
+        RETURN_ERROR("set() does not accept nil as a set member");
+      }
+      set_add_value(vm, set, list->items.values[i]);
+    }
+  }
+  RETURN_OBJ(set);
+}
+
+DECLARE_SET_METHOD(length) {
+  ENFORCE_ARG_COUNT(length, 0);
+  RETURN_NUMBER(AS_SET(METHOD_OBJECT)->count);
+}
+
+DECLARE_SET_METHOD(add) {
+  ENFORCE_ARG_COUNT(add, 1);
+  ENFORCE_VALID_SET_MEMBER(add, 0);
+  RETURN_BOOL(set_add_value(vm, AS_SET(METHOD_OBJECT), args[0]));
+}
+
+DECLARE_SET_METHOD(contains) {
+  ENFORCE_ARG_COUNT(contains, 1);
+  RETURN_BOOL(set_has_value(AS_SET(METHOD_OBJECT), args[0]));
+}
+
+DECLARE_SET_METHOD(remove) {
+  ENFORCE_ARG_COUNT(remove, 1);
+
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+  if (!IS_NIL(args[0]) && table_delete(&set->items, args[0])) {
+    set->count--;
+    RETURN_TRUE;
+  }
+  RETURN_FALSE;
+}
+
+DECLARE_SET_METHOD(clear) {
+  ENFORCE_ARG_COUNT(clear, 0);
+
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+  free_table(vm, &set->items);
+  set->count = 0;
+  RETURN;
+}
+
+DECLARE_SET_METHOD(is_empty) {
+  ENFORCE_ARG_COUNT(is_empty, 0);
+  RETURN_BOOL(AS_SET(METHOD_OBJECT)->count == 0);
+}
+
+DECLARE_SET_METHOD(to_list) {
+  ENFORCE_ARG_COUNT(to_list, 0);
+
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+  b_obj_list *list = (b_obj_list *) GC(new_list(vm));
+
+  for (int i = 0; i < set->items.capacity; i++) {
+    if (!IS_EMPTY(set->items.entries[i].key)) {
+      write_list(vm, list, set->items.entries[i].key);
+    }
+  }
+
+  RETURN_OBJ(list);
+}
+
+DECLARE_SET_METHOD(clone) {
+  ENFORCE_ARG_COUNT(clone, 0);
+
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+  b_obj_set *n_set = (b_obj_set *) GC(new_set(vm));
+  table_add_all(vm, &set->items, &n_set->items);
+  n_set->count = set->count;
+  RETURN_OBJ(n_set);
+}
+
+DECLARE_SET_METHOD(union) {
+  ENFORCE_ARG_COUNT(union, 1);
+  ENFORCE_ARG_TYPE(union, 0, IS_SET);
+
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+  b_obj_set *other = AS_SET(args[0]);
+
+  // start from a copy of the larger set so fewer members need rehashing.
+  if (other->count > set->count) {
+    b_obj_set *tmp = set;
+    set = other;
+    other = tmp;
+  }
+
+  b_obj_set *n_set = (b_obj_set *) GC(new_set(vm));
+  table_add_all(vm, &set->items, &n_set->items);
+  n_set->count = set->count;
+
+  for (int i = 0; i < other->items.capacity; i++) {
+    if (!IS_EMPTY(other->items.entries[i].key)) {
+      set_add_value(vm, n_set, other->items.entries[i].key);
+    }
+  }
+  RETURN_OBJ(n_set);
+}
+
+DECLARE_SET_METHOD(intersect) {
+  ENFORCE_ARG_COUNT(intersect, 1);
+  ENFORCE_ARG_TYPE(intersect, 0, IS_SET);
+
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+  b_obj_set *other = AS_SET(args[0]);
+
+  // walk the smaller set and probe the larger one.
+  if (other->count < set->count) {
+    b_obj_set *tmp = set;
+    set = other;
+    other = tmp;
+  }
+
+  b_obj_set *n_set = (b_obj_set *) GC(new_set(vm));
+  for (int i = 0; i < set->items.capacity; i++) {
+    b_value key = set->items.entries[i].key;
+    if (!IS_EMPTY(key) && set_has_value(other, key)) {
+      set_add_value(vm, n_set, key);
+    }
+  }
+  RETURN_OBJ(n_set);
+}
+
+DECLARE_SET_METHOD(difference) {
+  ENFORCE_ARG_COUNT(difference, 1);
+  ENFORCE_ARG_TYPE(difference, 0, IS_SET);
+
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+  b_obj_set *other = AS_SET(args[0]);
+
+  b_obj_set *n_set = (b_obj_set *) GC(new_set(vm));
+  for (int i = 0; i < set->items.capacity; i++) {
+    b_value key = set->items.entries[i].key;
+    if (!IS_EMPTY(key) && !set_has_value(other, key)) {
+      set_add_value(vm, n_set, key);
+    }
+  }
+  RETURN_OBJ(n_set);
+}
+
+DECLARE_SET_METHOD(is_subset) {
+  ENFORCE_ARG_COUNT(is_subset, 1);
+  ENFORCE_ARG_TYPE(is_subset, 0, IS_SET);
+  RETURN_BOOL(set_is_subset(AS_SET(METHOD_OBJECT), AS_SET(args[0])));
+}
+
+/*
+ * sets are iterated by the position of their members in the
+ * underlying table. the index is only meaningful to @iter().
+ */
+DECLARE_SET_METHOD(__iter__) {
+  ENFORCE_ARG_COUNT(__iter__, 1);
+  ENFORCE_ARG_TYPE(__iter__, 0, IS_NUMBER);
+
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+
+  int index = AS_NUMBER(args[0]);
+  if (index > -1 && index < set->items.capacity && !IS_EMPTY(set->items.entries[index].key)) {
+    RETURN_VALUE(set->items.entries[index].key);
+  }
+
+  RETURN;
+}
+
+DECLARE_SET_METHOD(__itern__) {
+  ENFORCE_ARG_COUNT(__itern__, 1);
+  b_obj_set *set = AS_SET(METHOD_OBJECT);
+
+  int index = 0;
+  if (!IS_NIL(args[0])) {
+    if (!IS_NUMBER(args[0])) {
+      RETURN_ERROR("sets are numerically indexed");
+    }
+    index = (int) AS_NUMBER(args[0]) + 1;
+  }
+
+  for (; index < set->items.capacity; index++) {
+    if (!IS_EMPTY(set->items.entries[index].key)) {
+      RETURN_NUMBER(index);
+    }
+  }
+
+  if (IS_NIL(args[0])) {
+    RETURN_FALSE;
+  }
+  RETURN;
+}
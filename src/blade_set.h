@@ -0,0 +1,140 @@
+#ifndef BLADE_SET_H
+#define BLADE_SET_H
+
+#include "common.h"
+#include "native.h"
+#include "vm.h"
+
+#define DECLARE_SET_METHOD(name) DECLARE_METHOD(set##name)
+
+/**
+ * adds value to the set and returns true if it was not already a member.
+ */
+bool set_add_value(b_vm *vm, b_obj_set *set, b_value value);
+
+/**
+ * returns true if value is a member of the set.
+ */
+bool set_has_value(b_obj_set *set, b_value value);
+
+/**
+ * returns true if every member of a is also a member of b.
+ */
+bool set_is_subset(b_obj_set *a, b_obj_set *b);
+
+/**
+ * returns true if both sets contain exactly the same members.
+ */
+bool sets_equal(b_obj_set *a, b_obj_set *b);
+
+/**
+ * set([items: list])
+ *
+ * creates a new set
+ * - if no argument is given, the set is empty
+ * - if a list is given, the set contains the unique values of the list
+ */
+DECLARE_NATIVE(set);
+
+/**
+ * set.length()
+ *
+ * returns the number of members in the set
+ */
+DECLARE_SET_METHOD(length);
+
+/**
+ * set.add(value: any)
+ *
+ * adds a value to the set and returns true if it was not
+ * already in the set
+ */
+DECLARE_SET_METHOD(add);
+
+/**
+ * set.contains(value: any)
+ *
+ * returns true if the value is a member of the set
+ */
+DECLARE_SET_METHOD(contains);
+
+/**
+ * set.remove(value: any)
+ *
+ * removes a value from the set and returns true if it was
+ * a member
+ */
+DECLARE_SET_METHOD(remove);
+
+/**
+ * set.clear()
+ *
+ * removes all members of the set
+ */
+DECLARE_SET_METHOD(clear);
+
+/**
+ * set.is_empty()
+ *
+ * returns true if the set has no member
+ */
+DECLARE_SET_METHOD(is_empty);
+
+/**
+ * set.to_list()
+ *
+ * returns the members of the set as a list
+ */
+DECLARE_SET_METHOD(to_list);
+
+/**
+ * set.clone()
+ *
+ * returns a new set with the same members
+ */
+DECLARE_SET_METHOD(clone);
+
+/**
+ * set.union(other: set)
+ *
+ * returns a new set containing the members of both sets
+ */
+DECLARE_SET_METHOD(union);
+
+/**
+ * set.intersect(other: set)
+ *
+ * returns a new set containing only the members found in both sets
+ */
+DECLARE_SET_METHOD(intersect);
+
+/**
+ * set.difference(other: set)
+ *
+ * returns a new set containing the members of this set that are
+ * not in the other set
+ */
+DECLARE_SET_METHOD(difference);
+
+/**
+ * set.is_subset(other: set)
+ *
+ * returns true if every member of this set is also in the other set
+ */
+DECLARE_SET_METHOD(is_subset);
+
+/**
+ * set.@iter()
+ *
+ * implementing the iterable interface
+ */
+DECLARE_SET_METHOD(__iter__);
+
+/**
+ * set.@itern()
+ *
+ * implementing the iterable interface
+ */
+DECLARE_SET_METHOD(__itern__);
+
+#endif
@@ -59,11 +59,15 @@ typedef enum {
   OP_CALL,
   OP_INVOKE,
   OP_INVOKE_SELF,
+  OP_TAIL_CALL,
+  OP_TAIL_INVOKE,
+  OP_TAIL_INVOKE_SELF,
   OP_RETURN,
 
   OP_CLASS,
   OP_METHOD,
   OP_CLASS_PROPERTY,
+  OP_END_CLASS,
   OP_INHERIT,
   OP_GET_SUPER,
   OP_SUPER_INVOKE,
@@ -93,6 +97,33 @@ typedef enum {
   OP_SWITCH,
   OP_CHOICE,
 
+  // number-specialised variants the vm quickens the generic
+  // opcodes into. they are never emitted by the compiler.
+  OP_EQUAL_NUM,
+  OP_GREATER_NUM,
+  OP_LESS_NUM,
+  OP_ADD_NUM,
+  OP_SUBTRACT_NUM,
+  OP_MULTIPLY_NUM,
+
+  // superinstructions for frequent sequences. the compiler swaps the
+  // opcode of the first instruction in the sequence and leaves the rest
+  // in place, so jumps into the middle still land on valid code and the
+  // vm can always fall back to running the sequence one step at a time.
+  OP_ADD_LOCALS,         // g_loc, g_loc, add
+  OP_LESS_CONSTANT_JUMP, // g_loc, load, less, f_jump, pop
+  OP_GET_LOCAL_PROPERTY, // g_loc, g_prop
+  OP_GET_LOCAL_INVOKE,   // g_loc, invk
+
+  // register-style instructions that work on frame slots directly.
+  // they follow the same in-place layout as the superinstructions and
+  // are only emitted when the vm runs with fused locals on (-f).
+  OP_ARITH_LOCALS,   // g_loc a, g_loc b, <op>, s_loc d, pop => d = a <op> b
+  OP_ARITH_CONSTANT, // g_loc a, load k, <op>, s_loc d, pop => d = a <op> k
+  OP_INCREMENT_LOCAL, // g_loc a, one, add, s_loc d, pop => d = a + 1
+  OP_MOVE_LOCAL,     // g_loc a, s_loc d, pop => d = a
+  OP_STORE_LOCAL,    // s_loc d, pop
+
   // the break placeholder... it never gets to the vm
   // care should be taken to
   OP_BREAK_PL,
@@ -48,6 +48,7 @@ DECLARE_BYTES_METHOD(append) {
 
     // append here...
     b_obj_bytes *bytes = AS_BYTES(METHOD_OBJECT);
+    unshare_bytes(vm, bytes);
     int old_count = bytes->bytes.count;
     bytes->bytes.count++;
     bytes->bytes.bytes = reallocate(vm, bytes->bytes.bytes, old_count,
@@ -59,6 +60,7 @@ DECLARE_BYTES_METHOD(append) {
     if (list->items.count > 0) {
       // append here...
       b_obj_bytes *bytes = AS_BYTES(METHOD_OBJECT);
+      unshare_bytes(vm, bytes);
       bytes->bytes.bytes =
           reallocate(vm, bytes->bytes.bytes, bytes->bytes.count,
                      (size_t) bytes->bytes.count + (size_t) list->items.count);
@@ -100,6 +102,7 @@ DECLARE_BYTES_METHOD(extend) {
   b_obj_bytes *bytes = AS_BYTES(METHOD_OBJECT);
   b_obj_bytes *n_bytes = AS_BYTES(args[0]);
 
+  unshare_bytes(vm, bytes);
   bytes->bytes.bytes = reallocate(vm, bytes->bytes.bytes, bytes->bytes.count,
                                   (size_t) bytes->bytes.count + (size_t) n_bytes->bytes.count);
 
@@ -130,7 +133,8 @@ DECLARE_BYTES_METHOD(remove) {
 
   unsigned char val = bytes->bytes.bytes[index];
 
-  for (int i = index; i < bytes->bytes.count; i++) {
+  unshare_bytes(vm, bytes);
+  for (int i = index; i < bytes->bytes.count - 1; i++) {
     bytes->bytes.bytes[i] = bytes->bytes.bytes[i + 1];
   }
   bytes->bytes.count--;
@@ -26,7 +26,6 @@
 
 #define UINT8_COUNT (UINT8_MAX + 1)
 #define UINT16_COUNT (UINT16_MAX + 1)
-#define STACK_MAX (FRAMES_MAX * UINT8_COUNT)
 
 #if defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))
 #define IS_UNIX
@@ -140,8 +140,8 @@ static void ignore_whitespace(b_parser *p) {
   while (match(p, NEWLINE_TOKEN));
 }
 
-static int get_code_args_count(const uint8_t *bytecode,
-                               const b_value *constants, int ip) {
+int get_code_args_count(const uint8_t *bytecode,
+                        const b_value *constants, int ip) {
   b_code code = (b_code) bytecode[ip];
 
   switch (code) {
@@ -166,7 +166,7 @@ static int get_code_args_count(const uint8_t *bytecode,
     case OP_DUP:
     case OP_RETURN:
     case OP_INHERIT:
-    case OP_GET_SUPER:
+    case OP_END_CLASS:
     case OP_AND:
     case OP_OR:
     case OP_XOR:
@@ -183,18 +183,32 @@ static int get_code_args_count(const uint8_t *bytecode,
     case OP_CHOICE:
     case OP_EMPTY:
     case OP_IMPORT_ALL_NATIVE:
+    case OP_EQUAL_NUM:
+    case OP_GREATER_NUM:
+    case OP_LESS_NUM:
+    case OP_ADD_NUM:
+    case OP_SUBTRACT_NUM:
+    case OP_MULTIPLY_NUM:
       return 0;
 
     case OP_CALL:
+    case OP_TAIL_CALL:
     case OP_SUPER_INVOKE_SELF:
     case OP_GET_INDEX:
     case OP_GET_RANGED_INDEX:
       return 1;
 
     case OP_DEFINE_GLOBAL:
-    case OP_GET_GLOBAL:
-    case OP_SET_GLOBAL:
     case OP_GET_LOCAL:
+    case OP_ADD_LOCALS:
+    case OP_LESS_CONSTANT_JUMP:
+    case OP_GET_LOCAL_PROPERTY:
+    case OP_GET_LOCAL_INVOKE:
+    case OP_ARITH_LOCALS:
+    case OP_ARITH_CONSTANT:
+    case OP_INCREMENT_LOCAL:
+    case OP_MOVE_LOCAL:
+    case OP_STORE_LOCAL:
     case OP_SET_LOCAL:
     case OP_GET_UP_VALUE:
     case OP_SET_UP_VALUE:
@@ -215,16 +229,24 @@ static int get_code_args_count(const uint8_t *bytecode,
     case OP_SELECT_NATIVE_IMPORT:
     case OP_SWITCH:
     case OP_METHOD:
+    case OP_GET_SUPER:
+    case OP_SELECT_IMPORT:
     case OP_EJECT_IMPORT:
     case OP_EJECT_NATIVE_IMPORT:
       return 2;
 
     case OP_INVOKE:
     case OP_INVOKE_SELF:
+    case OP_TAIL_INVOKE:
+    case OP_TAIL_INVOKE_SELF:
     case OP_SUPER_INVOKE:
     case OP_CLASS_PROPERTY:
       return 3;
 
+    case OP_GET_GLOBAL:
+    case OP_SET_GLOBAL:
+      return 4;
+
     case OP_TRY:
       return 6;
 
@@ -260,6 +282,12 @@ static void emit_byte_and_short(b_parser *p, uint8_t byte, uint16_t byte2) {
   write_blob(p->vm, current_blob(p), byte, p->previous.line);
   write_blob(p->vm, current_blob(p), (byte2 >> 8) & 0xff, p->previous.line);
   write_blob(p->vm, current_blob(p), byte2 & 0xff, p->previous.line);
+
+  if (byte == OP_GET_GLOBAL || byte == OP_SET_GLOBAL) {
+    // room for the vm to remember the variable's slot in the module table
+    write_blob(p->vm, current_blob(p), 0xff, p->previous.line);
+    write_blob(p->vm, current_blob(p), 0xff, p->previous.line);
+  }
 }
 
 /* static void emit_byte_and_long(b_parser *p, uint8_t byte, uint16_t byte2) {
@@ -376,6 +404,7 @@ static void init_compiler(b_parser *p, b_compiler *compiler, b_func_type type) {
   compiler->local_count = 0;
   compiler->scope_depth = 0;
   compiler->handler_count = 0;
+  compiler->try_depth = 0;
 
   compiler->function = new_function(p->vm, p->module, type);
   p->vm->compiler = compiler;
@@ -389,6 +418,8 @@ static void init_compiler(b_parser *p, b_compiler *compiler, b_func_type type) {
   b_local *local = &p->vm->compiler->locals[p->vm->compiler->local_count++];
   local->depth = 0;
   local->is_captured = false;
+  local->is_assigned = false;
+  local->declared_at = 0;
 
   if (type != TYPE_FUNCTION) {
     local->name.start = "self";
@@ -415,6 +446,10 @@ static int resolve_local(b_parser *p, b_compiler *compiler, b_token *name) {
       if (local->depth == -1) {
         error(p, "cannot read local variable in it's own initializer");
       }
+      // __args__ sits right after the named parameters
+      if (compiler->function->is_variadic && i == compiler->function->arity) {
+        compiler->function->uses_args = true;
+      }
       return i;
     }
   }
@@ -471,6 +506,8 @@ static int add_local(b_parser *p, b_token name) {
   local->name = name;
   local->depth = -1;
   local->is_captured = false;
+  local->is_assigned = false;
+  local->declared_at = current_blob(p)->count;
   return p->vm->compiler->local_count;
 }
 
@@ -530,10 +567,144 @@ static b_token synthetic_token(const char *name) {
   return token;
 }
 
+static inline bool is_register_arith(uint8_t code) {
+  return code == OP_ADD || code == OP_SUBTRACT || code == OP_MULTIPLY || code == OP_DIVIDE;
+}
+
+static inline bool is_local_store(const b_blob *blob, int offset) {
+  return offset + 3 < blob->count && blob->code[offset] == OP_SET_LOCAL &&
+         blob->code[offset + 3] == OP_POP;
+}
+
+/**
+ * rewrites the first opcode of a local assignment statement into the
+ * register-style instruction that performs the whole statement.
+ */
+static bool fuse_register_instruction(b_blob *blob, int offset, int next) {
+  uint8_t *code = blob->code;
+
+  if (code[offset] == OP_SET_LOCAL) {
+    if (is_local_store(blob, offset)) {
+      code[offset] = OP_STORE_LOCAL;
+      return true;
+    }
+    return false;
+  } else if (code[offset] != OP_GET_LOCAL || next >= blob->count) {
+    return false;
+  }
+
+  switch (code[next]) {
+    case OP_SET_LOCAL: {
+      if (is_local_store(blob, next)) {
+        code[offset] = OP_MOVE_LOCAL;
+        return true;
+      }
+      break;
+    }
+    case OP_GET_LOCAL:
+    case OP_CONSTANT: {
+      if (next + 3 < blob->count && is_register_arith(code[next + 3]) && is_local_store(blob, next + 4)) {
+        code[offset] = code[next] == OP_GET_LOCAL ? OP_ARITH_LOCALS : OP_ARITH_CONSTANT;
+        return true;
+      }
+      break;
+    }
+    case OP_ONE: {
+      if (next + 1 < blob->count && code[next + 1] == OP_ADD && is_local_store(blob, next + 2)) {
+        code[offset] = OP_INCREMENT_LOCAL;
+        return true;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return false;
+}
+
+/**
+ * swaps the first opcode of frequent instruction sequences for the
+ * matching superinstruction. see blob.h.
+ */
+static void fuse_instructions(b_blob *blob, bool fuse_locals) {
+  uint8_t *code = blob->code;
+
+  for (int i = 0; i < blob->count;) {
+    int next = i + 1 + get_code_args_count(code, blob->constants.values, i);
+
+    if (fuse_locals && fuse_register_instruction(blob, i, next)) {
+      i = next;
+      continue;
+    }
+
+    if (code[i] == OP_GET_LOCAL && next < blob->count) {
+      switch (code[next]) {
+        case OP_GET_LOCAL: {
+          if (next + 3 < blob->count && code[next + 3] == OP_ADD) {
+            code[i] = OP_ADD_LOCALS;
+          }
+          break;
+        }
+        case OP_CONSTANT: {
+          if (next + 7 < blob->count && code[next + 3] == OP_LESS &&
+              code[next + 4] == OP_JUMP_IF_FALSE && code[next + 7] == OP_POP) {
+            code[i] = OP_LESS_CONSTANT_JUMP;
+          }
+          break;
+        }
+        case OP_GET_PROPERTY:
+          code[i] = OP_GET_LOCAL_PROPERTY;
+          break;
+        case OP_INVOKE:
+          code[i] = OP_GET_LOCAL_INVOKE;
+          break;
+        default:
+          break;
+      }
+    }
+
+    i = next;
+  }
+}
+
+// closures capture a local that is never assigned after its declaration
+// by copying its value, so they need no up value and the local never
+// joins the open up values list.
+static void flatten_captures(b_parser *p, int slot) {
+  b_blob *blob = current_blob(p);
+  b_local *local = &p->vm->compiler->locals[slot];
+  if (!local->is_captured || local->is_assigned)
+    return;
+
+  for (int i = local->declared_at; i < blob->count;
+       i += 1 + get_code_args_count(blob->code, blob->constants.values, i)) {
+    if (blob->code[i] != OP_CLOSURE)
+      continue;
+
+    int constant = (blob->code[i + 1] << 8) | blob->code[i + 2];
+    b_obj_func *function = AS_FUNCTION(blob->constants.values[constant]);
+
+    for (int j = 0; j < function->up_value_count; j++) {
+      uint8_t *capture = &blob->code[i + 3 + j * 3];
+      if (capture[0] == 1 && ((capture[1] << 8) | capture[2]) == slot) {
+        capture[0] = 2;
+      }
+    }
+  }
+}
+
 static b_obj_func *end_compiler(b_parser *p) {
   emit_return(p);
   b_obj_func *function = p->vm->compiler->function;
 
+  for (int i = 0; i < p->vm->compiler->local_count; i++) {
+    flatten_captures(p, i);
+  }
+
+  if (!p->had_error) {
+    fuse_instructions(current_blob(p), p->vm->use_fused_locals);
+  }
+
   if (!p->had_error && p->vm->should_print_bytecode) {
     disassemble_blob(current_blob(p), function->name == NULL
                                       ? p->module->file
@@ -553,7 +724,10 @@ static void end_scope(b_parser *p) {
   while (p->vm->compiler->local_count > 0 &&
          p->vm->compiler->locals[p->vm->compiler->local_count - 1].depth >
          p->vm->compiler->scope_depth) {
-    if (p->vm->compiler->locals[p->vm->compiler->local_count - 1].is_captured) {
+    b_local *local = &p->vm->compiler->locals[p->vm->compiler->local_count - 1];
+    flatten_captures(p, p->vm->compiler->local_count - 1);
+
+    if (local->is_captured && local->is_assigned) {
       emit_byte(p, OP_CLOSE_UP_VALUE);
     } else {
       emit_byte(p, OP_POP);
@@ -728,6 +902,27 @@ static void literal(b_parser *p, bool can_assign) {
   }
 }
 
+static void emit_set(b_parser *p, uint8_t set_op, int arg) {
+  if (arg != -1) {
+    emit_byte_and_short(p, set_op, (uint16_t) arg);
+  } else {
+    emit_byte(p, set_op);
+  }
+
+  // follow up values back to the local they write to.
+  b_compiler *compiler = p->vm->compiler;
+  while (set_op == OP_SET_UP_VALUE) {
+    b_up_value *up_value = &compiler->up_values[arg];
+    compiler = compiler->enclosing;
+    arg = up_value->index;
+    set_op = up_value->is_local ? OP_SET_LOCAL : OP_SET_UP_VALUE;
+  }
+
+  if (set_op == OP_SET_LOCAL) {
+    compiler->locals[arg].is_assigned = true;
+  }
+}
+
 static void parse_assignment(b_parser *p, uint8_t real_op, uint8_t get_op, uint8_t set_op, int arg) {
   p->repl_can_echo = false;
   if (get_op == OP_GET_PROPERTY || get_op == OP_GET_SELF_PROPERTY) {
@@ -742,11 +937,7 @@ static void parse_assignment(b_parser *p, uint8_t real_op, uint8_t get_op, uint8
 
   expression(p);
   emit_byte(p, real_op);
-  if (arg != -1) {
-    emit_byte_and_short(p, set_op, (uint16_t) arg);
-  } else {
-    emit_byte(p, set_op);
-  }
+  emit_set(p, set_op, arg);
 }
 
 static void assignment(b_parser *p, uint8_t get_op, uint8_t set_op, int arg, bool can_assign) {
@@ -754,11 +945,7 @@ static void assignment(b_parser *p, uint8_t get_op, uint8_t set_op, int arg, boo
   if (can_assign && match(p, EQUAL_TOKEN)) {
     p->repl_can_echo = false;
     expression(p);
-    if (arg != -1) {
-      emit_byte_and_short(p, set_op, (uint16_t) arg);
-    } else {
-      emit_byte(p, set_op);
-    }
+    emit_set(p, set_op, arg);
   } else if (can_assign && match(p, PLUS_EQ_TOKEN)) {
     parse_assignment(p, OP_ADD, get_op, set_op, arg);
   } else if (can_assign && match(p, MINUS_EQ_TOKEN)) {
@@ -798,7 +985,7 @@ static void assignment(b_parser *p, uint8_t get_op, uint8_t set_op, int arg, boo
     }
 
     emit_bytes(p, OP_ONE, OP_ADD);
-    emit_byte_and_short(p, set_op, (uint16_t) arg);
+    emit_set(p, set_op, arg);
   } else if (can_assign && match(p, DECREMENT_TOKEN)) {
     p->repl_can_echo = false;
     if (get_op == OP_GET_PROPERTY || get_op == OP_GET_SELF_PROPERTY) {
@@ -812,7 +999,7 @@ static void assignment(b_parser *p, uint8_t get_op, uint8_t set_op, int arg, boo
     }
 
     emit_bytes(p, OP_ONE, OP_SUBTRACT);
-    emit_byte_and_short(p, set_op, (uint16_t) arg);
+    emit_set(p, set_op, arg);
   } else {
     if (arg != -1) {
       if (get_op == OP_GET_INDEX || get_op == OP_GET_RANGED_INDEX) {
@@ -1573,7 +1760,7 @@ static void class_declaration(b_parser *p) {
     }
   }
   consume(p, RBRACE_TOKEN, "expected '}' after class body");
-  emit_byte(p, OP_POP);
+  emit_byte(p, OP_END_CLASS);
 
   if (class_compiler.has_superclass) {
     end_scope(p);
@@ -1821,7 +2008,7 @@ static void for_statement(b_parser *p) {
   emit_byte_and_short(p, OP_GET_LOCAL, key_slot);
   emit_byte_and_short(p, OP_INVOKE, iter_n__);
   emit_byte(p, 1);
-  emit_byte_and_short(p, OP_SET_LOCAL, key_slot);
+  emit_set(p, OP_SET_LOCAL, key_slot);
 
   int false_jump = emit_jump(p, OP_JUMP_IF_FALSE);
   emit_byte(p, OP_POP);
@@ -1837,7 +2024,7 @@ static void for_statement(b_parser *p) {
   begin_scope(p);
 
   // update the value
-  emit_byte_and_short(p, OP_SET_LOCAL, value_slot);
+  emit_set(p, OP_SET_LOCAL, value_slot);
   emit_byte(p, OP_POP);
 
   statement(p);
@@ -2142,12 +2329,17 @@ static void try_statement(b_parser *p) {
     error(p, "maximum exception handler in scope exceeded");
   }
   p->vm->compiler->handler_count++;
+  p->vm->compiler->try_depth++;
 
   consume(p, LBRACE_TOKEN, "expected '{' after try");
   ignore_whitespace(p);
   int try_begins = emit_try(p);
 
+  // the try body has its own scope so that its locals are gone
+  // before the catch variable takes the slot of the exception.
+  begin_scope(p);
   block(p); // compile the try body
+  end_scope(p);
   emit_byte(p, OP_POP_TRY);
   int exit_jump = emit_jump(p, OP_JUMP);
 
@@ -2167,11 +2359,12 @@ static void try_statement(b_parser *p) {
     address = current_blob(p)->count;
     // patch_try(p, try_begins, type);
 
+    // the vm leaves the exception on top of the stack, right where
+    // the catch variable lives.
     if (match(p, IDENTIFIER_TOKEN)) {
       add_local(p, p->previous);
       mark_initialized(p);
-      uint16_t var = resolve_local(p, p->vm->compiler, &p->previous);
-      emit_byte_and_short(p, OP_SET_LOCAL, var);
+    } else {
       emit_byte(p, OP_POP);
     }
 
@@ -2206,6 +2399,31 @@ static void try_statement(b_parser *p) {
   }
 
   patch_try(p, try_begins, type, address, finally);
+  p->vm->compiler->try_depth--;
+}
+
+/**
+ * turns the call a return expression ends with into a tail call so that
+ * the callee takes over the current call frame. calls inside a try
+ * statement are left alone because the frame owns the handlers.
+ */
+static void tail_call(b_parser *p, int start) {
+  b_blob *blob = current_blob(p);
+  if (p->vm->compiler->try_depth > 0 || start == blob->count)
+    return;
+
+  int last = start;
+  for (int i = start; i < blob->count;
+       i += 1 + get_code_args_count(blob->code, blob->constants.values, i)) {
+    last = i;
+  }
+
+  switch (blob->code[last]) {
+    case OP_CALL: blob->code[last] = OP_TAIL_CALL; break;
+    case OP_INVOKE: blob->code[last] = OP_TAIL_INVOKE; break;
+    case OP_INVOKE_SELF: blob->code[last] = OP_TAIL_INVOKE_SELF; break;
+    default: break;
+  }
 }
 
 static void return_statement(b_parser *p) {
@@ -2221,8 +2439,10 @@ static void return_statement(b_parser *p) {
       error(p, "cannot return value from constructor");
     }
 
+    int start = current_blob(p)->count;
     expression(p);
     consume_statement_end(p);
+    tail_call(p, start);
     emit_byte(p, OP_RETURN);
   }
   p->is_returning = false;
@@ -2235,6 +2455,7 @@ static void while_statement(b_parser *p) {
   // we'll be jumping back to right before the
   // expression after the loop body
   p->innermost_loop_start = current_blob(p)->count;
+  p->innermost_loop_scope_depth = p->vm->compiler->scope_depth;
 
   expression(p);
 
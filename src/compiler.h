@@ -30,6 +30,8 @@ typedef struct {
   b_token name;
   int depth;
   bool is_captured;
+  bool is_assigned; // written to after its declaration
+  int declared_at;  // bytecode offset of the declaration
 } b_local;
 
 typedef struct {
@@ -49,6 +51,7 @@ struct s_compiler {
   b_up_value up_values[UINT8_COUNT];
   int scope_depth;
   int handler_count;
+  int try_depth; // try statements enclosing the current code
 };
 
 typedef struct b_class_compiler {
@@ -91,4 +94,6 @@ b_obj_func *compile(b_vm *vm, b_obj_module *module, const char *source, b_blob *
 
 void mark_compiler_roots(b_vm *vm);
 
+int get_code_args_count(const uint8_t *bytecode, const b_value *constants, int ip);
+
 #endif
\ No newline at end of file
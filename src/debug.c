@@ -3,6 +3,10 @@
 #include "value.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+
+// how many of the most frequent sequences print_op_profile() lists
+#define OP_PROFILE_TOP 20
 
 void disassemble_blob(b_blob *blob, const char *name) {
   printf("== %s ==\n", name);
@@ -37,6 +41,19 @@ static int byte_instruction(const char *name, b_blob *blob, int offset) {
   return offset + 2;
 }
 
+static int global_instruction(const char *name, b_blob *blob, int offset) {
+  uint16_t constant = (blob->code[offset + 1] << 8) | blob->code[offset + 2];
+  uint16_t slot = (blob->code[offset + 3] << 8) | blob->code[offset + 4];
+  printf("%-16s %8d '", name, constant);
+  print_value(blob->constants.values[constant]);
+  if (slot == UINT16_MAX) {
+    printf("'\n");
+  } else {
+    printf("' @%d\n", slot);
+  }
+  return offset + 5;
+}
+
 static int jump_instruction(const char *name, int sign, b_blob *blob,
                             int offset) {
   uint16_t jump = (uint16_t) (blob->code[offset + 1] << 8);
@@ -91,12 +108,30 @@ int disassemble_instruction(b_blob *blob, int offset) {
     case OP_DEFINE_GLOBAL:
       return constant_instruction("d_glob", blob, offset);
     case OP_GET_GLOBAL:
-      return constant_instruction("g_glob", blob, offset);
+      return global_instruction("g_glob", blob, offset);
     case OP_SET_GLOBAL:
-      return constant_instruction("s_glob", blob, offset);
+      return global_instruction("s_glob", blob, offset);
 
     case OP_GET_LOCAL:
       return short_instruction("g_loc", blob, offset);
+    case OP_ADD_LOCALS:
+      return short_instruction("g_loc_add", blob, offset);
+    case OP_LESS_CONSTANT_JUMP:
+      return short_instruction("g_loc_lt_jmp", blob, offset);
+    case OP_GET_LOCAL_PROPERTY:
+      return short_instruction("g_loc_prop", blob, offset);
+    case OP_GET_LOCAL_INVOKE:
+      return short_instruction("g_loc_invk", blob, offset);
+    case OP_ARITH_LOCALS:
+      return short_instruction("r_arith", blob, offset);
+    case OP_ARITH_CONSTANT:
+      return short_instruction("r_arith_k", blob, offset);
+    case OP_INCREMENT_LOCAL:
+      return short_instruction("r_inc", blob, offset);
+    case OP_MOVE_LOCAL:
+      return short_instruction("r_mov", blob, offset);
+    case OP_STORE_LOCAL:
+      return short_instruction("r_store", blob, offset);
     case OP_SET_LOCAL:
       return short_instruction("s_loc", blob, offset);
 
@@ -168,6 +203,19 @@ int disassemble_instruction(b_blob *blob, int offset) {
     case OP_ONE:
       return simple_instruction("one", offset);
 
+    case OP_EQUAL_NUM:
+      return simple_instruction("eq_n", offset);
+    case OP_GREATER_NUM:
+      return simple_instruction("gt_n", offset);
+    case OP_LESS_NUM:
+      return simple_instruction("less_n", offset);
+    case OP_ADD_NUM:
+      return simple_instruction("add_n", offset);
+    case OP_SUBTRACT_NUM:
+      return simple_instruction("sub_n", offset);
+    case OP_MULTIPLY_NUM:
+      return simple_instruction("mul_n", offset);
+
     case OP_CALL_IMPORT:
       return short_instruction("c_import", blob, offset);
     case OP_NATIVE_MODULE:
@@ -236,7 +284,8 @@ int disassemble_instruction(b_blob *blob, int offset) {
         uint16_t index = blob->code[offset++] << 8;
         index |= blob->code[offset++];
         printf("%04d      |                     %s %d\n", offset - 3,
-               is_local ? "local" : "up-value", (int) index);
+               is_local == 2 ? "copy" : is_local ? "local" : "up-value",
+               (int) index);
       }
 
       return offset;
@@ -247,6 +296,12 @@ int disassemble_instruction(b_blob *blob, int offset) {
       return invoke_instruction("invk", blob, offset);
     case OP_INVOKE_SELF:
       return invoke_instruction("invk_s", blob, offset);
+    case OP_TAIL_CALL:
+      return byte_instruction("t_call", blob, offset);
+    case OP_TAIL_INVOKE:
+      return invoke_instruction("t_invk", blob, offset);
+    case OP_TAIL_INVOKE_SELF:
+      return invoke_instruction("t_invk_s", blob, offset);
     case OP_RETURN:
       return simple_instruction("ret", offset);
 
@@ -256,6 +311,8 @@ int disassemble_instruction(b_blob *blob, int offset) {
       return constant_instruction("meth", blob, offset);
     case OP_CLASS_PROPERTY:
       return constant_instruction("cl_prop", blob, offset);
+    case OP_END_CLASS:
+      return simple_instruction("e_class", offset);
     case OP_GET_SUPER:
       return constant_instruction("g_sup", blob, offset);
     case OP_INHERIT:
@@ -269,4 +326,180 @@ int disassemble_instruction(b_blob *blob, int offset) {
       printf("unknown opcode %d\n", instruction);
       return offset + 1;
   }
-}
\ No newline at end of file
+}
+static const char *opcode_names[OPCODE_COUNT] = {
+    [OP_DEFINE_GLOBAL] = "d_glob",
+    [OP_GET_GLOBAL] = "g_glob",
+    [OP_SET_GLOBAL] = "s_glob",
+    [OP_GET_LOCAL] = "g_loc",
+    [OP_GET_UP_VALUE] = "g_up_v",
+    [OP_SET_LOCAL] = "s_loc",
+    [OP_SET_UP_VALUE] = "s_up_v",
+    [OP_CLOSE_UP_VALUE] = "cl_up_v",
+    [OP_GET_PROPERTY] = "g_prop",
+    [OP_GET_SELF_PROPERTY] = "g_props",
+    [OP_SET_PROPERTY] = "s_prop",
+    [OP_JUMP_IF_FALSE] = "f_jump",
+    [OP_JUMP] = "jump",
+    [OP_LOOP] = "loop",
+    [OP_EQUAL] = "eq",
+    [OP_GREATER] = "gt",
+    [OP_LESS] = "less",
+    [OP_EMPTY] = "em",
+    [OP_NIL] = "nil",
+    [OP_TRUE] = "true",
+    [OP_FALSE] = "false",
+    [OP_ADD] = "add",
+    [OP_SUBTRACT] = "sub",
+    [OP_MULTIPLY] = "mul",
+    [OP_DIVIDE] = "div",
+    [OP_F_DIVIDE] = "f_div",
+    [OP_REMINDER] = "r_mod",
+    [OP_POW] = "pow",
+    [OP_NEGATE] = "neg",
+    [OP_NOT] = "not",
+    [OP_BIT_NOT] = "b_not",
+    [OP_AND] = "b_and",
+    [OP_OR] = "b_or",
+    [OP_XOR] = "b_xor",
+    [OP_LSHIFT] = "l_shift",
+    [OP_RSHIFT] = "r_shift",
+    [OP_ONE] = "one",
+    [OP_CONSTANT] = "load",
+    [OP_ECHO] = "echo",
+    [OP_POP] = "pop",
+    [OP_DUP] = "dup",
+    [OP_POP_N] = "pop_n",
+    [OP_ASSERT] = "assrt",
+    [OP_DIE] = "die",
+    [OP_CLOSURE] = "clsur",
+    [OP_CALL] = "call",
+    [OP_INVOKE] = "invk",
+    [OP_INVOKE_SELF] = "invk_s",
+    [OP_TAIL_CALL] = "t_call",
+    [OP_TAIL_INVOKE] = "t_invk",
+    [OP_TAIL_INVOKE_SELF] = "t_invk_s",
+    [OP_RETURN] = "ret",
+    [OP_CLASS] = "class",
+    [OP_METHOD] = "meth",
+    [OP_CLASS_PROPERTY] = "cl_prop",
+    [OP_END_CLASS] = "e_class",
+    [OP_INHERIT] = "inher",
+    [OP_GET_SUPER] = "g_sup",
+    [OP_SUPER_INVOKE] = "s_invk",
+    [OP_SUPER_INVOKE_SELF] = "s_invk_s",
+    [OP_RANGE] = "rng",
+    [OP_LIST] = "list",
+    [OP_DICT] = "dict",
+    [OP_GET_INDEX] = "g_ind",
+    [OP_GET_RANGED_INDEX] = "gr_ind",
+    [OP_SET_INDEX] = "s_ind",
+    [OP_CALL_IMPORT] = "c_import",
+    [OP_NATIVE_MODULE] = "f_import",
+    [OP_SELECT_IMPORT] = "s_import",
+    [OP_SELECT_NATIVE_IMPORT] = "sn_import",
+    [OP_IMPORT_ALL_NATIVE] = "an_import",
+    [OP_EJECT_IMPORT] = "e_import",
+    [OP_EJECT_NATIVE_IMPORT] = "en_import",
+    [OP_IMPORT_ALL] = "a_import",
+    [OP_TRY] = "i_try",
+    [OP_POP_TRY] = "p_try",
+    [OP_PUBLISH_TRY] = "pub_try",
+    [OP_STRINGIFY] = "str",
+    [OP_SWITCH] = "sw",
+    [OP_CHOICE] = "cho",
+    [OP_EQUAL_NUM] = "eq_n",
+    [OP_GREATER_NUM] = "gt_n",
+    [OP_LESS_NUM] = "less_n",
+    [OP_ADD_NUM] = "add_n",
+    [OP_SUBTRACT_NUM] = "sub_n",
+    [OP_MULTIPLY_NUM] = "mul_n",
+    [OP_ADD_LOCALS] = "g_loc_add",
+    [OP_LESS_CONSTANT_JUMP] = "g_loc_lt_jmp",
+    [OP_GET_LOCAL_PROPERTY] = "g_loc_prop",
+    [OP_GET_LOCAL_INVOKE] = "g_loc_invk",
+    [OP_ARITH_LOCALS] = "r_arith",
+    [OP_ARITH_CONSTANT] = "r_arith_k",
+    [OP_INCREMENT_LOCAL] = "r_inc",
+    [OP_MOVE_LOCAL] = "r_mov",
+    [OP_STORE_LOCAL] = "r_store",
+    [OP_BREAK_PL] = "brk",
+};
+
+b_op_profile *new_op_profile() {
+  b_op_profile *profile = (b_op_profile *) calloc(1, sizeof(b_op_profile));
+  if (profile == NULL) return NULL;
+
+  profile->pairs = (uint64_t *) calloc(OPCODE_COUNT * OPCODE_COUNT, sizeof(uint64_t));
+  profile->triples = (uint64_t *) calloc(OPCODE_COUNT * OPCODE_COUNT * OPCODE_COUNT, sizeof(uint64_t));
+  if (profile->pairs == NULL || profile->triples == NULL) {
+    free_op_profile(profile);
+    return NULL;
+  }
+  return profile;
+}
+
+void free_op_profile(b_op_profile *profile) {
+  if (profile != NULL) {
+    free(profile->pairs);
+    free(profile->triples);
+    free(profile);
+  }
+}
+
+typedef struct {
+  int index;
+  uint64_t count;
+} b_op_count;
+
+static int compare_op_counts(const void *a, const void *b) {
+  uint64_t x = ((const b_op_count *) a)->count, y = ((const b_op_count *) b)->count;
+  return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+static void print_top_sequences(const char *title, uint64_t *counts, int total, int length) {
+  int found = 0;
+  uint64_t sum = 0;
+  for (int i = 0; i < total; i++) {
+    if (counts[i] > 0) {
+      found++;
+      sum += counts[i];
+    }
+  }
+
+  b_op_count *sorted = (b_op_count *) malloc(sizeof(b_op_count) * (found > 0 ? found : 1));
+  if (sorted == NULL) return;
+
+  for (int i = 0, j = 0; i < total; i++) {
+    if (counts[i] > 0) {
+      sorted[j].index = i;
+      sorted[j++].count = counts[i];
+    }
+  }
+  qsort(sorted, found, sizeof(b_op_count), compare_op_counts);
+
+  fprintf(stderr, "== %s ==\n", title);
+  for (int i = 0; i < found && i < OP_PROFILE_TOP; i++) {
+    int codes[3], index = sorted[i].index;
+    for (int j = length - 1; j >= 0; j--) {
+      codes[j] = index % OPCODE_COUNT;
+      index /= OPCODE_COUNT;
+    }
+
+    fprintf(stderr, "%14llu %6.2f%%  ", (unsigned long long) sorted[i].count,
+            100.0 * (double) sorted[i].count / (double) sum);
+    for (int j = 0; j < length; j++) {
+      const char *name = opcode_names[codes[j]];
+      fprintf(stderr, j == 0 ? "%s" : ", %s", name != NULL ? name : "?");
+    }
+    fprintf(stderr, "\n");
+  }
+
+  free(sorted);
+}
+
+void print_op_profile(b_op_profile *profile) {
+  print_top_sequences("opcode pairs", profile->pairs, OPCODE_COUNT * OPCODE_COUNT, 2);
+  print_top_sequences("opcode triples", profile->triples,
+                      OPCODE_COUNT * OPCODE_COUNT * OPCODE_COUNT, 3);
+}
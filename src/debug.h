@@ -3,8 +3,39 @@
 
 #include "blob.h"
 
+#define OPCODE_COUNT (OP_BREAK_PL + 1)
+
+// counts of the opcode pairs and triples executed by the vm.
+typedef struct {
+  int seen;
+  uint8_t previous[2];
+  uint64_t *pairs;
+  uint64_t *triples;
+} b_op_profile;
+
 void disassemble_blob(b_blob *blob, const char *name);
 
 int disassemble_instruction(b_blob *blob, int offset);
 
+b_op_profile *new_op_profile();
+
+void free_op_profile(b_op_profile *profile);
+
+static inline void profile_opcode(b_op_profile *profile, uint8_t code) {
+  uint8_t a = profile->previous[0], b = profile->previous[1];
+  if (profile->seen > 0) {
+    profile->pairs[b * OPCODE_COUNT + code]++;
+  }
+  if (profile->seen > 1) {
+    profile->triples[(a * OPCODE_COUNT + b) * OPCODE_COUNT + code]++;
+  }
+  profile->previous[0] = b;
+  profile->previous[1] = code;
+  if (profile->seen < 2) {
+    profile->seen++;
+  }
+}
+
+void print_op_profile(b_op_profile *profile);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,743 @@
+#include "jit.h"
+#include "blade_set.h"
+#include "compiler.h"
+#include "memory.h"
+#include "vm.h"
+
+#include <math.h>
+
+// the templates rely on numbers being stored as plain doubles, so the
+// jit is only available with nan boxing on a target sljit supports.
+#if defined(USE_NAN_BOXING) && USE_NAN_BOXING
+
+#define SLJIT_CONFIG_AUTO 1
+#define SLJIT_CONFIG_STATIC 1
+#define SLJIT_VERBOSE 0
+#define SLJIT_DEBUG 0
+
+#include "pcre/sljit/sljitLir.c"
+
+#if !(defined SLJIT_CONFIG_UNSUPPORTED && SLJIT_CONFIG_UNSUPPORTED)
+#define CAN_JIT 1
+#endif
+
+#endif
+
+#if defined(CAN_JIT)
+
+// registers that live for the whole of the generated code.
+#define R_VM SLJIT_S0
+#define R_SLOTS SLJIT_S1
+#define R_TOP SLJIT_S2
+
+// operands for the value n places below the stack top (0 is the free
+// slot at the top), a frame slot and an immediate value.
+#define STACK(n) SLJIT_MEM1(R_TOP), (-(sljit_sw) (n) * (sljit_sw) sizeof(b_value))
+#define SLOT(n) SLJIT_MEM1(R_SLOTS), ((sljit_sw) (n) * (sljit_sw) sizeof(b_value))
+#define IMM(v) SLJIT_IMM, ((sljit_sw) (v))
+
+typedef sljit_sw (SLJIT_FUNC *b_jit_function)(sljit_sw vm, sljit_sw slots, sljit_sw entry);
+
+typedef struct {
+  struct sljit_jump *jump;
+  int offset; // bytecode offset the jump goes to
+} b_jit_patch;
+
+typedef struct {
+  int count;
+  int capacity;
+  b_jit_patch *patches;
+} b_jit_patches;
+
+typedef struct {
+  b_vm *vm;
+  struct sljit_compiler *compiler;
+  b_obj_func *function;
+  b_blob *blob;
+  struct sljit_label **labels; // one per bytecode offset
+  b_jit_patches jumps;         // jumps between instructions
+  b_jit_patches exits;         // jumps back to the interpreter
+} b_jit_state;
+
+/*
+ * runtime helpers called from the generated code.
+ *
+ * each one gets the stack top and returns 0 when it cannot handle the
+ * values it finds there, in which case the interpreter runs the
+ * instruction instead and reports any error.
+ */
+
+static sljit_sw SLJIT_FUNC jit_is_false(b_value *top, sljit_sw unused) {
+  return is_false(top[-1]);
+}
+
+static sljit_sw SLJIT_FUNC jit_not(b_value *top, sljit_sw unused) {
+  top[-1] = BOOL_VAL(is_false(top[-1]));
+  return 1;
+}
+
+static sljit_sw SLJIT_FUNC jit_equal(b_value *top, sljit_sw unused) {
+  b_value a = top[-2], b = top[-1];
+  if (IS_SET(a) && IS_SET(b)) {
+    top[-2] = BOOL_VAL(sets_equal(AS_SET(a), AS_SET(b)));
+  } else {
+    top[-2] = BOOL_VAL(values_equal(a, b));
+  }
+  return 1;
+}
+
+static sljit_sw SLJIT_FUNC jit_choice(b_value *top, sljit_sw unused) {
+  top[-3] = !is_false(top[-3]) ? top[-2] : top[-1];
+  return 1;
+}
+
+static sljit_sw SLJIT_FUNC jit_number_op(b_value *top, sljit_sw op) {
+  if (!IS_NUMBER(top[-2]) || !IS_NUMBER(top[-1]))
+    return 0;
+
+  double a = AS_NUMBER(top[-2]), b = AS_NUMBER(top[-1]);
+  switch (op) {
+    case OP_REMINDER:
+      top[-2] = NUMBER_VAL(fmod(a, b));
+      return 1;
+    case OP_POW:
+      top[-2] = NUMBER_VAL(pow(a, b));
+      return 1;
+    case OP_AND:
+      top[-2] = NUMBER_VAL((double) ((int) a & (int) b));
+      return 1;
+    case OP_OR:
+      top[-2] = NUMBER_VAL((double) ((int) a | (int) b));
+      return 1;
+    case OP_XOR:
+      top[-2] = NUMBER_VAL((double) ((int) a ^ (int) b));
+      return 1;
+    case OP_LSHIFT:
+      top[-2] = NUMBER_VAL((double) ((int) a << (int) b));
+      return 1;
+    case OP_RSHIFT:
+      top[-2] = NUMBER_VAL((double) ((int) a >> (int) b));
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+static sljit_sw SLJIT_FUNC jit_get_index(b_value *top, sljit_sw will_assign) {
+  if (!IS_LIST(top[-2]) || !IS_NUMBER(top[-1]))
+    return 0;
+
+  b_obj_list *list = AS_LIST(top[-2]);
+  int index = AS_NUMBER(top[-1]);
+  if (index < 0)
+    index = list->items.count + index;
+  if (index < 0 || index >= list->items.count)
+    return 0;
+
+  if (will_assign) {
+    top[0] = list->items.values[index];
+  } else {
+    top[-2] = list->items.values[index];
+  }
+  return 1;
+}
+
+static sljit_sw SLJIT_FUNC jit_set_index(b_value *top, sljit_sw unused) {
+  if (!IS_LIST(top[-3]) || !IS_NUMBER(top[-2]))
+    return 0;
+
+  // shared lists are copied out by the interpreter.
+  b_obj_list *list = AS_LIST(top[-3]);
+  if (list->owner != NULL)
+    return 0;
+
+  int index = AS_NUMBER(top[-2]);
+  if (index < 0)
+    index = list->items.count + index;
+  if (index < 0 || index >= list->items.count)
+    return 0;
+
+  list->items.values[index] = top[-1];
+  top[-3] = top[-1];
+  return 1;
+}
+
+// module variables. builtins and missing names are left to the
+// interpreter, which also remembers where the name is in the table.
+static sljit_sw SLJIT_FUNC jit_get_global(b_value *top, sljit_sw table, sljit_sw name) {
+  return table_get((b_table *) table, OBJ_VAL((b_obj_string *) name), &top[0]);
+}
+
+// fields of instances. methods, private names and stack traces, which
+// are formatted on first use, go through the interpreter.
+static sljit_sw SLJIT_FUNC jit_get_property(b_value *top, sljit_sw name, sljit_sw is_self) {
+  b_obj_string *string = (b_obj_string *) name;
+  if (!IS_INSTANCE(top[-1]) || (!is_self && string->chars[0] == '_'))
+    return 0;
+
+  b_value value;
+  if (!table_get(&AS_INSTANCE(top[-1])->properties, OBJ_VAL(string), &value) ||
+      IS_STACK_TRACE(value))
+    return 0;
+
+  top[-1] = value;
+  return 1;
+}
+
+// assignments to fields an instance already has. new fields may grow
+// the table, which could collect garbage while the stack top is only
+// known to the generated code, so the interpreter adds those.
+static sljit_sw SLJIT_FUNC jit_set_property(b_value *top, sljit_sw name, sljit_sw unused) {
+  if (!IS_INSTANCE(top[-2]))
+    return 0;
+
+  b_table *properties = &AS_INSTANCE(top[-2])->properties;
+  int index = table_find_slot(properties, OBJ_VAL((b_obj_string *) name));
+  if (index == -1)
+    return 0;
+
+  properties->entries[index].value = top[-1];
+  top[-2] = top[-1];
+  return 1;
+}
+
+/*
+ * code generation.
+ */
+
+static void add_patch(b_vm *vm, b_jit_patches *patches, struct sljit_jump *jump, int offset) {
+  if (patches->capacity < patches->count + 1) {
+    int old_capacity = patches->capacity;
+    patches->capacity = GROW_CAPACITY(old_capacity);
+    patches->patches = GROW_ARRAY(b_jit_patch, patches->patches, old_capacity, patches->capacity);
+  }
+  patches->patches[patches->count].jump = jump;
+  patches->patches[patches->count].offset = offset;
+  patches->count++;
+}
+
+static inline void jump_to(b_jit_state *state, struct sljit_jump *jump, int offset) {
+  add_patch(state->vm, &state->jumps, jump, offset);
+}
+
+static inline void exit_to(b_jit_state *state, struct sljit_jump *jump, int offset) {
+  add_patch(state->vm, &state->exits, jump, offset);
+}
+
+// maps superinstructions and quickened instructions to the instruction
+// whose template runs them. only the first instruction of a fused
+// sequence changes, so its template is that of the original.
+static uint8_t template_of(uint8_t code) {
+  switch (code) {
+    case OP_ADD_LOCALS:
+    case OP_LESS_CONSTANT_JUMP:
+    case OP_GET_LOCAL_PROPERTY:
+    case OP_GET_LOCAL_INVOKE:
+    case OP_ARITH_LOCALS:
+    case OP_ARITH_CONSTANT:
+    case OP_INCREMENT_LOCAL:
+    case OP_MOVE_LOCAL:
+      return OP_GET_LOCAL;
+    case OP_STORE_LOCAL:
+      return OP_SET_LOCAL;
+    case OP_EQUAL_NUM:
+      return OP_EQUAL;
+    case OP_GREATER_NUM:
+      return OP_GREATER;
+    case OP_LESS_NUM:
+      return OP_LESS;
+    case OP_ADD_NUM:
+      return OP_ADD;
+    case OP_SUBTRACT_NUM:
+      return OP_SUBTRACT;
+    case OP_MULTIPLY_NUM:
+      return OP_MULTIPLY;
+    default:
+      return code;
+  }
+}
+
+static bool has_template(uint8_t code) {
+  switch (template_of(code)) {
+    case OP_GET_LOCAL:
+    case OP_SET_LOCAL:
+    case OP_CONSTANT:
+    case OP_NIL:
+    case OP_EMPTY:
+    case OP_TRUE:
+    case OP_FALSE:
+    case OP_ONE:
+    case OP_POP:
+    case OP_POP_N:
+    case OP_DUP:
+    case OP_ADD:
+    case OP_SUBTRACT:
+    case OP_MULTIPLY:
+    case OP_DIVIDE:
+    case OP_NEGATE:
+    case OP_REMINDER:
+    case OP_POW:
+    case OP_AND:
+    case OP_OR:
+    case OP_XOR:
+    case OP_LSHIFT:
+    case OP_RSHIFT:
+    case OP_EQUAL:
+    case OP_GREATER:
+    case OP_LESS:
+    case OP_NOT:
+    case OP_CHOICE:
+    case OP_JUMP:
+    case OP_JUMP_IF_FALSE:
+    case OP_LOOP:
+    case OP_GET_INDEX:
+    case OP_SET_INDEX:
+    case OP_GET_GLOBAL:
+    case OP_GET_PROPERTY:
+    case OP_GET_SELF_PROPERTY:
+    case OP_SET_PROPERTY:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static inline uint16_t read_short(const uint8_t *code, int offset) {
+  return (uint16_t) ((code[offset] << 8) | code[offset + 1]);
+}
+
+static void emit_push(struct sljit_compiler *c, sljit_s32 src, sljit_sw srcw) {
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, src, srcw);
+  sljit_emit_op1(c, SLJIT_MOV, STACK(0), SLJIT_R0, 0);
+  sljit_emit_op2(c, SLJIT_ADD, R_TOP, 0, R_TOP, 0, IMM(sizeof(b_value)));
+}
+
+static inline void emit_drop(struct sljit_compiler *c, int count) {
+  sljit_emit_op2(c, SLJIT_SUB, R_TOP, 0, R_TOP, 0, IMM(count * sizeof(b_value)));
+}
+
+// leaves for the interpreter when the value n below the top is not a number.
+static void emit_number_guard(b_jit_state *state, int n, int offset) {
+  struct sljit_compiler *c = state->compiler;
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, STACK(n));
+  sljit_emit_op2(c, SLJIT_AND, SLJIT_R0, 0, SLJIT_R0, 0, IMM(QNAN));
+  exit_to(state, sljit_emit_cmp(c, SLJIT_EQUAL, SLJIT_R0, 0, IMM(QNAN)), offset);
+}
+
+// calls a runtime helper and leaves for the interpreter if it gives up.
+static void emit_helper(b_jit_state *state, void *helper, sljit_sw arg, int offset) {
+  struct sljit_compiler *c = state->compiler;
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, R_TOP, 0);
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R1, 0, IMM(arg));
+  sljit_emit_icall(c, SLJIT_CALL, SLJIT_RET(SW) | SLJIT_ARG1(SW) | SLJIT_ARG2(SW),
+                   SLJIT_IMM, SLJIT_FUNC_OFFSET(helper));
+  exit_to(state, sljit_emit_cmp(c, SLJIT_EQUAL, SLJIT_R0, 0, IMM(0)), offset);
+}
+
+// same as emit_helper, for helpers that take a second argument.
+static void emit_helper2(b_jit_state *state, void *helper, sljit_sw arg, sljit_sw arg2, int offset) {
+  struct sljit_compiler *c = state->compiler;
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, R_TOP, 0);
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R1, 0, IMM(arg));
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R2, 0, IMM(arg2));
+  sljit_emit_icall(c, SLJIT_CALL, SLJIT_RET(SW) | SLJIT_ARG1(SW) | SLJIT_ARG2(SW) | SLJIT_ARG3(SW),
+                   SLJIT_IMM, SLJIT_FUNC_OFFSET(helper));
+  exit_to(state, sljit_emit_cmp(c, SLJIT_EQUAL, SLJIT_R0, 0, IMM(0)), offset);
+}
+
+static void emit_arithmetic(b_jit_state *state, sljit_s32 op, int offset) {
+  struct sljit_compiler *c = state->compiler;
+  emit_number_guard(state, 1, offset);
+  emit_number_guard(state, 2, offset);
+  sljit_emit_fop1(c, SLJIT_MOV_F64, SLJIT_FR0, 0, STACK(2));
+  sljit_emit_fop2(c, op, SLJIT_FR0, 0, SLJIT_FR0, 0, STACK(1));
+  sljit_emit_fop1(c, SLJIT_MOV_F64, STACK(2), SLJIT_FR0, 0);
+  emit_drop(c, 1);
+}
+
+// a > b, with a and b as the values n and m below the top. unordered
+// operands compare false here just like they do in C.
+static void emit_greater(b_jit_state *state, int a, int b, int offset) {
+  struct sljit_compiler *c = state->compiler;
+  emit_number_guard(state, 1, offset);
+  emit_number_guard(state, 2, offset);
+  sljit_emit_fop1(c, SLJIT_MOV_F64, SLJIT_FR0, 0, STACK(a));
+  sljit_emit_fop1(c, SLJIT_CMP_F64 | SLJIT_SET_GREATER_F, SLJIT_FR0, 0, STACK(b));
+  sljit_emit_op_flags(c, SLJIT_MOV, SLJIT_R0, 0, SLJIT_GREATER_F64);
+  sljit_emit_op2(c, SLJIT_OR, SLJIT_R0, 0, SLJIT_R0, 0, IMM(FALSE_VAL));
+  sljit_emit_op1(c, SLJIT_MOV, STACK(2), SLJIT_R0, 0);
+  emit_drop(c, 1);
+}
+
+static void emit_equal(b_jit_state *state, int offset) {
+  struct sljit_compiler *c = state->compiler;
+
+  // anything but a pair of numbers goes through values_equal().
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, STACK(1));
+  sljit_emit_op2(c, SLJIT_AND, SLJIT_R0, 0, SLJIT_R0, 0, IMM(QNAN));
+  struct sljit_jump *first = sljit_emit_cmp(c, SLJIT_EQUAL, SLJIT_R0, 0, IMM(QNAN));
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, STACK(2));
+  sljit_emit_op2(c, SLJIT_AND, SLJIT_R0, 0, SLJIT_R0, 0, IMM(QNAN));
+  struct sljit_jump *second = sljit_emit_cmp(c, SLJIT_EQUAL, SLJIT_R0, 0, IMM(QNAN));
+
+  sljit_emit_fop1(c, SLJIT_MOV_F64, SLJIT_FR0, 0, STACK(2));
+  sljit_emit_fop1(c, SLJIT_CMP_F64 | SLJIT_SET_EQUAL_F, SLJIT_FR0, 0, STACK(1));
+  sljit_emit_op_flags(c, SLJIT_MOV, SLJIT_R0, 0, SLJIT_EQUAL_F64);
+  sljit_emit_op_flags(c, SLJIT_AND, SLJIT_R0, 0, SLJIT_ORDERED_F64);
+  sljit_emit_op2(c, SLJIT_OR, SLJIT_R0, 0, SLJIT_R0, 0, IMM(FALSE_VAL));
+  sljit_emit_op1(c, SLJIT_MOV, STACK(2), SLJIT_R0, 0);
+  struct sljit_jump *done = sljit_emit_jump(c, SLJIT_JUMP);
+
+  struct sljit_label *slow = sljit_emit_label(c);
+  sljit_set_label(first, slow);
+  sljit_set_label(second, slow);
+  emit_helper(state, (void *) jit_equal, 0, offset);
+
+  sljit_set_label(done, sljit_emit_label(c));
+  emit_drop(c, 1);
+}
+
+static void emit_not(b_jit_state *state, int offset) {
+  struct sljit_compiler *c = state->compiler;
+
+  // booleans only need their lowest bit flipped.
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, STACK(1));
+  sljit_emit_op2(c, SLJIT_OR, SLJIT_R1, 0, SLJIT_R0, 0, IMM(1));
+  struct sljit_jump *slow = sljit_emit_cmp(c, SLJIT_NOT_EQUAL, SLJIT_R1, 0, IMM(TRUE_VAL));
+  sljit_emit_op2(c, SLJIT_XOR, SLJIT_R0, 0, SLJIT_R0, 0, IMM(1));
+  sljit_emit_op1(c, SLJIT_MOV, STACK(1), SLJIT_R0, 0);
+  struct sljit_jump *done = sljit_emit_jump(c, SLJIT_JUMP);
+
+  sljit_set_label(slow, sljit_emit_label(c));
+  emit_helper(state, (void *) jit_not, 0, offset);
+  sljit_set_label(done, sljit_emit_label(c));
+}
+
+static void emit_jump_if_false(b_jit_state *state, int target) {
+  struct sljit_compiler *c = state->compiler;
+
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, STACK(1));
+  struct sljit_jump *truthy = sljit_emit_cmp(c, SLJIT_EQUAL, SLJIT_R0, 0, IMM(TRUE_VAL));
+  jump_to(state, sljit_emit_cmp(c, SLJIT_EQUAL, SLJIT_R0, 0, IMM(FALSE_VAL)), target);
+
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, R_TOP, 0);
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R1, 0, IMM(0));
+  sljit_emit_icall(c, SLJIT_CALL, SLJIT_RET(SW) | SLJIT_ARG1(SW) | SLJIT_ARG2(SW),
+                   SLJIT_IMM, SLJIT_FUNC_OFFSET(jit_is_false));
+  jump_to(state, sljit_emit_cmp(c, SLJIT_NOT_EQUAL, SLJIT_R0, 0, IMM(0)), target);
+
+  sljit_set_label(truthy, sljit_emit_label(c));
+}
+
+static void emit_instruction(b_jit_state *state, int offset) {
+  struct sljit_compiler *c = state->compiler;
+  const uint8_t *code = state->blob->code;
+  const b_value *constants = state->blob->constants.values;
+  uint8_t instruction = template_of(code[offset]);
+
+  switch (instruction) {
+    case OP_GET_LOCAL:
+      emit_push(c, SLOT(read_short(code, offset + 1)));
+      break;
+    case OP_SET_LOCAL:
+      sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, STACK(1));
+      sljit_emit_op1(c, SLJIT_MOV, SLOT(read_short(code, offset + 1)), SLJIT_R0, 0);
+      break;
+    case OP_CONSTANT:
+      emit_push(c, IMM(constants[read_short(code, offset + 1)]));
+      break;
+    case OP_NIL:
+      emit_push(c, IMM(NIL_VAL));
+      break;
+    case OP_EMPTY:
+      emit_push(c, IMM(EMPTY_VAL));
+      break;
+    case OP_TRUE:
+      emit_push(c, IMM(TRUE_VAL));
+      break;
+    case OP_FALSE:
+      emit_push(c, IMM(FALSE_VAL));
+      break;
+    case OP_ONE:
+      emit_push(c, IMM(NUMBER_VAL(1)));
+      break;
+    case OP_POP:
+      emit_drop(c, 1);
+      break;
+    case OP_POP_N:
+      emit_drop(c, read_short(code, offset + 1));
+      break;
+    case OP_DUP:
+      emit_push(c, STACK(1));
+      break;
+
+    case OP_ADD:
+      emit_arithmetic(state, SLJIT_ADD_F64, offset);
+      break;
+    case OP_SUBTRACT:
+      emit_arithmetic(state, SLJIT_SUB_F64, offset);
+      break;
+    case OP_MULTIPLY:
+      emit_arithmetic(state, SLJIT_MUL_F64, offset);
+      break;
+    case OP_DIVIDE:
+      emit_arithmetic(state, SLJIT_DIV_F64, offset);
+      break;
+    case OP_NEGATE:
+      emit_number_guard(state, 1, offset);
+      sljit_emit_fop1(c, SLJIT_NEG_F64, STACK(1), STACK(1));
+      break;
+    case OP_REMINDER:
+    case OP_POW:
+    case OP_AND:
+    case OP_OR:
+    case OP_XOR:
+    case OP_LSHIFT:
+    case OP_RSHIFT:
+      emit_helper(state, (void *) jit_number_op, instruction, offset);
+      emit_drop(c, 1);
+      break;
+
+    case OP_EQUAL:
+      emit_equal(state, offset);
+      break;
+    case OP_GREATER:
+      emit_greater(state, 2, 1, offset);
+      break;
+    case OP_LESS:
+      emit_greater(state, 1, 2, offset);
+      break;
+    case OP_NOT:
+      emit_not(state, offset);
+      break;
+    case OP_CHOICE:
+      emit_helper(state, (void *) jit_choice, 0, offset);
+      emit_drop(c, 2);
+      break;
+
+    case OP_JUMP:
+      jump_to(state, sljit_emit_jump(c, SLJIT_JUMP), offset + 3 + read_short(code, offset + 1));
+      break;
+    case OP_JUMP_IF_FALSE:
+      emit_jump_if_false(state, offset + 3 + read_short(code, offset + 1));
+      break;
+    case OP_LOOP:
+      jump_to(state, sljit_emit_jump(c, SLJIT_JUMP), offset + 3 - read_short(code, offset + 1));
+      break;
+
+    case OP_GET_INDEX: {
+      bool will_assign = code[offset + 1] == 1;
+      emit_helper(state, (void *) jit_get_index, will_assign, offset);
+      if (will_assign) {
+        sljit_emit_op2(c, SLJIT_ADD, R_TOP, 0, R_TOP, 0, IMM(sizeof(b_value)));
+      } else {
+        emit_drop(c, 1);
+      }
+      break;
+    }
+    case OP_SET_INDEX:
+      emit_helper(state, (void *) jit_set_index, 0, offset);
+      emit_drop(c, 2);
+      break;
+
+    case OP_GET_GLOBAL:
+      emit_helper2(state, (void *) jit_get_global,
+                   (sljit_sw) &state->function->module->values,
+                   (sljit_sw) AS_OBJ(constants[read_short(code, offset + 1)]), offset);
+      sljit_emit_op2(c, SLJIT_ADD, R_TOP, 0, R_TOP, 0, IMM(sizeof(b_value)));
+      break;
+    case OP_GET_PROPERTY:
+    case OP_GET_SELF_PROPERTY:
+      emit_helper2(state, (void *) jit_get_property,
+                   (sljit_sw) AS_OBJ(constants[read_short(code, offset + 1)]),
+                   instruction == OP_GET_SELF_PROPERTY, offset);
+      break;
+    case OP_SET_PROPERTY:
+      emit_helper2(state, (void *) jit_set_property,
+                   (sljit_sw) AS_OBJ(constants[read_short(code, offset + 1)]), 0, offset);
+      emit_drop(c, 1);
+      break;
+
+    default:
+      // no template, so the interpreter takes over from here.
+      exit_to(state, sljit_emit_jump(c, SLJIT_JUMP), offset);
+      break;
+  }
+}
+
+/**
+ * marks the start of every loop whose body only contains instructions
+ * with a template as an entry point. loops that would leave for the
+ * interpreter on every iteration are not worth entering.
+ */
+static int find_entries(b_blob *blob, const bool *supported, bool *is_entry) {
+  int entries = 0;
+
+  for (int offset = 0; offset < blob->count;) {
+    if (blob->code[offset] == OP_LOOP) {
+      int start = offset + 3 - read_short(blob->code, offset + 1);
+      bool can_enter = true;
+      for (int i = start; i <= offset && can_enter;) {
+        can_enter = supported[i];
+        i += 1 + get_code_args_count(blob->code, blob->constants.values, i);
+      }
+      if (can_enter && !is_entry[start]) {
+        is_entry[start] = true;
+        entries++;
+      }
+    }
+    offset += 1 + get_code_args_count(blob->code, blob->constants.values, offset);
+  }
+  return entries;
+}
+
+static void *generate(b_jit_state *state, const bool *supported) {
+  b_vm *vm = state->vm;
+  struct sljit_compiler *c = state->compiler;
+  b_blob *blob = state->blob;
+
+  // fn(vm, slots, entry): load the stack top and jump to the entry.
+  sljit_emit_enter(c, 0, SLJIT_RET(SW) | SLJIT_ARG1(SW) | SLJIT_ARG2(SW) | SLJIT_ARG3(SW),
+                   3, 3, 2, 0, 0);
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, R_TOP, 0);
+  sljit_emit_op1(c, SLJIT_MOV, R_TOP, 0, SLJIT_MEM1(R_VM), offsetof(b_vm, stack_top));
+  sljit_emit_ijump(c, SLJIT_JUMP, SLJIT_R0, 0);
+
+  for (int offset = 0; offset < blob->count;) {
+    state->labels[offset] = sljit_emit_label(c);
+    if (supported[offset]) {
+      emit_instruction(state, offset);
+    } else {
+      exit_to(state, sljit_emit_jump(c, SLJIT_JUMP), offset);
+    }
+    offset += 1 + get_code_args_count(blob->code, blob->constants.values, offset);
+  }
+
+  // running off the end of the code can't happen as every function
+  // ends with a return, but jumps may still target this offset.
+  state->labels[blob->count] = sljit_emit_label(c);
+  exit_to(state, sljit_emit_jump(c, SLJIT_JUMP), blob->count);
+
+  for (int i = 0; i < state->jumps.count; i++) {
+    sljit_set_label(state->jumps.patches[i].jump, state->labels[state->jumps.patches[i].offset]);
+  }
+
+  // every exit stores the stack top and returns the offset the
+  // interpreter continues from.
+  struct sljit_jump **to_return = ALLOCATE(struct sljit_jump *, state->exits.count + 1);
+  for (int i = 0; i < state->exits.count; i++) {
+    sljit_set_label(state->exits.patches[i].jump, sljit_emit_label(c));
+    sljit_emit_op1(c, SLJIT_MOV, SLJIT_R0, 0, IMM(state->exits.patches[i].offset));
+    to_return[i] = sljit_emit_jump(c, SLJIT_JUMP);
+  }
+
+  struct sljit_label *exit = sljit_emit_label(c);
+  for (int i = 0; i < state->exits.count; i++) {
+    sljit_set_label(to_return[i], exit);
+  }
+  FREE_ARRAY(struct sljit_jump *, to_return, state->exits.count + 1);
+
+  sljit_emit_op1(c, SLJIT_MOV, SLJIT_MEM1(R_VM), offsetof(b_vm, stack_top), R_TOP, 0);
+  sljit_emit_return(c, SLJIT_MOV, SLJIT_R0, 0);
+
+  return sljit_generate_code(c);
+}
+
+bool jit_is_supported() {
+  return true;
+}
+
+void jit_compile(b_vm *vm, b_obj_func *function) {
+  b_jit_code *jit = ALLOCATE(b_jit_code, 1);
+  jit->code = NULL;
+  jit->entries = NULL;
+  jit->count = 0;
+  jit->max_push = 0;
+  function->jit = jit;
+
+  b_blob *blob = &function->blob;
+  bool *supported = ALLOCATE(bool, blob->count + 1);
+  bool *is_entry = ALLOCATE(bool, blob->count + 1);
+  memset(supported, 0, sizeof(bool) * (blob->count + 1));
+  memset(is_entry, 0, sizeof(bool) * (blob->count + 1));
+
+  for (int offset = 0; offset < blob->count;) {
+    supported[offset] = has_template(blob->code[offset]);
+    if (supported[offset]) {
+      // no template pushes more than one value.
+      jit->max_push++;
+    }
+    offset += 1 + get_code_args_count(blob->code, blob->constants.values, offset);
+  }
+
+  if (find_entries(blob, supported, is_entry) > 0) {
+    b_jit_state state = {
+        .vm = vm,
+        .compiler = sljit_create_compiler(NULL),
+        .function = function,
+        .blob = blob,
+        .labels = ALLOCATE(struct sljit_label *, blob->count + 1),
+        .jumps = {0, 0, NULL},
+        .exits = {0, 0, NULL},
+    };
+
+    if (state.compiler != NULL) {
+      jit->code = generate(&state, supported);
+
+      // labels are owned by the compiler, so read them out before it goes.
+      if (jit->code != NULL) {
+        jit->count = blob->count;
+        jit->entries = ALLOCATE(void *, jit->count);
+        for (int offset = 0; offset < jit->count; offset++) {
+          jit->entries[offset] = is_entry[offset] ? (void *) sljit_get_label_addr(state.labels[offset]) : NULL;
+        }
+      }
+      sljit_free_compiler(state.compiler);
+    }
+
+    FREE_ARRAY(struct sljit_label *, state.labels, blob->count + 1);
+    FREE_ARRAY(b_jit_patch, state.jumps.patches, state.jumps.capacity);
+    FREE_ARRAY(b_jit_patch, state.exits.patches, state.exits.capacity);
+  }
+
+  FREE_ARRAY(bool, supported, blob->count + 1);
+  FREE_ARRAY(bool, is_entry, blob->count + 1);
+}
+
+int jit_execute(b_vm *vm, b_jit_code *jit, b_value *slots, int offset) {
+  b_jit_function function = (b_jit_function) jit->code;
+  return (int) function((sljit_sw) vm, (sljit_sw) slots, (sljit_sw) jit->entries[offset]);
+}
+
+void jit_free(b_vm *vm, b_jit_code *jit) {
+  if (jit->code != NULL) {
+    sljit_free_code(jit->code);
+    FREE_ARRAY(void *, jit->entries, jit->count);
+  }
+  FREE(b_jit_code, jit);
+}
+
+#else
+
+bool jit_is_supported() {
+  return false;
+}
+
+void jit_compile(b_vm *vm, b_obj_func *function) {
+  b_jit_code *jit = ALLOCATE(b_jit_code, 1);
+  jit->code = NULL;
+  jit->entries = NULL;
+  jit->count = 0;
+  jit->max_push = 0;
+  function->jit = jit;
+}
+
+int jit_execute(b_vm *vm, b_jit_code *jit, b_value *slots, int offset) {
+  return offset;
+}
+
+void jit_free(b_vm *vm, b_jit_code *jit) {
+  FREE(b_jit_code, jit);
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef BLADE_JIT_H
+#define BLADE_JIT_H
+
+#include "common.h"
+#include "object.h"
+#include "value.h"
+
+// machine code generated for the loops of a hot function.
+//
+// the code works on the vm stack and the frame slots exactly like the
+// interpreter does, so it can hand control back at any instruction
+// boundary. instructions it has no template for, and values its
+// templates don't expect, make it return the offset of the instruction
+// for the interpreter to continue from.
+struct s_jit_code {
+  void *code;     // NULL when the function has nothing worth compiling
+  void **entries; // machine code address for each bytecode offset, or NULL
+  int count;      // number of entries
+  int max_push;   // upper bound on the values the code pushes on the stack
+};
+
+bool jit_is_supported();
+
+void jit_compile(b_vm *vm, b_obj_func *function);
+
+int jit_execute(b_vm *vm, b_jit_code *jit, b_value *slots, int offset);
+
+void jit_free(b_vm *vm, b_jit_code *jit);
+
+#endif
@@ -1,6 +1,7 @@
 #include "memory.h"
 #include "compiler.h"
 #include "config.h"
+#include "jit.h"
 #include "object.h"
 #include "blade_file.h"
 #include "module.h"
@@ -95,10 +96,18 @@ void blacken_object(b_vm *vm, b_obj *object) {
       mark_table(vm, &sw->table);
       break;
     }
+    case OBJ_STACK_TRACE: {
+      b_obj_stack_trace *trace = (b_obj_stack_trace *) object;
+      for (int i = 0; i < trace->count; i++) {
+        mark_object(vm, (b_obj *) trace->frames[i].function);
+      }
+      break;
+    }
     case OBJ_FILE: {
       b_obj_file *file = (b_obj_file *) object;
       mark_object(vm, (b_obj *) file->mode);
       mark_object(vm, (b_obj *) file->path);
+      mark_value(vm, file->line);
       break;
     }
     case OBJ_DICT: {
@@ -109,9 +118,15 @@ void blacken_object(b_vm *vm, b_obj *object) {
     }
     case OBJ_LIST: {
       b_obj_list *list = (b_obj_list *) object;
+      mark_object(vm, list->owner);
       mark_array(vm, &list->items);
       break;
     }
+    case OBJ_SET: {
+      b_obj_set *set = (b_obj_set *) object;
+      mark_table(vm, &set->items);
+      break;
+    }
 
     case OBJ_BOUND_METHOD: {
       b_obj_bound *bound = (b_obj_bound *) object;
@@ -123,6 +138,10 @@ void blacken_object(b_vm *vm, b_obj *object) {
       b_obj_class *klass = (b_obj_class *) object;
       mark_object(vm, (b_obj *) klass->name);
       mark_table(vm, &klass->methods);
+      for (int i = 0; i < klass->vtable_count; i++) {
+        mark_value(vm, klass->vtable[i].key);
+        mark_value(vm, klass->vtable[i].value);
+      }
       mark_table(vm, &klass->properties);
       mark_table(vm, &klass->static_properties);
       break;
@@ -131,7 +150,11 @@ void blacken_object(b_vm *vm, b_obj *object) {
       b_obj_closure *closure = (b_obj_closure *) object;
       mark_object(vm, (b_obj *) closure->function);
       for (int i = 0; i < closure->up_value_count; i++) {
-        mark_object(vm, (b_obj *) closure->up_values[i]);
+        if (closure->up_values[i].up_value != NULL) {
+          mark_object(vm, (b_obj *) closure->up_values[i].up_value);
+        } else {
+          mark_value(vm, closure->up_values[i].value);
+        }
       }
       break;
     }
@@ -154,7 +177,11 @@ void blacken_object(b_vm *vm, b_obj *object) {
       break;
     }
 
-    case OBJ_BYTES:
+    case OBJ_BYTES: {
+      mark_object(vm, ((b_obj_bytes *) object)->owner);
+      mark_object(vm, object);
+      break;
+    }
     case OBJ_RANGE:
     case OBJ_NATIVE: {
       mark_object(vm, object);
@@ -184,15 +211,21 @@ void free_object(b_vm *vm, b_obj *object) {
     }
     case OBJ_BYTES: {
       b_obj_bytes *bytes = (b_obj_bytes *) object;
-      free_byte_arr(vm, &bytes->bytes);
+      if (bytes->is_mapped) {
+        unmap_bytes(bytes);
+      } else if (bytes->owner == NULL) {
+        free_byte_arr(vm, &bytes->bytes);
+      }
       FREE(b_obj_bytes, object);
       break;
     }
     case OBJ_FILE: {
       b_obj_file *file = (b_obj_file *) object;
-      if (file->mode->length != 0 && !is_std_file(file)) {
+      if (file->file != NULL && !is_std_file(file)) {
         fclose(file->file);
       }
+      FREE_ARRAY(char, file->buffer, FILE_READ_BUFFER_SIZE);
+      FREE_ARRAY(char, file->write_buffer, file->write_buffer_size);
       FREE(b_obj_file, object);
       break;
     }
@@ -205,10 +238,21 @@ void free_object(b_vm *vm, b_obj *object) {
     }
     case OBJ_LIST: {
       b_obj_list *list = (b_obj_list *) object;
-      free_value_arr(vm, &list->items);
+      // views borrow their items from the owner.
+      // the allocation starts head slots before the first item
+      if (list->owner == NULL) {
+        FREE_ARRAY(b_value, list->items.values - list->head,
+                   (size_t) list->head + list->items.capacity);
+      }
       FREE(b_obj_list, object);
       break;
     }
+    case OBJ_SET: {
+      b_obj_set *set = (b_obj_set *) object;
+      free_table(vm, &set->items);
+      FREE(b_obj_set, object);
+      break;
+    }
 
     case OBJ_BOUND_METHOD: {
       // a closure may be bound to multiple instances
@@ -218,8 +262,9 @@ void free_object(b_vm *vm, b_obj *object) {
     }
     case OBJ_CLASS: {
       b_obj_class *klass = (b_obj_class *) object;
-      free_object(vm, (b_obj *) klass->name);
+      // the name is a string object of its own and is swept separately
       free_table(vm, &klass->methods);
+      FREE_ARRAY(b_entry, klass->vtable, klass->vtable_count);
       free_table(vm, &klass->properties);
       free_table(vm, &klass->static_properties);
       FREE(b_obj_class, object);
@@ -227,7 +272,7 @@ void free_object(b_vm *vm, b_obj *object) {
     }
     case OBJ_CLOSURE: {
       b_obj_closure *closure = (b_obj_closure *) object;
-      FREE_ARRAY(b_obj_up_value *, closure->up_values, closure->up_value_count);
+      FREE_ARRAY(b_capture, closure->up_values, closure->up_value_count);
       // there may be multiple closures that all reference the same function
       // for this reason, we do not free functions when freeing closures
       FREE(b_obj_closure, object);
@@ -236,6 +281,9 @@ void free_object(b_vm *vm, b_obj *object) {
     case OBJ_FUNCTION: {
       b_obj_func *function = (b_obj_func *) object;
       free_blob(vm, &function->blob);
+      if (function->jit != NULL) {
+        jit_free(vm, function->jit);
+      }
       /*if(function->name != NULL) {
         free_object(vm, (b_obj *) function->name);
       }*/
@@ -273,6 +321,20 @@ void free_object(b_vm *vm, b_obj *object) {
       FREE(b_obj_switch, object);
       break;
     }
+    case OBJ_STACK_TRACE: {
+      b_obj_stack_trace *trace = (b_obj_stack_trace *) object;
+      FREE_ARRAY(b_trace_frame, trace->frames, trace->count);
+      FREE(b_obj_stack_trace, object);
+      break;
+    }
+    case OBJ_PTR: {
+      b_obj_ptr *ptr = (b_obj_ptr *) object;
+      if (ptr->free_fn != NULL) {
+        ptr->free_fn(vm, ptr->pointer);
+      }
+      FREE(b_obj_ptr, object);
+      break;
+    }
 
     default:
       break;
@@ -283,6 +345,9 @@ static void mark_roots(b_vm *vm) {
   for (b_value *slot = vm->stack; slot < vm->stack_top; slot++) {
     mark_value(vm, *slot);
   }
+  for (int i = 0; i < vm->gc_protected; i++) {
+    mark_object(vm, vm->gc_protected_objects[i]);
+  }
   for (int i = 0; i < vm->frame_count; i++) {
     mark_object(vm, (b_obj *) vm->frames[i].closure);
   }
@@ -299,6 +364,7 @@ static void mark_roots(b_vm *vm) {
   mark_table(vm, &vm->methods_list);
   mark_table(vm, &vm->methods_dict);
   mark_table(vm, &vm->methods_range);
+  mark_table(vm, &vm->methods_set);
 
   mark_object(vm, (b_obj*)vm->exception_class);
 
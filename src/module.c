@@ -11,7 +11,9 @@ b_module_init modules[] = {
     GET_MODULE_LOADER(math),     //
     GET_MODULE_LOADER(date),     //
     GET_MODULE_LOADER(socket),     //
+    GET_MODULE_LOADER(event),     //
     GET_MODULE_LOADER(hash),     //
+    GET_MODULE_LOADER(reflect),     //
     NULL,
 };
 
@@ -90,6 +92,7 @@ void bind_native_modules(b_vm *vm) {
           }
 
           table_set(vm, &the_module->values, OBJ_VAL(class_name), OBJ_VAL(klass));
+          seal_class(vm, klass);
         }
       }
 
@@ -133,8 +133,10 @@ DECLARE_NATIVE(getprop) {
 
   b_obj_instance *instance = AS_INSTANCE(args[0]);
   b_value value;
-  table_get(&instance->properties, args[1], &value);
-  RETURN_VALUE(value);
+  if (table_get(&instance->properties, args[1], &value)) {
+    RETURN_VALUE(resolve_property(vm, instance, args[1], value));
+  }
+  RETURN;
 }
 
 /**
@@ -441,6 +443,13 @@ DECLARE_NATIVE(to_list) {
         write_list(vm, list, NUMBER_VAL(i));
       }
     }
+  } else if(IS_SET(args[0])) {
+    b_obj_set *set = AS_SET(args[0]);
+    for(int i = 0; i < set->items.capacity; i++) {
+      if(!IS_EMPTY(set->items.entries[i].key)) {
+        write_list(vm, list, set->items.entries[i].key);
+      }
+    }
   } else {
     write_value_arr(vm, &list->items, args[0]);
   }
@@ -671,7 +680,7 @@ DECLARE_NATIVE(is_function) {
  */
 DECLARE_NATIVE(is_iterable) {
   ENFORCE_ARG_COUNT(is_iterable, 1);
-  bool is_iterable = IS_LIST(args[0]) || IS_DICT(args[0]) || IS_STRING(args[0]) || IS_BYTES(args[0]);
+  bool is_iterable = IS_LIST(args[0]) || IS_DICT(args[0]) || IS_STRING(args[0]) || IS_BYTES(args[0]) || IS_SET(args[0]);
   if(!is_iterable && IS_INSTANCE(args[0])) {
       b_obj_class *klass = AS_INSTANCE(args[0])->klass;
       b_value dummy;
@@ -701,6 +710,16 @@ DECLARE_NATIVE(is_file) {
   RETURN_BOOL(IS_FILE(args[0]));
 }
 
+/**
+ * is_set(value: any)
+ *
+ * returns true if the value is a set or false otherwise
+ */
+DECLARE_NATIVE(is_set) {
+  ENFORCE_ARG_COUNT(is_set, 1);
+  RETURN_BOOL(IS_SET(args[0]));
+}
+
 /**
  * is_instance(value: any, name: class)
  *
@@ -51,6 +51,7 @@
 #define NORMALIZE_IS_DICT "dict"
 #define NORMALIZE_IS_OBJ "object"
 #define NORMALIZE_IS_FILE "file"
+#define NORMALIZE_IS_SET "set"
 
 #define NORMALIZE(token) NORMALIZE_##token
 
@@ -257,6 +258,8 @@ DECLARE_NATIVE(is_class);
 
 DECLARE_NATIVE(is_file);
 
+DECLARE_NATIVE(is_set);
+
 DECLARE_NATIVE(is_instance);
 
 DECLARE_NATIVE(is_iterable);
@@ -47,14 +47,34 @@ b_obj_switch *new_switch(b_vm *vm) {
   return sw;
 }
 
+b_obj_stack_trace *new_stack_trace(b_vm *vm, int count) {
+  b_trace_frame *frames = ALLOCATE(b_trace_frame, count);
+  b_obj_stack_trace *trace = ALLOCATE_OBJ(b_obj_stack_trace, OBJ_STACK_TRACE);
+  trace->count = count;
+  trace->frames = frames;
+  return trace;
+}
+
+b_obj_ptr *new_ptr(b_vm *vm, const char *name, void *pointer, b_ptr_free_fn free_fn) {
+  b_obj_ptr *ptr = ALLOCATE_OBJ(b_obj_ptr, OBJ_PTR);
+  ptr->name = name;
+  ptr->pointer = pointer;
+  ptr->free_fn = free_fn;
+  return ptr;
+}
+
 b_obj_bytes *new_bytes(b_vm *vm, int length) {
   b_obj_bytes *bytes = ALLOCATE_OBJ(b_obj_bytes, OBJ_BYTES);
+  bytes->owner = NULL;
+  bytes->is_mapped = false;
   init_byte_arr(&bytes->bytes, length);
   return bytes;
 }
 
 b_obj_list *new_list(b_vm *vm) {
   b_obj_list *list = ALLOCATE_OBJ(b_obj_list, OBJ_LIST);
+  list->head = 0;
+  list->owner = NULL;
   init_value_arr(&list->items);
   return list;
 }
@@ -78,12 +98,126 @@ b_obj_dict *new_dict(b_vm *vm) {
   return dict;
 }
 
+/*
+ * slices share storage instead of copying it.
+ *
+ * the first time a list or bytes that owns its storage is sliced, the
+ * storage is handed over to a hidden object of the same type that is
+ * never modified again, and the sliced object becomes a view of it just
+ * like the new slice. every view keeps the hidden owner alive through
+ * the GC and copies its items out (unshare_*) before its first write,
+ * so neither the parent nor the slice can observe the other's changes.
+ */
+b_obj_list *new_list_view(b_vm *vm, b_obj_list *list, int start, int length) {
+  if (list->owner == NULL) {
+    b_obj_list *storage = ALLOCATE_OBJ(b_obj_list, OBJ_LIST);
+    storage->head = list->head;
+    storage->owner = NULL;
+    storage->items = list->items;
+
+    list->head = 0;
+    list->owner = (b_obj *) storage;
+    list->items.capacity = list->items.count;
+  }
+
+  b_obj_list *view = ALLOCATE_OBJ(b_obj_list, OBJ_LIST);
+  view->head = 0;
+  view->owner = list->owner;
+  view->items.values = list->items.values + start;
+  view->items.count = length;
+  view->items.capacity = length;
+  return view;
+}
+
+b_obj_bytes *new_bytes_view(b_vm *vm, b_obj_bytes *bytes, int start, int length) {
+  if (bytes->owner == NULL) {
+    b_obj_bytes *storage = ALLOCATE_OBJ(b_obj_bytes, OBJ_BYTES);
+    storage->owner = NULL;
+    storage->bytes = bytes->bytes;
+    storage->is_mapped = false;
+    bytes->owner = (b_obj *) storage;
+  }
+
+  b_obj_bytes *view = ALLOCATE_OBJ(b_obj_bytes, OBJ_BYTES);
+  view->owner = bytes->owner;
+  view->bytes.bytes = bytes->bytes.bytes + start;
+  view->bytes.count = length;
+  view->is_mapped = false;
+  return view;
+}
+
+/*
+ * mapped files are handed out the same way: a hidden object owns the
+ * mapping and unmaps it once collected, while the bytes returned is a
+ * view that copies the data out before its first write.
+ */
+b_obj_bytes *new_mapped_bytes(b_vm *vm, unsigned char *data, int length) {
+  b_obj_bytes *storage = ALLOCATE_OBJ(b_obj_bytes, OBJ_BYTES);
+  storage->owner = NULL;
+  storage->bytes.bytes = data;
+  storage->bytes.count = length;
+  storage->is_mapped = true;
+
+  push(vm, OBJ_VAL(storage));
+  b_obj_bytes *view = ALLOCATE_OBJ(b_obj_bytes, OBJ_BYTES);
+  view->owner = (b_obj *) storage;
+  view->bytes = storage->bytes;
+  view->is_mapped = false;
+  pop(vm);
+  return view;
+}
+
+void unshare_list(b_vm *vm, b_obj_list *list) {
+  if (list->owner == NULL)
+    return;
+
+  b_value *values = NULL;
+  if (list->items.count > 0) {
+    values = ALLOCATE(b_value, list->items.count);
+    memcpy(values, list->items.values, sizeof(b_value) * list->items.count);
+  }
+
+  list->items.values = values;
+  list->items.capacity = list->items.count;
+  list->head = 0;
+  list->owner = NULL;
+}
+
+void unshare_bytes(b_vm *vm, b_obj_bytes *bytes) {
+  if (bytes->owner == NULL)
+    return;
+
+  unsigned char *data = NULL;
+  if (bytes->bytes.count > 0) {
+    data = ALLOCATE(unsigned char, bytes->bytes.count);
+    memcpy(data, bytes->bytes.bytes, bytes->bytes.count);
+  }
+
+  bytes->bytes.bytes = data;
+  bytes->owner = NULL;
+  bytes->is_mapped = false;
+}
+
+b_obj_set *new_set(b_vm *vm) {
+  b_obj_set *set = ALLOCATE_OBJ(b_obj_set, OBJ_SET);
+  set->count = 0;
+  init_table(&set->items);
+  return set;
+}
+
 b_obj_file *new_file(b_vm *vm, b_obj_string *path, b_obj_string *mode) {
   b_obj_file *file = ALLOCATE_OBJ(b_obj_file, OBJ_FILE);
   file->is_open = true;
   file->mode = mode;
   file->path = path;
   file->file = NULL;
+  file->buffer = NULL;
+  file->buffer_start = 0;
+  file->buffer_end = 0;
+  file->line = NIL_VAL;
+  file->buffer_mode = -1;
+  file->write_buffer = NULL;
+  file->write_buffer_size = 0;
   return file;
 }
 
@@ -100,16 +234,91 @@ b_obj_class *new_class(b_vm *vm, b_obj_string *name) {
   init_table(&klass->properties);
   init_table(&klass->static_properties);
   init_table(&klass->methods);
+  klass->vtable = NULL;
+  klass->vtable_count = 0;
   klass->initializer = EMPTY_VAL;
   klass->superclass = NULL;
   return klass;
 }
 
+/**
+ * copies the methods of a class whose body has run into an array
+ * indexed by the slot of their name, so dispatch is a load instead of
+ * a table lookup. a name keeps the slot it got from the first class
+ * that sealed it and new names take the lowest slot this class leaves
+ * free, so classes that never share a name reuse the same few slots
+ * and every vtable stays about as long as its class has methods.
+ * when two names of a class already hold the same slot, only one of
+ * them goes into the array and the other answers from the methods
+ * table. methods defined later update the entry of their name.
+ */
+void seal_class(b_vm *vm, b_obj_class *klass) {
+  FREE_ARRAY(b_entry, klass->vtable, klass->vtable_count);
+  klass->vtable = NULL;
+  klass->vtable_count = 0;
+
+  if (klass->methods.count == 0)
+    return;
+
+  int capacity = vm->symbol_count + klass->methods.count;
+  bool *taken = ALLOCATE(bool, capacity);
+  memset(taken, 0, sizeof(bool) * capacity);
+
+  int highest = -1;
+  for (int i = 0; i < klass->methods.capacity; i++) {
+    b_entry *entry = &klass->methods.entries[i];
+    if (!IS_EMPTY(entry->key)) {
+      int slot = AS_STRING(entry->key)->symbol;
+      if (slot != -1) {
+        taken[slot] = true;
+        if (slot > highest) highest = slot;
+      }
+    }
+  }
+
+  int next = 0;
+  for (int i = 0; i < klass->methods.capacity; i++) {
+    b_entry *entry = &klass->methods.entries[i];
+    if (!IS_EMPTY(entry->key) && AS_STRING(entry->key)->symbol == -1) {
+      while (taken[next]) next++;
+      AS_STRING(entry->key)->symbol = next;
+      taken[next] = true;
+      if (next > highest) highest = next;
+      if (next >= vm->symbol_count) vm->symbol_count = next + 1;
+    }
+  }
+
+  FREE_ARRAY(bool, taken, capacity);
+
+  int count = highest + 1;
+  b_entry *vtable = ALLOCATE(b_entry, count);
+  for (int i = 0; i < count; i++) {
+    vtable[i].key = EMPTY_VAL;
+    vtable[i].value = EMPTY_VAL;
+  }
+
+  for (int i = 0; i < klass->methods.capacity; i++) {
+    b_entry *entry = &klass->methods.entries[i];
+    if (!IS_EMPTY(entry->key)) {
+      b_entry *slot = &vtable[AS_STRING(entry->key)->symbol];
+      if (IS_EMPTY(slot->key)) {
+        *slot = *entry;
+      }
+    }
+  }
+
+  klass->vtable = vtable;
+  klass->vtable_count = count;
+}
+
 b_obj_func *new_function(b_vm *vm, b_obj_module *module, b_func_type type) {
   b_obj_func *function = ALLOCATE_OBJ(b_obj_func, OBJ_FUNCTION);
   function->arity = 0;
   function->up_value_count = 0;
   function->is_variadic = false;
+  function->uses_args = false;
+  function->hot_count = 0;
+  function->jit = NULL;
   function->name = NULL;
   function->type = type;
   function->module = module;
@@ -138,10 +347,10 @@ b_obj_native *new_native(b_vm *vm, b_native_fn function, const char *name) {
 }
 
 b_obj_closure *new_closure(b_vm *vm, b_obj_func *function) {
-  b_obj_up_value **up_values =
-      ALLOCATE(b_obj_up_value *, function->up_value_count);
+  b_capture *up_values = ALLOCATE(b_capture, function->up_value_count);
   for (int i = 0; i < function->up_value_count; i++) {
-    up_values[i] = NULL;
+    up_values[i].up_value = NULL;
+    up_values[i].value = NIL_VAL;
   }
 
   b_obj_closure *closure = ALLOCATE_OBJ(b_obj_closure, OBJ_CLOSURE);
@@ -158,6 +367,7 @@ b_obj_string *allocate_string(b_vm *vm, char *chars, int length,
   string->length = length;
   string->utf8_length = utf8len(chars);
   string->hash = hash;
+  string->symbol = -1;
 
   push(vm, OBJ_VAL(string)); // fixing gc corruption
   table_set(vm, &vm->strings, OBJ_VAL(string), NIL_VAL);
@@ -254,6 +464,21 @@ static void print_dict(b_obj_dict *dict) {
   printf("}");
 }
 
+static void print_set(b_obj_set *set) {
+  printf("{");
+  int printed = 0;
+  for (int i = 0; i < set->items.capacity; i++) {
+    b_entry *entry = &set->items.entries[i];
+    if (!IS_EMPTY(entry->key)) {
+      print_value(entry->key);
+      if (++printed != set->count) {
+        printf(", ");
+      }
+    }
+  }
+  printf("}");
+}
+
 static void print_file(b_obj_file *file) {
   printf("<file at %s in mode %s>", file->path->chars, file->mode->chars);
 }
@@ -263,6 +488,14 @@ void print_object(b_value value, bool fix_string) {
     case OBJ_SWITCH: {
       break;
     }
+    case OBJ_STACK_TRACE: {
+      printf("<stacktrace>");
+      break;
+    }
+    case OBJ_PTR: {
+      printf("<ptr %s>", AS_PTR(value)->name);
+      break;
+    }
     case OBJ_RANGE: {
       b_obj_range *range = AS_RANGE(value);
       printf("<range %d-%d>", range->lower, range->upper);
@@ -280,6 +513,10 @@ void print_object(b_value value, bool fix_string) {
       print_list(AS_LIST(value));
       break;
     }
+    case OBJ_SET: {
+      print_set(AS_SET(value));
+      break;
+    }
     case OBJ_BYTES: {
       print_bytes(AS_BYTES(value));
       break;
@@ -341,7 +578,10 @@ b_obj_bytes *copy_bytes(b_vm *vm, unsigned char *b, int length) {
 }
 
 b_obj_bytes *take_bytes(b_vm *vm, unsigned char *b, int length) {
-  b_obj_bytes *bytes = new_bytes(vm, length);
+  b_obj_bytes *bytes = ALLOCATE_OBJ(b_obj_bytes, OBJ_BYTES);
+  bytes->owner = NULL;
+  bytes->is_mapped = false;
+  bytes->bytes.count = length;
   bytes->bytes.bytes = b;
   return bytes;
 }
@@ -417,6 +657,26 @@ static char *dict_to_string(b_vm *vm, b_obj_dict *dict) {
   return str;
 }
 
+static char *set_to_string(b_vm *vm, b_obj_set *set) {
+  char *str = strdup("{");
+  int printed = 0;
+  for (int i = 0; i < set->items.capacity; i++) {
+    b_entry *entry = &set->items.entries[i];
+    if (!IS_EMPTY(entry->key)) {
+      char *val = value_to_string(vm, entry->key);
+      if (val != NULL) {
+        str = append_strings(str, val);
+        free(val);
+      }
+      if (++printed != set->count) {
+        str = append_strings(str, ", ");
+      }
+    }
+  }
+  str = append_strings(str, "}");
+  return str;
+}
+
 char *object_to_string(b_vm *vm, b_value value) {
   char *str = (char *) calloc(1, sizeof(char));
 
@@ -424,6 +684,18 @@ char *object_to_string(b_vm *vm, b_value value) {
     case OBJ_SWITCH: {
       return "<switch>";
     }
+    case OBJ_STACK_TRACE: {
+      free(str);
+      return strdup("<stacktrace>");
+    }
+    case OBJ_PTR: {
+      free(str);
+      str = (char *) calloc(strlen(AS_PTR(value)->name) + 7, sizeof(char));
+      if (str != NULL) {
+        sprintf(str, "<ptr %s>", AS_PTR(value)->name);
+      }
+      return str;
+    }
     case OBJ_CLASS:
       if (str != NULL) {
         sprintf(str, "<class %s>", AS_CLASS(value)->name->chars);
@@ -466,6 +738,8 @@ char *object_to_string(b_vm *vm, b_value value) {
       return list_to_string(vm, &AS_LIST(value)->items);
     case OBJ_DICT:
       return dict_to_string(vm, AS_DICT(value));
+    case OBJ_SET:
+      return set_to_string(vm, AS_SET(value));
     case OBJ_FILE: {
       b_obj_file *file = AS_FILE(value);
       sprintf(str, "<file at %s in mode %s>", file->path->chars,
@@ -491,6 +765,8 @@ const char *object_type(b_obj *object) {
       return "dictionary";
     case OBJ_LIST:
       return "list";
+    case OBJ_SET:
+      return "set";
 
     case OBJ_CLASS:
       return "class";
@@ -510,6 +786,10 @@ const char *object_type(b_obj *object) {
       //
     case OBJ_SWITCH:
       return "switch";
+    case OBJ_STACK_TRACE:
+      return "stacktrace";
+    case OBJ_PTR:
+      return "ptr";
 
     default:
       return "unknown";
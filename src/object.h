@@ -8,6 +8,8 @@
 
 #include <stdio.h>
 
+typedef struct s_jit_code b_jit_code;
+
 typedef enum {
   TYPE_FUNCTION,
   TYPE_METHOD,
@@ -34,6 +36,7 @@ typedef enum {
 #define IS_DICT(v) is_obj_type(v, OBJ_DICT)
 #define IS_FILE(v) is_obj_type(v, OBJ_FILE)
 #define IS_RANGE(v) is_obj_type(v, OBJ_RANGE)
+#define IS_SET(v) is_obj_type(v, OBJ_SET)
 
 // promote b_value to object
 #define AS_STRING(v) ((b_obj_string *)AS_OBJ(v))
@@ -49,6 +52,10 @@ typedef enum {
 #define IS_SWITCH(v) is_obj_type(v, OBJ_SWITCH)
 #define AS_MODULE(v) ((b_obj_module *)AS_OBJ(v))
 #define IS_MODULE(v) is_obj_type(v, OBJ_MODULE)
+#define AS_STACK_TRACE(v) ((b_obj_stack_trace *)AS_OBJ(v))
+#define IS_STACK_TRACE(v) is_obj_type(v, OBJ_STACK_TRACE)
+#define AS_PTR(v) ((b_obj_ptr *)AS_OBJ(v))
+#define IS_PTR(v) is_obj_type(v, OBJ_PTR)
 
 // containers
 #define AS_BYTES(v) ((b_obj_bytes *)AS_OBJ(v))
@@ -56,6 +63,7 @@ typedef enum {
 #define AS_DICT(v) ((b_obj_dict *)AS_OBJ(v))
 #define AS_FILE(v) ((b_obj_file *)AS_OBJ(v))
 #define AS_RANGE(v) ((b_obj_range *)AS_OBJ(v))
+#define AS_SET(v) ((b_obj_set *)AS_OBJ(v))
 
 // demote blade value to c string
 #define AS_C_STRING(v) (((b_obj_string *)AS_OBJ(v))->chars)
@@ -70,6 +78,7 @@ typedef enum {
   OBJ_DICT,
   OBJ_FILE,
   OBJ_BYTES,
+  OBJ_SET,
 
   // base object types
   OBJ_UP_VALUE,
@@ -83,6 +92,8 @@ typedef enum {
   // non-user objects
   OBJ_MODULE,
   OBJ_SWITCH,
+  OBJ_STACK_TRACE,
+  OBJ_PTR,
 } b_obj_type;
 
 struct s_obj {
@@ -96,6 +107,7 @@ struct s_obj_string {
   int length;
   int utf8_length;
   uint32_t hash;
+  int symbol; // method slot, -1 until the name names a method
   char *chars;
 };
 
@@ -122,16 +134,26 @@ typedef struct {
   int arity;
   int up_value_count;
   bool is_variadic;
+  bool uses_args; // false when the body never reads __args__
+  int hot_count;  // calls and loop iterations seen while the jit is on
+  b_jit_code *jit;
   b_blob blob;
   b_obj_string *name;
   b_obj_module *module;
 } b_obj_func;
 
+// a variable captured by a closure. variables that are never assigned
+// after their declaration are copied into value and have no up_value.
+typedef struct {
+  b_obj_up_value *up_value;
+  b_value value;
+} b_capture;
+
 typedef struct {
   b_obj obj;
   int up_value_count;
   b_obj_func *function;
-  b_obj_up_value **up_values;
+  b_capture *up_values;
 } b_obj_closure;
 
 typedef struct b_obj_class {
@@ -141,6 +163,10 @@ typedef struct b_obj_class {
   b_table properties;
   b_table static_properties;
   b_table methods;
+  // methods indexed by the slot of their name, filled in when the class
+  // is sealed. entries keep their name as names can share a slot.
+  b_entry *vtable;
+  int vtable_count;
   struct b_obj_class *superclass;
 } b_obj_class;
 
@@ -167,6 +193,14 @@ typedef struct b_obj_native {
 
 typedef struct {
   b_obj obj;
+  // number of free slots reserved before items.values.
+  // this lets shift() and insert(x, 0) run in amortized O(1)
+  // while items.values[i] remains a plain O(1) index.
+  int head;
+  // when not NULL, items is a read-only window into the storage of
+  // this object and must be copied out with unshare_list() before
+  // it is modified.
+  b_obj *owner;
   b_value_arr items;
 } b_obj_list;
 
@@ -179,7 +213,12 @@ typedef struct {
 
 typedef struct {
   b_obj obj;
+  // when not NULL, bytes is a read-only window into the storage of
+  // this object and must be copied out with unshare_bytes() before
+  // it is modified.
+  b_obj *owner;
   b_byte_arr bytes;
+  bool is_mapped; // bytes is a read-only mmap()ed region
 } b_obj_bytes;
 
 typedef struct {
@@ -188,12 +227,28 @@ typedef struct {
   b_table items;
 } b_obj_dict;
 
+typedef struct {
+  b_obj obj;
+  int count;
+  b_table items; // members are the keys, values are unused
+} b_obj_set;
+
 typedef struct {
   b_obj obj;
   bool is_open;
   FILE *file;
   b_obj_string *mode;
   b_obj_string *path;
+  // read ahead buffer shared by read_line(), read(n) and iteration.
+  char *buffer;
+  size_t buffer_start; // next unread byte
+  size_t buffer_end;   // end of the bytes read ahead
+  b_value line;        // line the iterator is on
+  // write buffering chosen with set_buffer(), -1 when the file
+  // closes after every write.
+  int buffer_mode;
+  char *write_buffer;
+  size_t write_buffer_size;
 } b_obj_file;
 
 typedef struct {
@@ -203,11 +258,39 @@ typedef struct {
   b_table table;
 } b_obj_switch;
 
+typedef struct {
+  b_obj_func *function;
+  int ip; // offset of the instruction that was executing
+} b_trace_frame;
+
+// the call frames active when an exception was raised.
+// it is only formatted into text when the stacktrace is read.
+typedef struct {
+  b_obj obj;
+  int count;
+  b_trace_frame *frames;
+} b_obj_stack_trace;
+
+typedef void (*b_ptr_free_fn)(b_vm *vm, void *pointer);
+
+// native data that blade code can pass around but cannot read or
+// change. free_fn releases the pointer when the object is freed.
+typedef struct {
+  b_obj obj;
+  const char *name;
+  void *pointer;
+  b_ptr_free_fn free_fn;
+} b_obj_ptr;
+
 // non-user objects...
 b_obj_module *new_module(b_vm *vm, char *name, char *file);
 
 b_obj_switch *new_switch(b_vm *vm);
 
+b_obj_stack_trace *new_stack_trace(b_vm *vm, int count);
+
+b_obj_ptr *new_ptr(b_vm *vm, const char *name, void *pointer, b_ptr_free_fn free_fn);
+
 // data containers
 b_obj_list *new_list(b_vm *vm);
 b_obj_range *new_range(b_vm *vm, int lower, int upper);
@@ -216,6 +299,18 @@ b_obj_bytes *new_bytes(b_vm *vm, int length);
 
 b_obj_dict *new_dict(b_vm *vm);
 
+b_obj_list *new_list_view(b_vm *vm, b_obj_list *list, int start, int length);
+
+b_obj_bytes *new_bytes_view(b_vm *vm, b_obj_bytes *bytes, int start, int length);
+
+b_obj_bytes *new_mapped_bytes(b_vm *vm, unsigned char *data, int length);
+
+void unshare_list(b_vm *vm, b_obj_list *list);
+
+void unshare_bytes(b_vm *vm, b_obj_bytes *bytes);
+
+b_obj_set *new_set(b_vm *vm);
+
 b_obj_file *new_file(b_vm *vm, b_obj_string *path, b_obj_string *mode);
 
 // base objects
@@ -223,6 +318,8 @@ b_obj_bound *new_bound_method(b_vm *vm, b_value receiver, b_obj_closure *method)
 
 b_obj_class *new_class(b_vm *vm, b_obj_string *name);
 
+void seal_class(b_vm *vm, b_obj_class *klass);
+
 b_obj_closure *new_closure(b_vm *vm, b_obj_func *function);
 
 b_obj_func *new_function(b_vm *vm, b_obj_module *module, b_func_type type);
@@ -251,4 +348,14 @@ static inline bool is_obj_type(b_value v, b_obj_type t) {
   return IS_OBJ(v) && AS_OBJ(v)->type == t;
 }
 
+// returns the vtable entry of name in klass or NULL, see seal_class.
+static inline b_entry *vtable_entry(b_obj_class *klass, b_obj_string *name) {
+  if ((unsigned int) name->symbol < (unsigned int) klass->vtable_count) {
+    b_entry *entry = &klass->vtable[name->symbol];
+    if (IS_OBJ(entry->key) && AS_OBJ(entry->key) == (b_obj *) name)
+      return entry;
+  }
+  return NULL;
+}
+
 #endif
\ No newline at end of file
@@ -1,154 +1,586 @@
 #include "base64.h"
+#include "memory.h"
 
 #include <string.h>
 
-static const char base64_encoding_table[] = {
-    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M',
-    'N', 'O', 'P', 'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X', 'Y', 'Z',
-    'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm',
-    'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z',
-    '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/',
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * base64 (RFC 4648) with the standard and the URL and filename safe
+ * alphabets.
+ *
+ * long inputs are encoded and decoded 24/32 bytes at a time with AVX2 or
+ * 12/16 bytes at a time with SSSE3 when the processor supports them and
+ * three/four bytes at a time otherwise. the vector code follows Wojciech
+ * Muła and Daniel Lemire's "Faster Base64 Encoding and Decoding using
+ * AVX2 Instructions" and translates characters with range comparisons so
+ * that both alphabets share it.
+ *
+ * see: https://arxiv.org/abs/1704.00605
+ */
+
+#define BASE64_INVALID 0xff
+
+typedef struct {
+  const char *encoding;
+  unsigned char decoding[256];
+  // the characters for the values 62 and 63
+  char c62, c63;
+} b_base64_alphabet;
+
+static b_base64_alphabet base64_standard = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    {0}, '+', '/',
 };
 
-static const unsigned char base64_decoding_table[256] = {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x00, 0x00, 0x00, 0x3f,
-    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
-    0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10, 0x11, 0x12,
-    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x23, 0x24,
-    0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
-    0x31, 0x32, 0x33, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00,
+static b_base64_alphabet base64_url = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_",
+    {0}, '-', '_',
 };
 
-char *base64_encode(const unsigned char *data, int input_length,
-                    int *output_length) {
+/**
+ * the vector routines process as many whole blocks as they can and
+ * return how much input they consumed. the decoders stop at the first
+ * block holding anything other than alphabet characters.
+ */
+typedef size_t (*base64_encode_fn)(const unsigned char *in, size_t length, char *out,
+                                   const b_base64_alphabet *alphabet);
+typedef size_t (*base64_decode_fn)(const char *in, size_t length, unsigned char *out,
+                                   const b_base64_alphabet *alphabet);
+
+static size_t base64_encode_none(const unsigned char *in, size_t length, char *out,
+                                 const b_base64_alphabet *alphabet) {
+  return 0;
+}
 
-  const int mod_table[] = {0, 2, 1};
+static size_t base64_decode_none(const char *in, size_t length, unsigned char *out,
+                                 const b_base64_alphabet *alphabet) {
+  return 0;
+}
 
-  *output_length = 4 * ((input_length + 2) / 3);
+#ifdef BASE64_X86
+
+/**
+ * the encoders spread every three bytes over four bytes, move each six
+ * bit value into its own byte with two multiplications and map the
+ * values 0..63 to characters by adding an offset looked up from the
+ * range each value is in.
+ */
+__attribute__((target("ssse3")))
+static inline __m128i base64_encode_lookup_ssse3(__m128i values, const b_base64_alphabet *alphabet) {
+  const __m128i offsets = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, (char) (alphabet->c62 - 62), (char) (alphabet->c63 - 63), 'A', 0, 0);
+
+  // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+  __m128i index = _mm_subs_epu8(values, _mm_set1_epi8(51));
+  __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), values);
+  index = _mm_or_si128(index, _mm_and_si128(less, _mm_set1_epi8(13)));
+
+  return _mm_add_epi8(_mm_shuffle_epi8(offsets, index), values);
+}
 
-  char *encoded_data = (char *) malloc(*output_length);
+__attribute__((target("ssse3")))
+static size_t base64_encode_ssse3(const unsigned char *in, size_t length, char *out,
+                                  const b_base64_alphabet *alphabet) {
+  const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  size_t done = 0;
 
-  if (encoded_data == NULL)
-    return NULL;
+  // each block reads 16 bytes and uses 12
+  while (length - done >= 16) {
+    __m128i input = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (in + done)), spread);
 
-  for (int i = 0, j = 0; i < input_length;) {
+    __m128i high = _mm_mulhi_epu16(_mm_and_si128(input, _mm_set1_epi32(0x0fc0fc00)),
+                                   _mm_set1_epi32(0x04000040));
+    __m128i low = _mm_mullo_epi16(_mm_and_si128(input, _mm_set1_epi32(0x003f03f0)),
+                                  _mm_set1_epi32(0x01000010));
 
-    uint32_t octet_a = i < input_length ? (unsigned char) data[i++] : 0;
-    uint32_t octet_b = i < input_length ? (unsigned char) data[i++] : 0;
-    uint32_t octet_c = i < input_length ? (unsigned char) data[i++] : 0;
+    __m128i values = _mm_or_si128(high, low);
+    _mm_storeu_si128((__m128i *) out, base64_encode_lookup_ssse3(values, alphabet));
 
-    uint32_t triple = (octet_a << 0x10) + (octet_b << 0x08) + octet_c;
+    done += 12;
+    out += 16;
+  }
+  return done;
+}
 
-    encoded_data[j++] = base64_encoding_table[(triple >> 3 * 6) & 0x3F];
-    encoded_data[j++] = base64_encoding_table[(triple >> 2 * 6) & 0x3F];
-    encoded_data[j++] = base64_encoding_table[(triple >> 1 * 6) & 0x3F];
-    encoded_data[j++] = base64_encoding_table[(triple >> 0 * 6) & 0x3F];
+__attribute__((target("avx2")))
+static size_t base64_encode_avx2(const unsigned char *in, size_t length, char *out,
+                                 const b_base64_alphabet *alphabet) {
+  const __m256i spread = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i offsets = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, (char) (alphabet->c62 - 62), (char) (alphabet->c63 - 63), 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, (char) (alphabet->c62 - 62), (char) (alphabet->c63 - 63), 'A', 0, 0);
+  size_t done = 0;
+
+  // each block reads 28 bytes and uses 24, 12 in each lane
+  while (length - done >= 28) {
+    __m256i input = _mm256_loadu2_m128i((const __m128i *) (in + done + 12), (const __m128i *) (in + done));
+    input = _mm256_shuffle_epi8(input, spread);
+
+    __m256i high = _mm256_mulhi_epu16(_mm256_and_si256(input, _mm256_set1_epi32(0x0fc0fc00)),
+                                      _mm256_set1_epi32(0x04000040));
+    __m256i low = _mm256_mullo_epi16(_mm256_and_si256(input, _mm256_set1_epi32(0x003f03f0)),
+                                     _mm256_set1_epi32(0x01000010));
+    __m256i values = _mm256_or_si256(high, low);
+
+    __m256i index = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+    __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+    index = _mm256_or_si256(index, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+
+    _mm256_storeu_si256((__m256i *) out, _mm256_add_epi8(_mm256_shuffle_epi8(offsets, index), values));
+
+    done += 24;
+    out += 32;
   }
+  return done;
+}
 
-  for (int i = 0; i < mod_table[input_length % 3]; i++)
-    encoded_data[*output_length - 1 - i] = '=';
+/**
+ * the decoders turn characters into six bit values by adding the offset
+ * of the range each character falls in. characters outside all ranges
+ * (padding, whitespace and anything else) end the vector loop.
+ * the values are then packed back into three bytes for every four.
+ */
+#define BASE64_IN_RANGE(w, bits, v, lo, hi) \
+  _mm##w##_and_si##bits(_mm##w##_cmpgt_epi8(v, _mm##w##_set1_epi8((char) ((lo) - 1))), \
+                        _mm##w##_cmpgt_epi8(_mm##w##_set1_epi8((char) ((hi) + 1)), v))
+
+__attribute__((target("ssse3")))
+static size_t base64_decode_ssse3(const char *in, size_t length, unsigned char *out,
+                                  const b_base64_alphabet *alphabet) {
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t done = 0;
+
+  while (length - done >= 16) {
+    __m128i s = _mm_loadu_si128((const __m128i *) (in + done));
+
+    __m128i upper = BASE64_IN_RANGE(, 128, s, 'A', 'Z');
+    __m128i lower = BASE64_IN_RANGE(, 128, s, 'a', 'z');
+    __m128i digit = BASE64_IN_RANGE(, 128, s, '0', '9');
+    __m128i c62 = _mm_cmpeq_epi8(s, _mm_set1_epi8(alphabet->c62));
+    __m128i c63 = _mm_cmpeq_epi8(s, _mm_set1_epi8(alphabet->c63));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(c62, c63)));
+    if (_mm_movemask_epi8(valid) != 0xffff) break;
+
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    shift = _mm_or_si128(shift, _mm_and_si128(c62, _mm_set1_epi8((char) (62 - alphabet->c62))));
+    shift = _mm_or_si128(shift, _mm_and_si128(c63, _mm_set1_epi8((char) (63 - alphabet->c63))));
+    __m128i values = _mm_add_epi8(s, shift);
+
+    // 00aaaaaa 00bbbbbb 00cccccc 00dddddd -> aaaaaabb bbbbcccc ccdddddd
+    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    __m128i bytes = _mm_shuffle_epi8(words, pack);
+
+    _mm_storel_epi64((__m128i *) out, bytes);
+    uint32_t last = (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+    memcpy(out + 8, &last, 4);
+
+    done += 16;
+    out += 12;
+  }
+  return done;
+}
 
-  return encoded_data;
+__attribute__((target("avx2")))
+static size_t base64_decode_avx2(const char *in, size_t length, unsigned char *out,
+                                 const b_base64_alphabet *alphabet) {
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+  size_t done = 0;
+
+  while (length - done >= 32) {
+    __m256i s = _mm256_loadu_si256((const __m256i *) (in + done));
+
+    __m256i upper = BASE64_IN_RANGE(256, 256, s, 'A', 'Z');
+    __m256i lower = BASE64_IN_RANGE(256, 256, s, 'a', 'z');
+    __m256i digit = BASE64_IN_RANGE(256, 256, s, '0', '9');
+    __m256i c62 = _mm256_cmpeq_epi8(s, _mm256_set1_epi8(alphabet->c62));
+    __m256i c63 = _mm256_cmpeq_epi8(s, _mm256_set1_epi8(alphabet->c63));
+
+    __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                    _mm256_or_si256(digit, _mm256_or_si256(c62, c63)));
+    if (_mm256_movemask_epi8(valid) != -1) break;
+
+    __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(c62, _mm256_set1_epi8((char) (62 - alphabet->c62))));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(c63, _mm256_set1_epi8((char) (63 - alphabet->c63))));
+    __m256i values = _mm256_add_epi8(s, shift);
+
+    __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i words = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    __m256i bytes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(words, pack), join);
+
+    // store exactly the 24 decoded bytes
+    _mm_storeu_si128((__m128i *) out, _mm256_castsi256_si128(bytes));
+    _mm_storel_epi64((__m128i *) (out + 16), _mm256_extracti128_si256(bytes, 1));
+
+    done += 32;
+    out += 24;
+  }
+  return done;
 }
 
-unsigned char *base64_decode(const char *data, int input_length,
-                             int *output_length) {
+#undef BASE64_IN_RANGE
 
-  if (input_length % 4 != 0)
-    return NULL;
+#endif /* BASE64_X86 */
 
-  *output_length = input_length / 4 * 3;
+static base64_encode_fn base64_encode_blocks = NULL;
+static base64_decode_fn base64_decode_blocks = NULL;
 
-  if (data[input_length - 1] == '=')
-    (*output_length)--;
-  if (data[input_length - 2] == '=')
-    (*output_length)--;
+static void base64_make_table(b_base64_alphabet *alphabet) {
+  memset(alphabet->decoding, BASE64_INVALID, sizeof(alphabet->decoding));
+  for (int i = 0; i < 64; i++) {
+    alphabet->decoding[(unsigned char) alphabet->encoding[i]] = (unsigned char) i;
+  }
+}
+
+// builds the decoding tables and picks the fastest routines on first use
+static void base64_init(void) {
+  base64_make_table(&base64_standard);
+  base64_make_table(&base64_url);
+
+  base64_encode_blocks = base64_encode_none;
+  base64_decode_blocks = base64_decode_none;
+
+#ifdef BASE64_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    base64_encode_blocks = base64_encode_avx2;
+    base64_decode_blocks = base64_decode_avx2;
+  } else if (__builtin_cpu_supports("ssse3")) {
+    base64_encode_blocks = base64_encode_ssse3;
+    base64_decode_blocks = base64_decode_ssse3;
+  }
+#endif
+}
 
-  unsigned char *decoded_data = (unsigned char *) malloc(*output_length);
+static const b_base64_alphabet *base64_alphabet(bool url_safe) {
+  if (base64_encode_blocks == NULL) base64_init();
+  return url_safe ? &base64_url : &base64_standard;
+}
 
-  if (decoded_data == NULL)
-    return NULL;
+/**
+ * encodes the whole groups of three bytes in data and returns the
+ * number of characters written.
+ */
+static size_t base64_encode_groups(const unsigned char *data, size_t length, char *out,
+                                   const b_base64_alphabet *alphabet) {
+  size_t done = base64_encode_blocks(data, length, out, alphabet);
+  char *p = out + done / 3 * 4;
+
+  for (; length - done >= 3; done += 3) {
+    uint32_t triple = ((uint32_t) data[done] << 16) | ((uint32_t) data[done + 1] << 8) | data[done + 2];
+    *p++ = alphabet->encoding[(triple >> 18) & 0x3f];
+    *p++ = alphabet->encoding[(triple >> 12) & 0x3f];
+    *p++ = alphabet->encoding[(triple >> 6) & 0x3f];
+    *p++ = alphabet->encoding[triple & 0x3f];
+  }
+  return (size_t) (p - out);
+}
 
-  for (int i = 0, j = 0; i < input_length;) {
+// encodes the last one or two bytes of the data followed by padding
+static size_t base64_encode_tail(const unsigned char *data, size_t length, char *out,
+                                 const b_base64_alphabet *alphabet) {
+  if (length == 0) return 0;
 
-    uint32_t sextet_a =
-        data[i] == '=' ? 0 & i++ : base64_decoding_table[(int) data[i++]];
-    uint32_t sextet_b =
-        data[i] == '=' ? 0 & i++ : base64_decoding_table[(int) data[i++]];
-    uint32_t sextet_c =
-        data[i] == '=' ? 0 & i++ : base64_decoding_table[(int) data[i++]];
-    uint32_t sextet_d =
-        data[i] == '=' ? 0 & i++ : base64_decoding_table[(int) data[i++]];
+  uint32_t triple = (uint32_t) data[0] << 16;
+  if (length > 1) triple |= (uint32_t) data[1] << 8;
 
-    uint32_t triple = (sextet_a << 3 * 6) + (sextet_b << 2 * 6) +
-                      (sextet_c << 1 * 6) + (sextet_d << 0 * 6);
+  out[0] = alphabet->encoding[(triple >> 18) & 0x3f];
+  out[1] = alphabet->encoding[(triple >> 12) & 0x3f];
+  out[2] = length > 1 ? alphabet->encoding[(triple >> 6) & 0x3f] : '=';
+  out[3] = '=';
+  return 4;
+}
 
-    if (j < *output_length)
-      decoded_data[j++] = (triple >> 2 * 8) & 0xFF;
-    if (j < *output_length)
-      decoded_data[j++] = (triple >> 1 * 8) & 0xFF;
-    if (j < *output_length)
-      decoded_data[j++] = (triple >> 0 * 8) & 0xFF;
+/**
+ * decodes whole groups of four characters into three bytes each and
+ * returns the number of bytes written.
+ * padding and characters outside the alphabet count as zero.
+ */
+static size_t base64_decode_groups(const char *data, size_t length, unsigned char *out,
+                                   const b_base64_alphabet *alphabet) {
+  size_t done = base64_decode_blocks(data, length, out, alphabet);
+  unsigned char *p = out + done / 4 * 3;
+
+  for (; length - done >= 4; done += 4) {
+    uint32_t triple = 0;
+    for (int i = 0; i < 4; i++) {
+      unsigned char value = alphabet->decoding[(unsigned char) data[done + i]];
+      triple = (triple << 6) | (value == BASE64_INVALID ? 0 : value);
+    }
+    *p++ = (unsigned char) (triple >> 16);
+    *p++ = (unsigned char) (triple >> 8);
+    *p++ = (unsigned char) triple;
   }
+  return (size_t) (p - out);
+}
 
-  return decoded_data;
+static bool base64_url_safe(int arg_count, b_value *args, int index) {
+  return arg_count > index && !is_false(args[index]);
 }
 
 DECLARE_MODULE_METHOD(base64__decode) {
-  ENFORCE_ARG_COUNT(decode, 1);
+  ENFORCE_ARG_RANGE(decode, 1, 2);
   ENFORCE_CONSTRUCTOR_ARG_TYPE(decode, 0, IS_STRING);
 
   b_obj_string *string = AS_STRING(args[0]);
+  bool url_safe = base64_url_safe(arg_count, args, 1);
+  const b_base64_alphabet *alphabet = base64_alphabet(url_safe);
+
+  size_t length = string->length;
+  int padding = 0;
+
+  // url safe input may leave out the padding
+  if (length % 4 != 0) {
+    if (!url_safe || length % 4 == 1) RETURN;
+    padding = 4 - (int) (length % 4);
+  } else {
+    if (length > 0 && string->chars[length - 1] == '=') padding++;
+    if (length > 1 && string->chars[length - 2] == '=') padding++;
+  }
 
-  int output_length;
-  unsigned char *data = base64_decode((const char *) string->chars,
-                                      string->length, &output_length);
+  size_t groups = (length + 3) / 4;
+  int output_length = (int) (groups * 3) - padding;
 
-  if (data == NULL) RETURN;
+  b_obj_bytes *bytes = (b_obj_bytes *) GC(new_bytes(vm, output_length));
+  if (groups > 0) {
+    // the last group may be padded, so it is decoded on the side
+    size_t head = (groups - 1) * 4;
+    base64_decode_groups(string->chars, head, bytes->bytes.bytes, alphabet);
 
-  b_obj_bytes *bytes = new_bytes(vm, output_length);
-  memcpy(bytes->bytes.bytes, data, output_length);
-  free(data);
+    char last[4] = {'=', '=', '=', '='};
+    memcpy(last, string->chars + head, length - head);
+    unsigned char tail[3];
+    base64_decode_groups(last, 4, tail, alphabet);
+    memcpy(bytes->bytes.bytes + (groups - 1) * 3, tail, 3 - padding);
+  }
 
+  CLEAR_GC();
   RETURN_OBJ(bytes);
 }
 
 DECLARE_MODULE_METHOD(base64__encode) {
-  ENFORCE_ARG_COUNT(encode, 1);
+  ENFORCE_ARG_RANGE(encode, 1, 2);
   ENFORCE_CONSTRUCTOR_ARG_TYPE(encode, 0, IS_BYTES);
 
   b_obj_bytes *bytes = AS_BYTES(args[0]);
+  const b_base64_alphabet *alphabet = base64_alphabet(base64_url_safe(arg_count, args, 1));
+
+  size_t input_length = bytes->bytes.count;
+  size_t output_length = 4 * ((input_length + 2) / 3);
+
+  char *data = ALLOCATE(char, output_length + 1);
+  size_t length = base64_encode_groups(bytes->bytes.bytes, input_length, data, alphabet);
+  base64_encode_tail(bytes->bytes.bytes + length / 4 * 3, input_length % 3, data + length, alphabet);
+  data[output_length] = '\0';
+
+  RETURN_T_STRING(data, (int) output_length);
+}
+
+/**
+ * the streaming encoder and decoder keep the input they could not
+ * process yet in a small bytes object owned by the blade side:
+ * the number of pending bytes followed by the bytes themselves.
+ */
+#define BASE64_STATE_SIZE 4
+
+static bool base64_state(b_value value) {
+  return IS_BYTES(value) && AS_BYTES(value)->bytes.count == BASE64_STATE_SIZE &&
+         AS_BYTES(value)->bytes.bytes[0] < BASE64_STATE_SIZE;
+}
+
+static bool base64_input(b_value value, const unsigned char **data, size_t *length) {
+  if (IS_STRING(value)) {
+    *data = (unsigned char *) AS_STRING(value)->chars;
+    *length = AS_STRING(value)->length;
+  } else if (IS_BYTES(value)) {
+    *data = AS_BYTES(value)->bytes.bytes;
+    *length = AS_BYTES(value)->bytes.count;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+DECLARE_MODULE_METHOD(base64__encode_update) {
+  ENFORCE_ARG_RANGE(encode_update, 2, 3);
+  if (!base64_state(args[0])) {
+    RETURN_ERROR("invalid base64 encoder state");
+  }
+
+  const unsigned char *data;
+  size_t length;
+  if (!base64_input(args[1], &data, &length)) {
+    RETURN_ERROR("encode_update() expects string or bytes");
+  }
+
+  const b_base64_alphabet *alphabet = base64_alphabet(base64_url_safe(arg_count, args, 2));
+  // the state must not be written into storage shared with other bytes
+  unshare_bytes(vm, AS_BYTES(args[0]));
+  unsigned char *state = AS_BYTES(args[0])->bytes.bytes;
+  size_t pending = state[0];
+
+  size_t output_length = (pending + length) / 3 * 4;
+  char *out = ALLOCATE(char, output_length + 1);
+  char *p = out;
+
+  // complete the group left over from the previous call first
+  if (pending > 0 && pending + length >= 3) {
+    memcpy(state + 1 + pending, data, 3 - pending);
+    p += base64_encode_groups(state + 1, 3, p, alphabet);
+    data += 3 - pending;
+    length -= 3 - pending;
+    pending = 0;
+  }
+
+  if (pending == 0) {
+    size_t written = base64_encode_groups(data, length, p, alphabet);
+    p += written;
+    data += written / 4 * 3;
+    length -= written / 4 * 3;
+  }
+
+  memcpy(state + 1 + pending, data, length);
+  state[0] = (unsigned char) (pending + length);
+  *p = '\0';
+
+  RETURN_T_STRING(out, (int) output_length);
+}
+
+DECLARE_MODULE_METHOD(base64__encode_finish) {
+  ENFORCE_ARG_RANGE(encode_finish, 1, 2);
+  if (!base64_state(args[0])) {
+    RETURN_ERROR("invalid base64 encoder state");
+  }
+
+  const b_base64_alphabet *alphabet = base64_alphabet(base64_url_safe(arg_count, args, 1));
+  // the state must not be written into storage shared with other bytes
+  unshare_bytes(vm, AS_BYTES(args[0]));
+  unsigned char *state = AS_BYTES(args[0])->bytes.bytes;
+
+  char out[4];
+  size_t length = base64_encode_tail(state + 1, state[0], out, alphabet);
+  state[0] = 0;
+
+  RETURN_L_STRING(out, (int) length);
+}
+
+// whitespace and padding are skipped by the streaming decoder
+static inline bool base64_skip(unsigned char c) {
+  return c == '\n' || c == '\r' || c == ' ' || c == '\t' || c == '=';
+}
+
+DECLARE_MODULE_METHOD(base64__decode_update) {
+  ENFORCE_ARG_RANGE(decode_update, 2, 3);
+  if (!base64_state(args[0])) {
+    RETURN_ERROR("invalid base64 decoder state");
+  }
 
-  int output_length;
-  char *data = base64_encode((const unsigned char *) bytes->bytes.bytes,
-                             bytes->bytes.count, &output_length);
+  const unsigned char *data;
+  size_t length;
+  if (!base64_input(args[1], &data, &length)) {
+    RETURN_ERROR("decode_update() expects string or bytes");
+  }
 
-  if (data == NULL) RETURN;
+  const b_base64_alphabet *alphabet = base64_alphabet(base64_url_safe(arg_count, args, 2));
+  // the state must not be written into storage shared with other bytes
+  unshare_bytes(vm, AS_BYTES(args[0]));
+  unsigned char *state = AS_BYTES(args[0])->bytes.bytes;
+  size_t pending = state[0];
+
+  size_t capacity = (pending + length) / 4 * 3;
+  unsigned char *out = ALLOCATE(unsigned char, capacity + 1);
+  unsigned char *p = out;
+
+  char group[4];
+  memcpy(group, state + 1, pending);
+
+  size_t i = 0;
+  while (i < length) {
+    // runs without whitespace go through the vector decoder untouched
+    if (pending == 0) {
+      size_t done = base64_decode_blocks((const char *) data + i, length - i, p, alphabet);
+      p += done / 4 * 3;
+      i += done;
+    }
+
+    for (; i < length && pending < 4; i++) {
+      if (!base64_skip(data[i])) group[pending++] = (char) data[i];
+    }
+
+    if (pending == 4) {
+      p += base64_decode_groups(group, 4, p, alphabet);
+      pending = 0;
+    }
+  }
 
-  RETURN_T_STRING(data, output_length);
+  memcpy(state + 1, group, pending);
+  state[0] = (unsigned char) pending;
+
+  size_t output_length = (size_t) (p - out);
+  if (output_length < capacity) {
+    out = GROW_ARRAY(unsigned char, out, capacity + 1, output_length + 1);
+  }
+
+  RETURN_OBJ(take_bytes(vm, out, (int) output_length));
 }
 
+DECLARE_MODULE_METHOD(base64__decode_finish) {
+  ENFORCE_ARG_RANGE(decode_finish, 1, 2);
+  if (!base64_state(args[0])) {
+    RETURN_ERROR("invalid base64 decoder state");
+  }
+
+  const b_base64_alphabet *alphabet = base64_alphabet(base64_url_safe(arg_count, args, 1));
+  // the state must not be written into storage shared with other bytes
+  unshare_bytes(vm, AS_BYTES(args[0]));
+  unsigned char *state = AS_BYTES(args[0])->bytes.bytes;
+  size_t pending = state[0];
+  state[0] = 0;
+
+  // a single character left over cannot be decoded
+  if (pending == 1) RETURN;
+
+  char group[4] = {'=', '=', '=', '='};
+  memcpy(group, state + 1, pending);
+
+  unsigned char out[3];
+  base64_decode_groups(group, 4, out, alphabet);
+
+  b_obj_bytes *bytes = (b_obj_bytes *) GC(new_bytes(vm, pending > 0 ? (int) pending - 1 : 0));
+  memcpy(bytes->bytes.bytes, out, bytes->bytes.count);
+  CLEAR_GC();
+  RETURN_OBJ(bytes);
+}
+
+#undef BASE64_STATE_SIZE
+
 CREATE_MODULE_LOADER(base64) {
   static b_func_reg module_functions[] = {
-      {"decode", false, GET_MODULE_METHOD(base64__decode)},
-      {"encode", false, GET_MODULE_METHOD(base64__encode)},
-      {NULL,     false, NULL},
+      {"decode",        false, GET_MODULE_METHOD(base64__decode)},
+      {"encode",        false, GET_MODULE_METHOD(base64__encode)},
+      {"encode_update", false, GET_MODULE_METHOD(base64__encode_update)},
+      {"encode_finish", false, GET_MODULE_METHOD(base64__encode_finish)},
+      {"decode_update", false, GET_MODULE_METHOD(base64__decode_update)},
+      {"decode_finish", false, GET_MODULE_METHOD(base64__decode_finish)},
+      {NULL,            false, NULL},
   };
 
   static b_module_reg module = {
@@ -161,4 +593,4 @@ CREATE_MODULE_LOADER(base64) {
   };
 
   return &module;
-}
\ No newline at end of file
+}
@@ -0,0 +1,190 @@
+#include "event.h"
+
+#include <errno.h>
+#include <fcntl.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#else
+#include "blade_unistd.h"
+#endif /* HAVE_UNISTD_H */
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif /* HAVE_SYS_EPOLL_H */
+
+#define MAX_WAIT_EVENTS 256 /* events returned by a single _wait() */
+
+DECLARE_MODULE_METHOD(event__create) {
+  ENFORCE_ARG_COUNT(_create, 0);
+
+#ifdef HAVE_SYS_EPOLL_H
+  RETURN_NUMBER(epoll_create1(EPOLL_CLOEXEC));
+#else
+  errno = ENOSYS;
+  RETURN_NUMBER(-1);
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+DECLARE_MODULE_METHOD(event__ctl) {
+  ENFORCE_ARG_COUNT(_ctl, 4);
+  ENFORCE_ARG_TYPE(_ctl, 0, IS_NUMBER); // the poll id
+  ENFORCE_ARG_TYPE(_ctl, 1, IS_NUMBER); // the operation
+  ENFORCE_ARG_TYPE(_ctl, 2, IS_NUMBER); // the socket id
+  ENFORCE_ARG_TYPE(_ctl, 3, IS_NUMBER); // events
+
+#ifdef HAVE_SYS_EPOLL_H
+  struct epoll_event event = {0};
+  event.events = (uint32_t) (int32_t) AS_NUMBER(args[3]);
+  event.data.fd = (int) AS_NUMBER(args[2]);
+
+  RETURN_NUMBER(epoll_ctl((int) AS_NUMBER(args[0]), (int) AS_NUMBER(args[1]),
+                          event.data.fd, &event));
+#else
+  errno = ENOSYS;
+  RETURN_NUMBER(-1);
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+/**
+ * returns the ready sockets as a flat list of id and events pairs so that
+ * a busy loop does not allocate a list per event.
+ */
+DECLARE_MODULE_METHOD(event__wait) {
+  ENFORCE_ARG_COUNT(_wait, 2);
+  ENFORCE_ARG_TYPE(_wait, 0, IS_NUMBER); // the poll id
+  ENFORCE_ARG_TYPE(_wait, 1, IS_NUMBER); // timeout in milliseconds
+
+#ifdef HAVE_SYS_EPOLL_H
+  // round the timeout up so that timers are never woken up early
+  double wait = AS_NUMBER(args[1]);
+  int timeout = (int) wait;
+  if (timeout < wait) timeout++;
+
+  struct epoll_event events[MAX_WAIT_EVENTS];
+  int count = epoll_wait((int) AS_NUMBER(args[0]), events, MAX_WAIT_EVENTS,
+                         timeout);
+
+  if (count < 0) {
+    // a signal is not an error, just an early wake up
+    if (errno != EINTR) {
+      RETURN_NUMBER(-1);
+    }
+    count = 0;
+  }
+
+  b_obj_list *list = (b_obj_list *) GC(new_list(vm));
+  for (int i = 0; i < count; i++) {
+    write_list(vm, list, NUMBER_VAL(events[i].data.fd));
+    write_list(vm, list, NUMBER_VAL(events[i].events));
+  }
+
+  RETURN_OBJ(list);
+#else
+  errno = ENOSYS;
+  RETURN_NUMBER(-1);
+#endif /* HAVE_SYS_EPOLL_H */
+}
+
+DECLARE_MODULE_METHOD(event__close) {
+  ENFORCE_ARG_COUNT(_close, 1);
+  ENFORCE_ARG_TYPE(_close, 0, IS_NUMBER);
+  RETURN_NUMBER(close((int) AS_NUMBER(args[0])));
+}
+
+DECLARE_MODULE_METHOD(event__setblocking) {
+  ENFORCE_ARG_COUNT(_setblocking, 2);
+  ENFORCE_ARG_TYPE(_setblocking, 0, IS_NUMBER); // the socket id
+  ENFORCE_ARG_TYPE(_setblocking, 1, IS_BOOL);
+
+#ifndef _WIN32
+  int sock = (int) AS_NUMBER(args[0]);
+  int flags = fcntl(sock, F_GETFL, 0);
+  if (flags < 0) {
+    RETURN_NUMBER(-1);
+  }
+
+  flags = AS_BOOL(args[1]) ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+  RETURN_NUMBER(fcntl(sock, F_SETFL, flags));
+#else
+  errno = ENOSYS;
+  RETURN_NUMBER(-1);
+#endif /* ifndef _WIN32 */
+}
+
+DECLARE_MODULE_METHOD(event__error) {
+  ENFORCE_ARG_COUNT(_error, 1);
+  ENFORCE_ARG_TYPE(_error, 0, IS_NUMBER);
+
+  if (AS_NUMBER(args[0]) == -1) {
+    char *error = strerror(errno);
+    RETURN_STRING(error);
+  }
+  RETURN;
+}
+
+/** START EVENT CONSTANTS */
+
+// flags are exposed as signed 32 bit numbers so that EPOLLET survives
+// Blade's bitwise operators.
+#ifdef HAVE_SYS_EPOLL_H
+#define EVENT_CONSTANT(name, value)                                            \
+  b_value __event_##name(b_vm *vm) { return NUMBER_VAL((int32_t) (value)); }
+#else
+#define EVENT_CONSTANT(name, value)                                            \
+  b_value __event_##name(b_vm *vm) { return NUMBER_VAL(-1); }
+#endif /* HAVE_SYS_EPOLL_H */
+
+EVENT_CONSTANT(IN, EPOLLIN)           // ready to read
+EVENT_CONSTANT(OUT, EPOLLOUT)         // ready to write
+EVENT_CONSTANT(RDHUP, EPOLLRDHUP)     // peer closed its writing side
+EVENT_CONSTANT(ERR, EPOLLERR)         // error on the socket
+EVENT_CONSTANT(HUP, EPOLLHUP)         // socket hung up
+EVENT_CONSTANT(ET, EPOLLET)           // edge triggered notifications
+EVENT_CONSTANT(ONESHOT, EPOLLONESHOT) // disarm after one notification
+
+EVENT_CONSTANT(CTL_ADD, EPOLL_CTL_ADD)
+EVENT_CONSTANT(CTL_MOD, EPOLL_CTL_MOD)
+EVENT_CONSTANT(CTL_DEL, EPOLL_CTL_DEL)
+
+#undef EVENT_CONSTANT
+
+/** END EVENT CONSTANTS */
+
+CREATE_MODULE_LOADER(event) {
+  static b_func_reg module_functions[] = {
+      {"_create",      false, GET_MODULE_METHOD(event__create)},
+      {"_ctl",         false, GET_MODULE_METHOD(event__ctl)},
+      {"_wait",        false, GET_MODULE_METHOD(event__wait)},
+      {"_close",       false, GET_MODULE_METHOD(event__close)},
+      {"_setblocking", false, GET_MODULE_METHOD(event__setblocking)},
+      {"_error",       false, GET_MODULE_METHOD(event__error)},
+      {NULL,           false, NULL},
+  };
+
+  static b_field_reg module_fields[] = {
+      {"IN",      true, __event_IN},
+      {"OUT",     true, __event_OUT},
+      {"RDHUP",   true, __event_RDHUP},
+      {"ERR",     true, __event_ERR},
+      {"HUP",     true, __event_HUP},
+      {"ET",      true, __event_ET},
+      {"ONESHOT", true, __event_ONESHOT},
+      {"CTL_ADD", true, __event_CTL_ADD},
+      {"CTL_MOD", true, __event_CTL_MOD},
+      {"CTL_DEL", true, __event_CTL_DEL},
+      {NULL,      false, NULL},
+  };
+
+  static b_module_reg module = {
+      .name = "_event",
+      .fields = module_fields,
+      .functions = module_functions,
+      .classes = NULL,
+      .preloader = NULL,
+      .unloader = NULL
+  };
+  return &module;
+}
+
+#undef MAX_WAIT_EVENTS
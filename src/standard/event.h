@@ -0,0 +1,10 @@
+#ifndef BLADE_MODULE_EVENT_H
+#define BLADE_MODULE_EVENT_H
+
+#include "module.h"
+#include "native.h"
+#include "value.h"
+
+CREATE_MODULE_LOADER(event);
+
+#endif
@@ -12,6 +12,21 @@
 #include "hash/crc32.h"
 #include "hash/adler32.h"
 #include "pathinfo.h"
+#include "blade_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#else
+#include "blade_unistd.h"
+#endif /* ifdef HAVE_UNISTD_H */
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif /* ifdef HAVE_SYS_MMAN_H */
 
 #ifdef _MSC_VER
 #define PRIx64 "llx"
@@ -39,6 +54,28 @@ DECLARE_MODULE_METHOD(hash__crc32) {
   }
 }
 
+DECLARE_MODULE_METHOD(hash__crc32c) {
+  ENFORCE_ARG_RANGE(crc32c, 1, 2);
+
+  if (!IS_STRING(args[0]) && !IS_BYTES(args[0])) {
+    RETURN_ERROR("crc32c() expects string or bytes");
+  }
+
+  uint32_t crc = 0;
+  if (!IS_NIL(args[1])) {
+    ENFORCE_ARG_TYPE(crc32c, 1, IS_NUMBER);
+    crc = (uint32_t) AS_NUMBER(args[1]);
+  }
+
+  if (IS_STRING(args[0])) {
+    b_obj_string *string = AS_STRING(args[0]);
+    RETURN_NUMBER(crc32c(crc, (unsigned char *) string->chars, string->length));
+  } else {
+    b_obj_bytes *bytes = AS_BYTES(args[0]);
+    RETURN_NUMBER(crc32c(crc, bytes->bytes.bytes, bytes->bytes.count));
+  }
+}
+
 DECLARE_MODULE_METHOD(hash__adler32) {
   ENFORCE_ARG_RANGE(adler32, 1, 2);
 
@@ -118,24 +155,6 @@ DECLARE_MODULE_METHOD(hash__md5) {
   RETURN_T_STRING(result, 32);
 }
 
-DECLARE_MODULE_METHOD(hash__md5_file) {
-  ENFORCE_ARG_COUNT(md5_file, 1);
-  ENFORCE_ARG_TYPE(md5_file, 0, IS_FILE);
-
-  b_obj_file *file = AS_FILE(args[0]);
-
-  if (file_exists(file->path->chars)) {
-    char *result = MD5File(file->path->chars);
-    if (result == NULL) {
-      RETURN_ERROR("md5_file() could not open file");
-    }
-
-    RETURN_T_STRING(result, 32);
-  }
-
-  RETURN_ERROR("md5_file() file not found");
-}
-
 DECLARE_MODULE_METHOD(hash__sha1) {
   ENFORCE_ARG_COUNT(sha1, 1);
 
@@ -195,6 +214,53 @@ DECLARE_MODULE_METHOD(hash__sha256) {
   RETURN_T_STRING(result, 64);
 }
 
+DECLARE_MODULE_METHOD(hash__sha256_many) {
+  ENFORCE_ARG_COUNT(sha256_many, 1);
+  ENFORCE_ARG_TYPE(sha256_many, 0, IS_LIST);
+
+  b_obj_list *list = AS_LIST(args[0]);
+  int count = list->items.count;
+
+  const uint8_t **data = ALLOCATE(const uint8_t *, count);
+  size_t *lengths = ALLOCATE(size_t, count);
+  for (int i = 0; i < count; i++) {
+    b_value item = list->items.values[i];
+    if (IS_STRING(item)) {
+      data[i] = (const uint8_t *) AS_STRING(item)->chars;
+      lengths[i] = AS_STRING(item)->length;
+    } else if (IS_BYTES(item)) {
+      data[i] = AS_BYTES(item)->bytes.bytes;
+      lengths[i] = AS_BYTES(item)->bytes.count;
+    } else {
+      FREE_ARRAY(const uint8_t *, data, count);
+      FREE_ARRAY(size_t, lengths, count);
+      RETURN_ERROR("sha256_many() expects a list of strings or bytes");
+    }
+  }
+
+  uint8_t (*digests)[SHA256_HASH_SIZE] = (uint8_t (*)[SHA256_HASH_SIZE]) ALLOCATE(uint8_t, count * SHA256_HASH_SIZE);
+  sha256_many(data, lengths, count, digests);
+
+  // fill the list first so that each string is reachable once created
+  b_obj_list *result = (b_obj_list *) GC(new_list(vm));
+  for (int i = 0; i < count; i++) {
+    write_list(vm, result, NIL_VAL);
+  }
+
+  for (int i = 0; i < count; i++) {
+    char hex[SHA256_HASH_SIZE * 2 + 1];
+    for (int j = 0; j < SHA256_HASH_SIZE; j++) {
+      sprintf(hex + (j * 2), "%02x", digests[i][j]);
+    }
+    result->items.values[i] = STRING_L_VAL(hex, SHA256_HASH_SIZE * 2);
+  }
+
+  FREE_ARRAY(const uint8_t *, data, count);
+  FREE_ARRAY(size_t, lengths, count);
+  FREE_ARRAY(uint8_t, digests, count * SHA256_HASH_SIZE);
+  RETURN_OBJ(result);
+}
+
 DECLARE_MODULE_METHOD(hash__sha384) {
   ENFORCE_ARG_COUNT(sha384, 1);
 
@@ -386,6 +452,567 @@ DECLARE_MODULE_METHOD(hash__gost) {
   RETURN_TT_STRING(result);
 }
 
+/**
+ * how the digest of an algorithm is returned to blade code.
+ * - DIGEST_HEX: as a hex string of all the digest bytes
+ * - DIGEST_NUMBER: as a number (for the 32 bit checksums)
+ * - DIGEST_HEX_NUMBER: as the hex of a 64 bit number without the
+ * leading zeros (siphash)
+ */
+typedef enum {
+  DIGEST_HEX,
+  DIGEST_NUMBER,
+  DIGEST_HEX_NUMBER,
+} b_digest_format;
+
+/**
+ * an algorithm that can hash its input in pieces. the digest is written
+ * big-endian for the numeric formats.
+ */
+typedef struct {
+  const char *name;
+  size_t context_size;
+  int digest_size;
+  b_digest_format format;
+  void (*init)(void *context, const unsigned char *key);
+  void (*update)(void *context, const unsigned char *data, size_t length);
+  void (*final)(void *context, unsigned char *digest);
+} b_hash_algorithm;
+
+// the largest piece handed to an update function since some of them
+// count their input with 32 bit integers.
+#define HASH_UPDATE_LIMIT (1u << 30)
+
+// the size of the windows files are mapped in and of the chunks they
+// are read in when they cannot be mapped.
+#define HASH_FILE_MAP_SIZE (8 * 1024 * 1024)
+#define HASH_FILE_CHUNK_SIZE (1024 * 1024)
+
+static void write_uint32(unsigned char *digest, uint32_t value) {
+  digest[0] = (unsigned char) (value >> 24);
+  digest[1] = (unsigned char) (value >> 16);
+  digest[2] = (unsigned char) (value >> 8);
+  digest[3] = (unsigned char) value;
+}
+
+static void adler32_ctx_init(void *context, const unsigned char *key) { *(unsigned long *) context = 1; }
+static void adler32_ctx_update(void *context, const unsigned char *data, size_t length) {
+  *(unsigned long *) context = adler32(*(unsigned long *) context, data, length);
+}
+static void adler32_ctx_final(void *context, unsigned char *digest) {
+  write_uint32(digest, (uint32_t) *(unsigned long *) context);
+}
+
+static void crc32_ctx_init(void *context, const unsigned char *key) { *(uint32_t *) context = 0; }
+static void crc32_ctx_update(void *context, const unsigned char *data, size_t length) {
+  *(uint32_t *) context = crc32(*(uint32_t *) context, (unsigned char *) data, length);
+}
+static void crc32c_ctx_update(void *context, const unsigned char *data, size_t length) {
+  *(uint32_t *) context = crc32c(*(uint32_t *) context, (unsigned char *) data, length);
+}
+static void crc32_ctx_final(void *context, unsigned char *digest) {
+  write_uint32(digest, *(uint32_t *) context);
+}
+
+static void md2_ctx_init(void *context, const unsigned char *key) { MD2Init(context); }
+static void md2_ctx_update(void *context, const unsigned char *data, size_t length) {
+  MD2Update(context, data, length);
+}
+static void md2_ctx_final(void *context, unsigned char *digest) { MD2Final(digest, context); }
+
+static void md4_ctx_init(void *context, const unsigned char *key) { MD4Init(context); }
+static void md4_ctx_update(void *context, const unsigned char *data, size_t length) {
+  MD4Update(context, data, length);
+}
+static void md4_ctx_final(void *context, unsigned char *digest) { MD4Final(digest, context); }
+
+static void md5_ctx_init(void *context, const unsigned char *key) { MD5Init(context); }
+static void md5_ctx_update(void *context, const unsigned char *data, size_t length) {
+  MD5Update(context, (unsigned char *) data, (unsigned int) length);
+}
+static void md5_ctx_final(void *context, unsigned char *digest) { MD5Final(digest, context); }
+
+static void sha1_ctx_init(void *context, const unsigned char *key) { SHA1Init(context); }
+static void sha1_ctx_update(void *context, const unsigned char *data, size_t length) {
+  SHA1Update(context, data, (uint32_t) length);
+}
+static void sha1_ctx_final(void *context, unsigned char *digest) { SHA1Final(digest, context); }
+
+static void sha224_ctx_init(void *context, const unsigned char *key) { sha224_init(context); }
+static void sha256_ctx_init(void *context, const unsigned char *key) { sha256_init(context); }
+static void sha256_ctx_update(void *context, const unsigned char *data, size_t length) {
+  sha256_update(context, data, (uint32_t) length);
+}
+// sha224 keeps the first 28 bytes of the digest
+static void sha256_ctx_final(void *context, unsigned char *digest) { sha256_final(context, digest); }
+
+static void sha384_ctx_init(void *context, const unsigned char *key) { SHA384_Init(context); }
+static void sha512_ctx_init(void *context, const unsigned char *key) { SHA512_Init(context); }
+static void sha512_ctx_update(void *context, const unsigned char *data, size_t length) {
+  SHA512_Update(context, (void *) data, length);
+}
+static void sha512_ctx_final(void *context, unsigned char *digest) { SHA512_Final(digest, context); }
+
+static void fnv32_ctx_init(void *context, const unsigned char *key) { FNV132Init(context); }
+static void fnv1_ctx_update(void *context, const unsigned char *data, size_t length) {
+  FNV132Update(context, data, length);
+}
+static void fnv1a_ctx_update(void *context, const unsigned char *data, size_t length) {
+  FNV1a32Update(context, data, length);
+}
+static void fnv32_ctx_final(void *context, unsigned char *digest) { FNV132Final(context, digest); }
+
+static void fnv64_ctx_init(void *context, const unsigned char *key) { FNV164Init(context); }
+static void fnv1_64_ctx_update(void *context, const unsigned char *data, size_t length) {
+  FNV164Update(context, data, length);
+}
+static void fnv1a_64_ctx_update(void *context, const unsigned char *data, size_t length) {
+  FNV1a64Update(context, data, length);
+}
+static void fnv64_ctx_final(void *context, unsigned char *digest) { FNV164Final(context, digest); }
+
+static void whirlpool_ctx_init(void *context, const unsigned char *key) { WHIRLPOOLInit(context); }
+static void whirlpool_ctx_update(void *context, const unsigned char *data, size_t length) {
+  WHIRLPOOLUpdate(context, data, length);
+}
+static void whirlpool_ctx_final(void *context, unsigned char *digest) { WHIRLPOOLFinal(digest, context); }
+
+static void snefru_ctx_init(void *context, const unsigned char *key) { SNEFRUInit(context); }
+static void snefru_ctx_update(void *context, const unsigned char *data, size_t length) {
+  SNEFRUUpdate(context, data, length);
+}
+static void snefru_ctx_final(void *context, unsigned char *digest) { SNEFRUFinal(digest, context); }
+
+static void gost_ctx_init(void *context, const unsigned char *key) { GOSTInit(context); }
+static void gost_ctx_update(void *context, const unsigned char *data, size_t length) {
+  GOSTUpdate(context, data, length);
+}
+static void gost_ctx_final(void *context, unsigned char *digest) { GOSTFinal(digest, context); }
+
+static void siphash_ctx_init(void *context, const unsigned char *key) { SIPHASHInit(context, key); }
+static void siphash_ctx_update(void *context, const unsigned char *data, size_t length) {
+  SIPHASHUpdate(context, data, length);
+}
+static void siphash_ctx_final(void *context, unsigned char *digest) {
+  uint64_t value = SIPHASHFinal(context);
+  write_uint32(digest, (uint32_t) (value >> 32));
+  write_uint32(digest + 4, (uint32_t) value);
+}
+
+#define HASH_ALGORITHM(name, type, size, format, init, update, final) \
+  {#name, sizeof(type), size, format, init, update, final}
+
+static const b_hash_algorithm hash_algorithms[] = {
+    HASH_ALGORITHM(adler32, unsigned long, 4, DIGEST_NUMBER, adler32_ctx_init, adler32_ctx_update, adler32_ctx_final),
+    HASH_ALGORITHM(crc32, uint32_t, 4, DIGEST_NUMBER, crc32_ctx_init, crc32_ctx_update, crc32_ctx_final),
+    HASH_ALGORITHM(crc32c, uint32_t, 4, DIGEST_NUMBER, crc32_ctx_init, crc32c_ctx_update, crc32_ctx_final),
+    HASH_ALGORITHM(md2, MD2_CTX, 16, DIGEST_HEX, md2_ctx_init, md2_ctx_update, md2_ctx_final),
+    HASH_ALGORITHM(md4, MD4_CTX, 16, DIGEST_HEX, md4_ctx_init, md4_ctx_update, md4_ctx_final),
+    HASH_ALGORITHM(md5, MD5_CTX, 16, DIGEST_HEX, md5_ctx_init, md5_ctx_update, md5_ctx_final),
+    HASH_ALGORITHM(sha1, SHA1_CTX, 20, DIGEST_HEX, sha1_ctx_init, sha1_ctx_update, sha1_ctx_final),
+    HASH_ALGORITHM(sha224, SHA256_CTX, 28, DIGEST_HEX, sha224_ctx_init, sha256_ctx_update, sha256_ctx_final),
+    HASH_ALGORITHM(sha256, SHA256_CTX, 32, DIGEST_HEX, sha256_ctx_init, sha256_ctx_update, sha256_ctx_final),
+    HASH_ALGORITHM(sha384, SHA512_CTX, 48, DIGEST_HEX, sha384_ctx_init, sha512_ctx_update, sha512_ctx_final),
+    HASH_ALGORITHM(sha512, SHA512_CTX, 64, DIGEST_HEX, sha512_ctx_init, sha512_ctx_update, sha512_ctx_final),
+    HASH_ALGORITHM(fnv1, FNV132_CTX, 4, DIGEST_HEX, fnv32_ctx_init, fnv1_ctx_update, fnv32_ctx_final),
+    HASH_ALGORITHM(fnv1a, FNV132_CTX, 4, DIGEST_HEX, fnv32_ctx_init, fnv1a_ctx_update, fnv32_ctx_final),
+    HASH_ALGORITHM(fnv1_64, FNV164_CTX, 8, DIGEST_HEX, fnv64_ctx_init, fnv1_64_ctx_update, fnv64_ctx_final),
+    HASH_ALGORITHM(fnv1a_64, FNV164_CTX, 8, DIGEST_HEX, fnv64_ctx_init, fnv1a_64_ctx_update, fnv64_ctx_final),
+    HASH_ALGORITHM(whirlpool, WHIRLPOOL_CTX, 64, DIGEST_HEX, whirlpool_ctx_init, whirlpool_ctx_update, whirlpool_ctx_final),
+    HASH_ALGORITHM(snefru, SNEFRU_CTX, 32, DIGEST_HEX, snefru_ctx_init, snefru_ctx_update, snefru_ctx_final),
+    HASH_ALGORITHM(gost, GOST_CTX, 32, DIGEST_HEX, gost_ctx_init, gost_ctx_update, gost_ctx_final),
+    HASH_ALGORITHM(siphash, SIPHASH_CTX, 8, DIGEST_HEX_NUMBER, siphash_ctx_init, siphash_ctx_update, siphash_ctx_final),
+};
+
+#undef HASH_ALGORITHM
+
+#define HASH_ALGORITHM_COUNT (int) (sizeof(hash_algorithms) / sizeof(hash_algorithms[0]))
+
+// the largest digest of all the algorithms
+#define HASH_MAX_DIGEST_SIZE 64
+
+static const b_hash_algorithm *find_hash_algorithm(const char *name) {
+  for (int i = 0; i < HASH_ALGORITHM_COUNT; i++) {
+    if (strcmp(hash_algorithms[i].name, name) == 0) {
+      return &hash_algorithms[i];
+    }
+  }
+  return NULL;
+}
+
+static void hash_update(const b_hash_algorithm *algorithm, void *context, const unsigned char *data, size_t length) {
+  while (length > HASH_UPDATE_LIMIT) {
+    algorithm->update(context, data, HASH_UPDATE_LIMIT);
+    data += HASH_UPDATE_LIMIT;
+    length -= HASH_UPDATE_LIMIT;
+  }
+  if (length > 0) {
+    algorithm->update(context, data, length);
+  }
+}
+
+static b_value hash_digest_value(b_vm *vm, const b_hash_algorithm *algorithm, const unsigned char *digest) {
+  switch (algorithm->format) {
+    case DIGEST_NUMBER: {
+      uint32_t value = ((uint32_t) digest[0] << 24) | ((uint32_t) digest[1] << 16) |
+                       ((uint32_t) digest[2] << 8) | (uint32_t) digest[3];
+      return NUMBER_VAL(value);
+    }
+    case DIGEST_HEX_NUMBER: {
+      uint64_t value = 0;
+      for (int i = 0; i < algorithm->digest_size; i++) {
+        value = (value << 8) | digest[i];
+      }
+      char result[17];
+      int length = sprintf(result, "%" PRIx64, value);
+      return OBJ_VAL(copy_string(vm, result, length));
+    }
+    default: {
+      char result[HASH_MAX_DIGEST_SIZE * 2 + 1];
+      for (int i = 0; i < algorithm->digest_size; i++) {
+        sprintf(result + (i * 2), "%02x", digest[i]);
+      }
+      return OBJ_VAL(copy_string(vm, result, algorithm->digest_size * 2));
+    }
+  }
+}
+
+/**
+ * feeds a whole file to the context. regular files are mapped into
+ * memory a window at a time when possible and read in large chunks
+ * otherwise, so files far larger than the available memory can be hashed.
+ * returns false and sets errno when the file cannot be read.
+ */
+static bool hash_file(const b_hash_algorithm *algorithm, void *context, b_obj_file *file) {
+  if (is_std_file(file)) {
+    unsigned char *buffer = malloc(HASH_FILE_CHUNK_SIZE);
+    if (buffer == NULL) return false;
+
+    size_t length;
+    while ((length = fread(buffer, 1, HASH_FILE_CHUNK_SIZE, file->file)) > 0) {
+      hash_update(algorithm, context, buffer, length);
+    }
+    free(buffer);
+    return true;
+  }
+
+  // include writes the file is still holding on to
+  if (file->is_open && file->file != NULL) {
+    fflush(file->file);
+  }
+
+#ifdef HAVE_SYS_MMAN_H
+  int fd = open(file->path->chars, O_RDONLY);
+  if (fd < 0) return false;
+
+  // map the file a window at a time so that only a window of it is
+  // ever resident on behalf of the hash.
+  struct stat stats;
+  if (fstat(fd, &stats) == 0 && S_ISREG(stats.st_mode)) {
+    off_t offset = 0;
+    while (offset < stats.st_size) {
+      size_t size = stats.st_size - offset < HASH_FILE_MAP_SIZE
+                    ? (size_t) (stats.st_size - offset) : HASH_FILE_MAP_SIZE;
+      void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, offset);
+      if (data == MAP_FAILED) break;
+
+      madvise(data, size, MADV_SEQUENTIAL);
+      hash_update(algorithm, context, data, size);
+      munmap(data, size);
+      offset += (off_t) size;
+    }
+
+    if (offset >= stats.st_size) {
+      close(fd);
+      return true;
+    }
+
+    // read what could not be mapped
+    if (lseek(fd, offset, SEEK_SET) != offset) {
+      close(fd);
+      return false;
+    }
+  }
+
+  unsigned char *buffer = malloc(HASH_FILE_CHUNK_SIZE);
+  if (buffer == NULL) {
+    close(fd);
+    return false;
+  }
+
+  bool ok = true;
+  for (;;) {
+    ssize_t length = read(fd, buffer, HASH_FILE_CHUNK_SIZE);
+    if (length > 0) {
+      hash_update(algorithm, context, buffer, (size_t) length);
+    } else if (length == 0) {
+      break;
+    } else if (errno != EINTR) {
+      ok = false;
+      break;
+    }
+  }
+
+  free(buffer);
+  close(fd);
+  return ok;
+#else
+  FILE *fp = fopen(file->path->chars, "rb");
+  if (fp == NULL) return false;
+
+  unsigned char *buffer = malloc(HASH_FILE_CHUNK_SIZE);
+  if (buffer == NULL) {
+    fclose(fp);
+    return false;
+  }
+
+  size_t length;
+  while ((length = fread(buffer, 1, HASH_FILE_CHUNK_SIZE, fp)) > 0) {
+    hash_update(algorithm, context, buffer, length);
+  }
+
+  bool ok = !ferror(fp);
+  free(buffer);
+  fclose(fp);
+  return ok;
+#endif /* ifdef HAVE_SYS_MMAN_H */
+}
+
+// a context large enough and suitably aligned for every algorithm
+typedef union {
+  MD2_CTX md2;
+  MD4_CTX md4;
+  MD5_CTX md5;
+  SHA1_CTX sha1;
+  SHA256_CTX sha256;
+  SHA512_CTX sha512;
+  FNV164_CTX fnv;
+  WHIRLPOOL_CTX whirlpool;
+  SNEFRU_CTX snefru;
+  GOST_CTX gost;
+  SIPHASH_CTX siphash;
+  unsigned long adler;
+  uint32_t crc;
+} b_hash_context;
+
+/**
+ * the state of a hash context. it is handed to blade code in a ptr
+ * object so that scripts cannot change the counters and buffers of
+ * the algorithm's context.
+ */
+typedef struct {
+  const b_hash_algorithm *algorithm;
+  b_hash_context context;
+} b_hash_state;
+
+static void free_hash_state(b_vm *vm, void *pointer) {
+  FREE(b_hash_state, pointer);
+}
+
+// returns the hash state in value or NULL if value is not one.
+static b_hash_state *hash_state(b_value value) {
+  if (!IS_PTR(value) || AS_PTR(value)->free_fn != free_hash_state) return NULL;
+  return (b_hash_state *) AS_PTR(value)->pointer;
+}
+
+// wraps a hash state in an object blade code can hold.
+static b_obj_ptr *new_hash_state(b_vm *vm, const b_hash_algorithm *algorithm) {
+  b_hash_state *state = ALLOCATE(b_hash_state, 1);
+  state->algorithm = algorithm;
+  return new_ptr(vm, "hash context", state, free_hash_state);
+}
+
+DECLARE_MODULE_METHOD(hash__new_context) {
+  ENFORCE_ARG_RANGE(new_context, 1, 2);
+  ENFORCE_ARG_TYPE(new_context, 0, IS_STRING);
+
+  const b_hash_algorithm *algorithm = find_hash_algorithm(AS_C_STRING(args[0]));
+  if (algorithm == NULL) {
+    RETURN_ERROR("unknown hash algorithm %s", AS_C_STRING(args[0]));
+  }
+
+  const unsigned char *key = NULL;
+  if (arg_count == 2) {
+    ENFORCE_ARG_TYPE(new_context, 1, IS_BYTES);
+    if (AS_BYTES(args[1])->bytes.count != 16) {
+      RETURN_ERROR("hash key must be 16 bytes long");
+    }
+    key = AS_BYTES(args[1])->bytes.bytes;
+  } else if (algorithm->init == siphash_ctx_init) {
+    RETURN_ERROR("%s requires a key", algorithm->name);
+  }
+
+  b_obj_ptr *ptr = new_hash_state(vm, algorithm);
+  b_hash_state *state = (b_hash_state *) ptr->pointer;
+  algorithm->init(&state->context, key);
+  RETURN_OBJ(ptr);
+}
+
+DECLARE_MODULE_METHOD(hash__update_context) {
+  ENFORCE_ARG_COUNT(update_context, 2);
+
+  b_hash_state *state = hash_state(args[0]);
+  if (state == NULL) {
+    RETURN_ERROR("invalid hash context");
+  }
+
+  if (IS_STRING(args[1])) {
+    b_obj_string *string = AS_STRING(args[1]);
+    hash_update(state->algorithm, &state->context, (unsigned char *) string->chars, string->length);
+  } else if (IS_BYTES(args[1])) {
+    b_obj_bytes *bytes = AS_BYTES(args[1]);
+    hash_update(state->algorithm, &state->context, bytes->bytes.bytes, bytes->bytes.count);
+  } else {
+    RETURN_ERROR("update() expects string or bytes");
+  }
+  RETURN;
+}
+
+DECLARE_MODULE_METHOD(hash__copy_context) {
+  ENFORCE_ARG_COUNT(copy_context, 1);
+
+  b_hash_state *state = hash_state(args[0]);
+  if (state == NULL) {
+    RETURN_ERROR("invalid hash context");
+  }
+
+  b_obj_ptr *ptr = new_hash_state(vm, state->algorithm);
+  memcpy(ptr->pointer, state, sizeof(b_hash_state));
+  RETURN_OBJ(ptr);
+}
+
+DECLARE_MODULE_METHOD(hash__context_digest) {
+  ENFORCE_ARG_COUNT(context_digest, 1);
+
+  b_hash_state *state = hash_state(args[0]);
+  if (state == NULL) {
+    RETURN_ERROR("invalid hash context");
+  }
+
+  // finish a copy so that more data can still be added to the context
+  b_hash_context context;
+  memcpy(&context, &state->context, sizeof(b_hash_context));
+
+  unsigned char digest[HASH_MAX_DIGEST_SIZE];
+  state->algorithm->final(&context, digest);
+  RETURN_VALUE(hash_digest_value(vm, state->algorithm, digest));
+}
+
+// the hmac block size. every algorithm uses 64 bytes for compatibility
+// with the digests hash.hmac() has always returned.
+#define HMAC_BLOCK_SIZE 64
+
+static bool hmac_input(b_value value, const unsigned char **data, size_t *length) {
+  if (IS_STRING(value)) {
+    *data = (unsigned char *) AS_STRING(value)->chars;
+    *length = AS_STRING(value)->length;
+  } else if (IS_BYTES(value)) {
+    *data = AS_BYTES(value)->bytes.bytes;
+    *length = AS_BYTES(value)->bytes.count;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+DECLARE_MODULE_METHOD(hash__hmac_digest) {
+  ENFORCE_ARG_COUNT(hmac_digest, 3);
+  ENFORCE_ARG_TYPE(hmac_digest, 0, IS_STRING);
+
+  const b_hash_algorithm *algorithm = find_hash_algorithm(AS_C_STRING(args[0]));
+  if (algorithm == NULL || algorithm->format != DIGEST_HEX) {
+    RETURN_ERROR("invalid HMAC method");
+  }
+
+  const unsigned char *key, *data;
+  size_t key_length, data_length;
+  if (!hmac_input(args[1], &key, &key_length) || !hmac_input(args[2], &data, &data_length)) {
+    RETURN_ERROR("hmac() expects string or bytes");
+  }
+
+  b_hash_context context;
+  unsigned char digest[HASH_MAX_DIGEST_SIZE];
+
+  // keys longer than the block size are shortened by hashing them
+  if (key_length > HMAC_BLOCK_SIZE) {
+    algorithm->init(&context, NULL);
+    hash_update(algorithm, &context, key, key_length);
+    algorithm->final(&context, digest);
+    key = digest;
+    key_length = algorithm->digest_size;
+  }
+
+  unsigned char inner[HMAC_BLOCK_SIZE], outer[HMAC_BLOCK_SIZE];
+  for (size_t i = 0; i < HMAC_BLOCK_SIZE; i++) {
+    unsigned char k = i < key_length ? key[i] : 0;
+    inner[i] = k ^ 0x36;
+    outer[i] = k ^ 0x5c;
+  }
+
+  algorithm->init(&context, NULL);
+  algorithm->update(&context, inner, HMAC_BLOCK_SIZE);
+  hash_update(algorithm, &context, data, data_length);
+  algorithm->final(&context, digest);
+
+  algorithm->init(&context, NULL);
+  algorithm->update(&context, outer, HMAC_BLOCK_SIZE);
+  algorithm->update(&context, digest, algorithm->digest_size);
+  algorithm->final(&context, digest);
+
+  RETURN_VALUE(hash_digest_value(vm, algorithm, digest));
+}
+
+#undef HMAC_BLOCK_SIZE
+
+// hashes a whole file and returns its digest to blade code
+static bool hash_file_digest(b_vm *vm, int arg_count, b_value *args, const b_hash_algorithm *algorithm,
+                             b_obj_file *file, const unsigned char *key) {
+  if (!is_std_file(file) && !file_exists(file->path->chars)) {
+    RETURN_ERROR("%s_file() file not found", algorithm->name);
+  }
+
+  b_hash_context context;
+  algorithm->init(&context, key);
+  if (!hash_file(algorithm, &context, file)) {
+    RETURN_ERROR("%s_file() could not read file: %s", algorithm->name, strerror(errno));
+  }
+
+  unsigned char digest[HASH_MAX_DIGEST_SIZE];
+  algorithm->final(&context, digest);
+  RETURN_VALUE(hash_digest_value(vm, algorithm, digest));
+}
+
+DECLARE_MODULE_METHOD(hash__file_digest) {
+  ENFORCE_ARG_RANGE(file_digest, 2, 3);
+  ENFORCE_ARG_TYPE(file_digest, 0, IS_STRING);
+  ENFORCE_ARG_TYPE(file_digest, 1, IS_FILE);
+
+  const b_hash_algorithm *algorithm = find_hash_algorithm(AS_C_STRING(args[0]));
+  if (algorithm == NULL) {
+    RETURN_ERROR("unknown hash algorithm %s", AS_C_STRING(args[0]));
+  }
+
+  const unsigned char *key = NULL;
+  if (arg_count == 3) {
+    ENFORCE_ARG_TYPE(file_digest, 2, IS_BYTES);
+    if (AS_BYTES(args[2])->bytes.count != 16) {
+      RETURN_ERROR("hash key must be 16 bytes long");
+    }
+    key = AS_BYTES(args[2])->bytes.bytes;
+  } else if (algorithm->init == siphash_ctx_init) {
+    RETURN_ERROR("%s requires a key", algorithm->name);
+  }
+
+  return hash_file_digest(vm, arg_count, args, algorithm, AS_FILE(args[1]), key);
+}
+
+DECLARE_MODULE_METHOD(hash__md5_file) {
+  ENFORCE_ARG_COUNT(md5_file, 1);
+  ENFORCE_ARG_TYPE(md5_file, 0, IS_FILE);
+
+  const b_hash_algorithm *algorithm = find_hash_algorithm("md5");
+  return hash_file_digest(vm, arg_count, args, algorithm, AS_FILE(args[0]), NULL);
+}
 
 DECLARE_MODULE_METHOD(hash__hash) {
   ENFORCE_ARG_COUNT(hash, 1);
@@ -398,6 +1025,7 @@ CREATE_MODULE_LOADER(hash) {
       {"hash",      true,  GET_MODULE_METHOD(hash__hash)},
       {"adler32",   true,  GET_MODULE_METHOD(hash__adler32)},
       {"crc32",     true,  GET_MODULE_METHOD(hash__crc32)},
+      {"crc32c",    true,  GET_MODULE_METHOD(hash__crc32c)},
       {"md2",       true,  GET_MODULE_METHOD(hash__md2)},
       {"md4",       true,  GET_MODULE_METHOD(hash__md4)},
       {"md5",       true,  GET_MODULE_METHOD(hash__md5)},
@@ -405,6 +1033,7 @@ CREATE_MODULE_LOADER(hash) {
       {"sha1",      true,  GET_MODULE_METHOD(hash__sha1)},
       {"sha224",    true,  GET_MODULE_METHOD(hash__sha224)},
       {"sha256",    true,  GET_MODULE_METHOD(hash__sha256)},
+      {"sha256_many", true, GET_MODULE_METHOD(hash__sha256_many)},
       {"sha384",    true,  GET_MODULE_METHOD(hash__sha384)},
       {"sha512",    true,  GET_MODULE_METHOD(hash__sha512)},
       {"fnv1",      true,  GET_MODULE_METHOD(hash__fnv1)},
@@ -415,6 +1044,12 @@ CREATE_MODULE_LOADER(hash) {
       {"snefru",    true,  GET_MODULE_METHOD(hash__snefru)},
       {"siphash",   true,  GET_MODULE_METHOD(hash__siphash)},
       {"gost",      true,  GET_MODULE_METHOD(hash__gost)},
+      {"new_context",    true,  GET_MODULE_METHOD(hash__new_context)},
+      {"update_context", true,  GET_MODULE_METHOD(hash__update_context)},
+      {"copy_context",   true,  GET_MODULE_METHOD(hash__copy_context)},
+      {"context_digest", true,  GET_MODULE_METHOD(hash__context_digest)},
+      {"file_digest",    true,  GET_MODULE_METHOD(hash__file_digest)},
+      {"hmac_digest",    true,  GET_MODULE_METHOD(hash__hmac_digest)},
       {NULL,        false, NULL},
   };
 
@@ -347,25 +347,4 @@ static char *MD5String(unsigned char *string, int length) {
   return MD5DigestToString(digest);
 }
 
-static char *MD5File(char *filename) {
-  FILE *file;
-  MD5_CTX context;
-
-  if ((file = fopen(filename, "rb")) == NULL)
-    return NULL;
-
-  int len;
-  unsigned char buffer[1024];
-  unsigned char digest[16];
-
-  MD5Init(&context);
-  while ((len = (int) fread(buffer, 1, 1024, file)))
-    MD5Update(&context, buffer, len);
-  MD5Final(digest, &context);
-
-  fclose(file);
-
-  return MD5DigestToString(digest);
-}
-
 #endif // BLADE_MODULE_HASH_MD5_H
@@ -13,6 +13,11 @@
 #include "solarisfixes.h"
 #endif
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHA1_X86 1
+#include <immintrin.h>
+#endif
+
 typedef struct {
   uint32_t state[5];
   uint32_t count[2];
@@ -162,6 +167,99 @@ CHAR64LONG16* block = (const CHAR64LONG16*)buffer;
 }
 
 
+typedef void (*sha1_blocks_fn)(uint32_t state[5], const unsigned char *data, size_t blocks);
+
+static void sha1_blocks_generic(uint32_t state[5], const unsigned char *data, size_t blocks) {
+  while (blocks-- > 0) {
+    SHA1Transform(state, data);
+    data += 64;
+  }
+}
+
+#ifdef SHA1_X86
+
+/*
+ * four rounds with the SHA extensions. cur holds the message words of
+ * the rounds and next, far and prev the words 4, 8 and 12 rounds after
+ * it. the conditions only depend on the constant g and fold away.
+ */
+#define SHA1_NI_ROUNDS(g, e_in, e_out, cur, next, far, prev)                  \
+  e_in = _mm_sha1nexte_epu32(e_in, cur);                                       \
+  e_out = abcd;                                                                \
+  if ((g) >= 3 && (g) <= 18) next = _mm_sha1msg2_epu32(next, cur);            \
+  abcd = _mm_sha1rnds4_epu32(abcd, e_in, (g) / 5);                             \
+  if ((g) >= 1 && (g) <= 16) prev = _mm_sha1msg1_epu32(prev, cur);            \
+  if ((g) >= 2 && (g) <= 17) far = _mm_xor_si128(far, cur);
+
+__attribute__((target("sha,sse4.1")))
+static void sha1_blocks_shani(uint32_t state[5], const unsigned char *data, size_t blocks) {
+  const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+  __m128i abcd, e0, e1, msg0, msg1, msg2, msg3, abcd_save, e0_save;
+
+  abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) state), 0x1b);
+  e0 = _mm_set_epi32((int) state[4], 0, 0, 0);
+
+  while (blocks-- > 0) {
+    abcd_save = abcd;
+    e0_save = e0;
+
+    msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 0)), mask);
+    e0 = _mm_add_epi32(e0, msg0);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+    msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16)), mask);
+    SHA1_NI_ROUNDS(1, e1, e0, msg1, msg2, msg3, msg0)
+    msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 32)), mask);
+    SHA1_NI_ROUNDS(2, e0, e1, msg2, msg3, msg0, msg1)
+    msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 48)), mask);
+    SHA1_NI_ROUNDS(3, e1, e0, msg3, msg0, msg1, msg2)
+    SHA1_NI_ROUNDS(4, e0, e1, msg0, msg1, msg2, msg3)
+    SHA1_NI_ROUNDS(5, e1, e0, msg1, msg2, msg3, msg0)
+    SHA1_NI_ROUNDS(6, e0, e1, msg2, msg3, msg0, msg1)
+    SHA1_NI_ROUNDS(7, e1, e0, msg3, msg0, msg1, msg2)
+    SHA1_NI_ROUNDS(8, e0, e1, msg0, msg1, msg2, msg3)
+    SHA1_NI_ROUNDS(9, e1, e0, msg1, msg2, msg3, msg0)
+    SHA1_NI_ROUNDS(10, e0, e1, msg2, msg3, msg0, msg1)
+    SHA1_NI_ROUNDS(11, e1, e0, msg3, msg0, msg1, msg2)
+    SHA1_NI_ROUNDS(12, e0, e1, msg0, msg1, msg2, msg3)
+    SHA1_NI_ROUNDS(13, e1, e0, msg1, msg2, msg3, msg0)
+    SHA1_NI_ROUNDS(14, e0, e1, msg2, msg3, msg0, msg1)
+    SHA1_NI_ROUNDS(15, e1, e0, msg3, msg0, msg1, msg2)
+    SHA1_NI_ROUNDS(16, e0, e1, msg0, msg1, msg2, msg3)
+    SHA1_NI_ROUNDS(17, e1, e0, msg1, msg2, msg3, msg0)
+    SHA1_NI_ROUNDS(18, e0, e1, msg2, msg3, msg0, msg1)
+    SHA1_NI_ROUNDS(19, e1, e0, msg3, msg0, msg1, msg2)
+
+    e0 = _mm_sha1nexte_epu32(e0, e0_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+    data += 64;
+  }
+
+  _mm_storeu_si128((__m128i *) state, _mm_shuffle_epi32(abcd, 0x1b));
+  state[4] = (uint32_t) _mm_extract_epi32(e0, 3);
+}
+
+#undef SHA1_NI_ROUNDS
+
+#endif /* SHA1_X86 */
+
+static sha1_blocks_fn sha1_blocks = NULL;
+
+static void sha1_compress(uint32_t state[5], const unsigned char *data, size_t blocks) {
+  if (sha1_blocks == NULL) {
+    sha1_blocks = sha1_blocks_generic;
+#ifdef SHA1_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+      sha1_blocks = sha1_blocks_shani;
+    }
+#endif /* SHA1_X86 */
+  }
+  sha1_blocks(state, data, blocks);
+}
+
+
 /* SHA1Init - Initialize new context */
 
 static void SHA1Init(SHA1_CTX *context) {
@@ -188,9 +286,10 @@ static void SHA1Update(SHA1_CTX *context, const unsigned char *data, uint32_t le
   j = (j >> 3) & 63;
   if ((j + len) > 63) {
     memcpy(&context->buffer[j], data, (i = 64 - j));
-    SHA1Transform(context->state, context->buffer);
-    for (; i + 63 < len; i += 64) {
-      SHA1Transform(context->state, &data[i]);
+    sha1_compress(context->state, context->buffer, 1);
+    if (len - i > 63) {
+      sha1_compress(context->state, &data[i], (len - i) / 64);
+      i += (len - i) & ~63u;
     }
     j = 0;
   } else i = 0;
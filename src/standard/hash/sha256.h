@@ -1,6 +1,11 @@
 #ifndef BLADE_MODULE_HASH_SHA256_H
 #define BLADE_MODULE_HASH_SHA256_H
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHA256_X86 1
+#include <immintrin.h>
+#endif
+
 #define SHA256_HASH_SIZE 32
 
 /* Hash size in 32-bit words */
@@ -343,6 +348,191 @@ static void SHA256Guts(SHA256_CTX *sc, const uint32_t *cbuf) {
   sc->hash[7] += h;
 }
 
+typedef void (*sha256_blocks_fn)(SHA256_CTX *sc, const uint8_t *data, size_t blocks);
+
+static void sha256_blocks_generic(SHA256_CTX *sc, const uint8_t *data, size_t blocks) {
+  uint32_t words[16];
+  while (blocks-- > 0) {
+    memcpy(words, data, 64);
+    SHA256Guts(sc, words);
+    data += 64;
+  }
+}
+
+#ifdef SHA256_X86
+
+/*
+ * four rounds with the SHA extensions. cur holds the message words of
+ * the rounds, next and prev the words four rounds after and before it.
+ * the conditions only depend on the constant g and fold away.
+ */
+#define SHA256_NI_ROUNDS(g, cur, next, prev)                                   \
+  msg = _mm_add_epi32(cur, _mm_loadu_si128((const __m128i *) &K[4 * (g)]));    \
+  state1 = _mm_sha256rnds2_epu32(state1, state0, msg);                         \
+  if ((g) >= 3 && (g) < 15) {                                                  \
+    next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4));                 \
+    next = _mm_sha256msg2_epu32(next, cur);                                    \
+  }                                                                            \
+  msg = _mm_shuffle_epi32(msg, 0x0e);                                          \
+  state0 = _mm_sha256rnds2_epu32(state0, state1, msg);                         \
+  if ((g) >= 1 && (g) < 13) {                                                  \
+    prev = _mm_sha256msg1_epu32(prev, cur);                                    \
+  }
+
+__attribute__((target("sha,sse4.1")))
+static void sha256_blocks_shani(SHA256_CTX *sc, const uint8_t *data, size_t blocks) {
+  const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i state0, state1, msg, tmp, msg0, msg1, msg2, msg3, abef, cdgh;
+
+  // the instructions want the state as ABEF and CDGH
+  tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &sc->hash[0]), 0xb1);
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) &sc->hash[4]), 0x1b);
+  state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+  while (blocks-- > 0) {
+    abef = state0;
+    cdgh = state1;
+
+    msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 0)), mask);
+    SHA256_NI_ROUNDS(0, msg0, msg1, msg3)
+    msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 16)), mask);
+    SHA256_NI_ROUNDS(1, msg1, msg2, msg0)
+    msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 32)), mask);
+    SHA256_NI_ROUNDS(2, msg2, msg3, msg1)
+    msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (data + 48)), mask);
+    SHA256_NI_ROUNDS(3, msg3, msg0, msg2)
+    SHA256_NI_ROUNDS(4, msg0, msg1, msg3)
+    SHA256_NI_ROUNDS(5, msg1, msg2, msg0)
+    SHA256_NI_ROUNDS(6, msg2, msg3, msg1)
+    SHA256_NI_ROUNDS(7, msg3, msg0, msg2)
+    SHA256_NI_ROUNDS(8, msg0, msg1, msg3)
+    SHA256_NI_ROUNDS(9, msg1, msg2, msg0)
+    SHA256_NI_ROUNDS(10, msg2, msg3, msg1)
+    SHA256_NI_ROUNDS(11, msg3, msg0, msg2)
+    SHA256_NI_ROUNDS(12, msg0, msg1, msg3)
+    SHA256_NI_ROUNDS(13, msg1, msg2, msg0)
+    SHA256_NI_ROUNDS(14, msg2, msg3, msg1)
+    SHA256_NI_ROUNDS(15, msg3, msg0, msg2)
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+    data += 64;
+  }
+
+  // back to ABCD and EFGH
+  tmp = _mm_shuffle_epi32(state0, 0x1b);
+  state1 = _mm_shuffle_epi32(state1, 0xb1);
+  _mm_storeu_si128((__m128i *) &sc->hash[0], _mm_blend_epi16(tmp, state1, 0xf0));
+  _mm_storeu_si128((__m128i *) &sc->hash[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+#undef SHA256_NI_ROUNDS
+
+#define SHA256_X8_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+/**
+ * compresses one block of each of eight independent messages at once.
+ * state[i] holds word i of the eight states, one message per lane.
+ */
+__attribute__((target("avx2")))
+static void sha256_blocks_x8(__m256i state[8], const uint8_t *blocks[8]) {
+  __m256i w[16];
+  __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+  __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+
+  for (int t = 0; t < 64; t++) {
+    __m256i wt;
+    if (t < 16) {
+      uint32_t words[8];
+      for (int lane = 0; lane < 8; lane++) {
+        uint32_t word;
+        memcpy(&word, blocks[lane] + 4 * t, 4);
+        words[lane] = __builtin_bswap32(word);
+      }
+      wt = _mm256_loadu_si256((const __m256i *) words);
+    } else {
+      __m256i w2 = w[(t - 2) & 15], w15 = w[(t - 15) & 15];
+      __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(SHA256_X8_ROTR(w15, 7), SHA256_X8_ROTR(w15, 18)),
+                                    _mm256_srli_epi32(w15, 3));
+      __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(SHA256_X8_ROTR(w2, 17), SHA256_X8_ROTR(w2, 19)),
+                                    _mm256_srli_epi32(w2, 10));
+      wt = _mm256_add_epi32(_mm256_add_epi32(s1, w[(t - 7) & 15]), _mm256_add_epi32(s0, w[t & 15]));
+    }
+    w[t & 15] = wt;
+
+    __m256i big_s1 = _mm256_xor_si256(_mm256_xor_si256(SHA256_X8_ROTR(e, 6), SHA256_X8_ROTR(e, 11)),
+                                      SHA256_X8_ROTR(e, 25));
+    __m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+    __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, big_s1),
+                                  _mm256_add_epi32(_mm256_add_epi32(ch, wt), _mm256_set1_epi32((int) K[t])));
+    __m256i big_s0 = _mm256_xor_si256(_mm256_xor_si256(SHA256_X8_ROTR(a, 2), SHA256_X8_ROTR(a, 13)),
+                                      SHA256_X8_ROTR(a, 22));
+    __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+    __m256i t2 = _mm256_add_epi32(big_s0, maj);
+
+    h = g;
+    g = f;
+    f = e;
+    e = _mm256_add_epi32(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = _mm256_add_epi32(t1, t2);
+  }
+
+  state[0] = _mm256_add_epi32(state[0], a);
+  state[1] = _mm256_add_epi32(state[1], b);
+  state[2] = _mm256_add_epi32(state[2], c);
+  state[3] = _mm256_add_epi32(state[3], d);
+  state[4] = _mm256_add_epi32(state[4], e);
+  state[5] = _mm256_add_epi32(state[5], f);
+  state[6] = _mm256_add_epi32(state[6], g);
+  state[7] = _mm256_add_epi32(state[7], h);
+}
+
+#undef SHA256_X8_ROTR
+
+#endif /* SHA256_X86 */
+
+static sha256_blocks_fn sha256_blocks = NULL;
+static bool sha256_has_x8 = false;
+
+/**
+ * picks the fastest block function the processor supports.
+ * BLADE_SHA256 may name one of generic, avx2 or shani to force that
+ * implementation, e.g. to test each of them on the same machine. a
+ * choice the processor cannot run falls back to the generic one.
+ */
+static void sha256_select(void) {
+  sha256_blocks = sha256_blocks_generic;
+  const char *forced = getenv("BLADE_SHA256");
+  if (forced != NULL && strcmp(forced, "generic") == 0) return;
+
+#ifdef SHA256_X86
+  __builtin_cpu_init();
+  bool has_shani = __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+  bool has_avx2 = __builtin_cpu_supports("avx2");
+
+  if (forced != NULL && strcmp(forced, "avx2") == 0) {
+    sha256_has_x8 = has_avx2;
+  } else if (forced != NULL && strcmp(forced, "shani") == 0) {
+    if (has_shani) sha256_blocks = sha256_blocks_shani;
+  } else if (has_shani) {
+    sha256_blocks = sha256_blocks_shani;
+  } else if (has_avx2) {
+    // with the SHA extensions a single message is hashed faster than
+    // eight at a time, so eight lanes are only used without them.
+    sha256_has_x8 = true;
+  }
+#endif /* SHA256_X86 */
+}
+
+static void sha256_compress(SHA256_CTX *sc, const uint8_t *data, size_t blocks) {
+  if (sha256_blocks == NULL) sha256_select();
+  sha256_blocks(sc, data, blocks);
+}
+
 void sha256_update(SHA256_CTX *sc, const void *vdata, uint32_t len) {
   const uint8_t *data = vdata;
   uint32_t bufferBytesLeft;
@@ -389,14 +579,14 @@ void sha256_update(SHA256_CTX *sc, const void *vdata, uint32_t len) {
     sc->bufferLength += len;
   }
 #else /* SHA256_FAST_COPY */
-  while (len) {
+  if (sc->bufferLength) {
     bufferBytesLeft = 64L - sc->bufferLength;
 
     bytesToCopy = bufferBytesLeft;
     if (bytesToCopy > len)
       bytesToCopy = len;
 
-    memcpy (&sc->buffer.bytes[sc->bufferLength], data, bytesToCopy);
+    memcpy(&sc->buffer.bytes[sc->bufferLength], data, bytesToCopy);
 
     sc->totalLength += bytesToCopy * 8L;
 
@@ -405,11 +595,30 @@ void sha256_update(SHA256_CTX *sc, const void *vdata, uint32_t len) {
     len -= bytesToCopy;
 
     if (sc->bufferLength == 64L) {
-      SHA256Guts(sc, sc->buffer.words);
+      sha256_compress(sc, sc->buffer.bytes, 1);
       needBurn = 1;
       sc->bufferLength = 0L;
     }
   }
+
+  /* whole blocks are hashed straight from the input */
+  if (len > 63L) {
+    uint32_t blocks = len / 64L;
+    sha256_compress(sc, data, blocks);
+    needBurn = 1;
+
+    sc->totalLength += (uint64_t) blocks * 512L;
+    data += blocks * 64L;
+    len -= blocks * 64L;
+  }
+
+  if (len) {
+    memcpy(&sc->buffer.bytes[sc->bufferLength], data, len);
+
+    sc->totalLength += len * 8L;
+
+    sc->bufferLength += len;
+  }
 #endif /* SHA256_FAST_COPY */
 
   if (needBurn)
@@ -445,6 +654,149 @@ void sha256_final(SHA256_CTX *sc, uint8_t hash[SHA256_HASH_SIZE]) {
   }
 }
 
+static void sha256_digest(const uint8_t *data, size_t length, uint8_t digest[SHA256_HASH_SIZE]) {
+  SHA256_CTX ctx;
+  sha256_init(&ctx);
+  while (length > UINT32_MAX) {
+    sha256_update(&ctx, data, UINT32_MAX & ~63u);
+    data += UINT32_MAX & ~63u;
+    length -= UINT32_MAX & ~63u;
+  }
+  sha256_update(&ctx, data, (uint32_t) length);
+  sha256_final(&ctx, digest);
+}
+
+#ifdef SHA256_X86
+
+/* a message being hashed in one of the eight lanes */
+typedef struct {
+  int message; /* -1 when the lane is idle */
+  const uint8_t *data;
+  size_t blocks; /* whole blocks left in data */
+  uint8_t tail[128]; /* the rest of the message and the padding */
+  int tail_blocks;
+  int tail_done;
+} sha256_lane;
+
+static void sha256_lane_start(sha256_lane *lane, uint32_t lanes[8][8], int index,
+                              int message, const uint8_t *data, size_t length) {
+  static const uint32_t iv[8] = {
+      0x6a09e667L, 0xbb67ae85L, 0x3c6ef372L, 0xa54ff53aL,
+      0x510e527fL, 0x9b05688cL, 0x1f83d9abL, 0x5be0cd19L
+  };
+
+  size_t rest = length % 64;
+  lane->message = message;
+  lane->data = data;
+  lane->blocks = length / 64;
+  lane->tail_blocks = rest + 9 <= 64 ? 1 : 2;
+  lane->tail_done = 0;
+
+  memset(lane->tail, 0, sizeof(lane->tail));
+  memcpy(lane->tail, data + length - rest, rest);
+  lane->tail[rest] = 0x80;
+
+  uint64_t bits = (uint64_t) length * 8;
+  uint8_t *end = lane->tail + 64 * lane->tail_blocks;
+  for (int i = 1; i <= 8; i++) {
+    end[-i] = (uint8_t) (bits >> (8 * (i - 1)));
+  }
+
+  for (int i = 0; i < 8; i++) {
+    lanes[i][index] = iv[i];
+  }
+}
+
+__attribute__((target("avx2")))
+static void sha256_many_x8(const uint8_t **data, const size_t *lengths, int count,
+                           uint8_t (*digests)[SHA256_HASH_SIZE]) {
+  static const uint8_t idle[64] = {0};
+  uint32_t lanes[8][8] __attribute__((aligned(32)));
+  sha256_lane lane[8];
+  const uint8_t *blocks[8];
+  __m256i state[8];
+
+  int next = 0, active = 0;
+  for (int i = 0; i < 8; i++) {
+    if (next < count) {
+      sha256_lane_start(&lane[i], lanes, i, next, data[next], lengths[next]);
+      next++;
+      active++;
+    } else {
+      lane[i].message = -1;
+    }
+  }
+
+  while (active > 0) {
+    for (int i = 0; i < 8; i++) {
+      if (lane[i].message < 0) {
+        blocks[i] = idle;
+      } else if (lane[i].blocks > 0) {
+        blocks[i] = lane[i].data;
+      } else {
+        blocks[i] = lane[i].tail + 64 * lane[i].tail_done;
+      }
+    }
+
+    for (int i = 0; i < 8; i++) {
+      state[i] = _mm256_load_si256((const __m256i *) lanes[i]);
+    }
+    sha256_blocks_x8(state, blocks);
+    for (int i = 0; i < 8; i++) {
+      _mm256_store_si256((__m256i *) lanes[i], state[i]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+      if (lane[i].message < 0) continue;
+
+      if (lane[i].blocks > 0) {
+        lane[i].data += 64;
+        lane[i].blocks--;
+        continue;
+      }
+      if (++lane[i].tail_done < lane[i].tail_blocks) continue;
+
+      uint8_t *digest = digests[lane[i].message];
+      for (int j = 0; j < 8; j++) {
+        digest[4 * j] = (uint8_t) (lanes[j][i] >> 24);
+        digest[4 * j + 1] = (uint8_t) (lanes[j][i] >> 16);
+        digest[4 * j + 2] = (uint8_t) (lanes[j][i] >> 8);
+        digest[4 * j + 3] = (uint8_t) lanes[j][i];
+      }
+
+      if (next < count) {
+        sha256_lane_start(&lane[i], lanes, i, next, data[next], lengths[next]);
+        next++;
+      } else {
+        lane[i].message = -1;
+        active--;
+      }
+    }
+  }
+}
+
+#endif /* SHA256_X86 */
+
+/**
+ * computes the sha256 digests of count messages. without the SHA
+ * extensions, processors with AVX2 hash eight messages at a time.
+ */
+static void sha256_many(const uint8_t **data, const size_t *lengths, int count,
+                        uint8_t (*digests)[SHA256_HASH_SIZE]) {
+  if (sha256_blocks == NULL) sha256_select();
+
+#ifdef SHA256_X86
+  if (sha256_has_x8 && count > 1) {
+    sha256_many_x8(data, lengths, count, digests);
+    return;
+  }
+#endif /* SHA256_X86 */
+
+  for (int i = 0; i < count; i++) {
+    sha256_digest(data[i], lengths[i], digests[i]);
+  }
+}
+
 static char *sha256_string(unsigned char *string, int length) {
   SHA256_CTX ctx;
   unsigned char digest[SHA256_HASH_SIZE];
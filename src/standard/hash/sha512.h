@@ -366,7 +366,13 @@ static void SHA512_Update(SHA512_CTX *context, void *datain, size_t len) {
   }
   while (len >= SHA512_BLOCK_LENGTH) {
     /* Process as many complete blocks as we can */
-    SHA512_Transform(context, (sha2_word64 *) data);
+    if (((uintptr_t) data & (sizeof(sha2_word64) - 1)) == 0) {
+      SHA512_Transform(context, (sha2_word64 *) data);
+    } else {
+      /* Streamed input need not be word aligned, so work on a copy */
+      SHA512_MEMCPY_BCOPY(context->buffer, data, SHA512_BLOCK_LENGTH);
+      SHA512_Transform(context, (sha2_word64 *) context->buffer);
+    }
     SHA512_ADDINC128(context->bitcount, SHA512_BLOCK_LENGTH << 3);
     len -= SHA512_BLOCK_LENGTH;
     data += SHA512_BLOCK_LENGTH;
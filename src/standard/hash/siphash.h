@@ -28,6 +28,7 @@
 */
 
 #include <stdint.h>
+#include <string.h>
 
 #ifndef _le64toh
 #if IS_LITTLE_ENDIAN
@@ -108,4 +109,73 @@ uint64_t siphash24(const void *src, unsigned long src_sz, const char key[16]) {
   return (v0 ^ v1) ^ (v2 ^ v3);
 }
 
+/* incremental SipHash-2-4 for input that arrives in pieces */
+typedef struct {
+  uint64_t v0, v1, v2, v3;
+  uint64_t length;
+  unsigned char buffer[8];
+} SIPHASH_CTX;
+
+static inline uint64_t siphash_load64(const unsigned char *p) {
+  uint64_t word;
+  memcpy(&word, p, 8);
+  return _le64toh(word);
+}
+
+static inline void siphash_compress(SIPHASH_CTX *context, uint64_t mi) {
+  uint64_t v0 = context->v0, v1 = context->v1, v2 = context->v2, v3 = context->v3;
+  v3 ^= mi;
+  SIP_DOUBLE_ROUND(v0, v1, v2, v3);
+  v0 ^= mi;
+  context->v0 = v0, context->v1 = v1, context->v2 = v2, context->v3 = v3;
+}
+
+static void SIPHASHInit(SIPHASH_CTX *context, const unsigned char key[16]) {
+  uint64_t k0 = siphash_load64(key);
+  uint64_t k1 = siphash_load64(key + 8);
+
+  context->v0 = k0 ^ 0x736f6d6570736575ULL;
+  context->v1 = k1 ^ 0x646f72616e646f6dULL;
+  context->v2 = k0 ^ 0x6c7967656e657261ULL;
+  context->v3 = k1 ^ 0x7465646279746573ULL;
+  context->length = 0;
+}
+
+static void SIPHASHUpdate(SIPHASH_CTX *context, const unsigned char *input, size_t len) {
+  size_t pending = context->length & 7;
+  context->length += len;
+
+  if (pending > 0) {
+    size_t take = 8 - pending < len ? 8 - pending : len;
+    memcpy(context->buffer + pending, input, take);
+    input += take;
+    len -= take;
+    if (pending + take < 8) return;
+    siphash_compress(context, siphash_load64(context->buffer));
+  }
+
+  while (len >= 8) {
+    siphash_compress(context, siphash_load64(input));
+    input += 8;
+    len -= 8;
+  }
+
+  memcpy(context->buffer, input, len);
+}
+
+static uint64_t SIPHASHFinal(SIPHASH_CTX *context) {
+  unsigned char tail[8] = {0};
+  memcpy(tail, context->buffer, context->length & 7);
+  uint64_t b = (context->length << 56) | siphash_load64(tail);
+
+  uint64_t v0 = context->v0, v1 = context->v1, v2 = context->v2, v3 = context->v3;
+  v3 ^= b;
+  SIP_DOUBLE_ROUND(v0, v1, v2, v3);
+  v0 ^= b;
+  v2 ^= 0xff;
+  SIP_DOUBLE_ROUND(v0, v1, v2, v3);
+  SIP_DOUBLE_ROUND(v0, v1, v2, v3);
+  return (v0 ^ v1) ^ (v2 ^ v3);
+}
+
 #endif //BLADE_MODULE_HASH_SIPHASH_H
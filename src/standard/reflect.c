@@ -0,0 +1,38 @@
+#include "reflect.h"
+
+/**
+ * insight into how the vm holds values, mostly of use to tests that
+ * need to tell a fast path from its fallback.
+ */
+
+/**
+ * vtable_method(class: class, name: string)
+ *
+ * returns true when calling name on instances of class is answered by
+ * the vtable of the class rather than its methods table.
+ */
+DECLARE_MODULE_METHOD(reflect__vtable_method) {
+  ENFORCE_ARG_COUNT(vtable_method, 2);
+  ENFORCE_ARG_TYPE(vtable_method, 0, IS_CLASS);
+  ENFORCE_ARG_TYPE(vtable_method, 1, IS_STRING);
+
+  RETURN_BOOL(vtable_entry(AS_CLASS(args[0]), AS_STRING(args[1])) != NULL);
+}
+
+CREATE_MODULE_LOADER(reflect) {
+  static b_func_reg module_functions[] = {
+      {"vtable_method", true, GET_MODULE_METHOD(reflect__vtable_method)},
+      {NULL,            false, NULL},
+  };
+
+  static b_module_reg module = {
+      .name = "_reflect",
+      .fields = NULL,
+      .functions = module_functions,
+      .classes = NULL,
+      .preloader = NULL,
+      .unloader = NULL
+  };
+
+  return &module;
+}
@@ -4,6 +4,7 @@
 
 #include "socket.h"
 #include "pathinfo.h"
+#include "blade_file.h"
 
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
@@ -15,6 +16,7 @@
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -49,6 +51,11 @@
 //#include <arpa/nameser.h>
 #include <netdb.h> //hostent
 #include <sys/ioctl.h>
+#include <poll.h>
+
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif /* HAVE_SYS_SENDFILE_H */
 
 #define closesocket close
 
@@ -140,12 +147,6 @@ DECLARE_MODULE_METHOD(socket__connect) {
     RETURN_NUMBER(-1);
   }
 
-  fd_set read_set;
-  FD_ZERO(&read_set);
-  if (!FD_ISSET(sock, &read_set)) {
-    FD_SET(sock, &read_set);//tcp socket
-  }
-
 #ifndef _WIN32
   long arg = fcntl(sock, F_GETFL) | O_NONBLOCK;
   bool non_blocking = fcntl(sock, F_SETFL, arg) == 0;
@@ -176,10 +177,22 @@ DECLARE_MODULE_METHOD(socket__connect) {
     }
   }
 
+#ifndef _WIN32
+  // poll() is not limited to FD_SETSIZE like select() is, so processes
+  // serving many clients can still connect
+  struct pollfd write_set = {sock, POLLOUT, 0};
+  int status = poll(&write_set, 1, time_out);
+#else
   // getting the timeout...
   struct timeval timeout = {(long) (time_out / 1000), (int) ((time_out % 1000) * 1000)};
 
-  if (select(sock + 1, NULL, &read_set, NULL, &timeout)) {
+  fd_set write_set;
+  FD_ZERO(&write_set);
+  FD_SET(sock, &write_set);//tcp socket
+  int status = select(sock + 1, NULL, &write_set, NULL, &timeout);
+#endif /* ifndef _WIN32 */
+
+  if (status > 0) {
     int so_error;
     socklen_t len = sizeof so_error;
 
@@ -269,6 +282,235 @@ DECLARE_MODULE_METHOD(socket__accept) {
   RETURN_OBJ(response);
 }
 
+#ifdef __linux__
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#endif
+#endif
+#ifndef SEND_FLAGS
+#define SEND_FLAGS 0
+#endif
+
+// the stream of a file only open for writing cannot be read from
+static bool is_readable_file(b_obj_file *file) {
+  return is_std_file(file) || strchr(file->mode->chars, 'r') != NULL ||
+         strchr(file->mode->chars, '+') != NULL;
+}
+
+#ifndef _WIN32
+
+/**
+ * sends count bytes of fd from offset (or up to the end of the file when
+ * count is -1) by copying them through a buffer.
+ * this is only used where the kernel cannot send the file by itself.
+ */
+static ssize_t send_file_copy(int sock, int fd, off_t offset, ssize_t count, bool is_pipe) {
+  char buffer[BIGSIZ];
+  ssize_t total = 0;
+
+  while (count < 0 || total < count) {
+    size_t wanted = count < 0 || count - total > BIGSIZ ? BIGSIZ : (size_t) (count - total);
+    ssize_t length = is_pipe ? read(fd, buffer, wanted)
+                             : pread(fd, buffer, wanted, offset + total);
+    if (length < 0 && errno == EINTR) continue;
+    if (length <= 0) break;
+
+    ssize_t sent = 0;
+    while (sent < length) {
+      ssize_t n = send(sock, buffer + sent, (size_t) (length - sent), SEND_FLAGS);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        // data taken from a pipe cannot be put back, so only report what
+        // actually reached the socket
+        if (total + sent > 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+          return total + sent;
+        return -1;
+      }
+      sent += n;
+    }
+    total += sent;
+  }
+  return total;
+}
+
+/**
+ * sends count bytes of fd from offset (or up to the end of the file when
+ * count is -1) without copying them into user space where the platform
+ * allows it. returns the number of bytes sent, which is less than count
+ * when a non-blocking socket is full, or -1 on error.
+ */
+static ssize_t send_file(int sock, int fd, off_t offset, ssize_t count) {
+  struct stat stats;
+  if (fstat(fd, &stats) != 0) {
+    return -1;
+  }
+
+  bool is_pipe = S_ISFIFO(stats.st_mode);
+  if (!is_pipe && count < 0) {
+    count = stats.st_size > offset ? (ssize_t) (stats.st_size - offset) : 0;
+  }
+
+#if defined(HAVE_SYS_SENDFILE_H)
+  ssize_t total = 0;
+  while (count < 0 || total < count) {
+    // the kernel moves at most 0x7ffff000 bytes per call anyway
+    size_t wanted = count < 0 || count - total > 0x7ffff000 ? 0x7ffff000 : (size_t) (count - total);
+    ssize_t sent;
+
+    if (is_pipe) {
+#ifdef SPLICE_F_MOVE
+      sent = splice(fd, NULL, sock, NULL, wanted, SPLICE_F_MOVE | SPLICE_F_MORE);
+#else
+      return send_file_copy(sock, fd, offset, count, is_pipe);
+#endif
+    } else {
+      sent = sendfile(sock, fd, &offset, wanted);
+    }
+
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      // the file system or socket cannot be used with sendfile() so
+      // send the rest the slow way
+      if (total == 0 && (errno == EINVAL || errno == ENOSYS)) {
+        return send_file_copy(sock, fd, offset, count, is_pipe);
+      }
+      return total > 0 ? total : -1;
+    }
+    if (sent == 0) break; // end of file
+    total += sent;
+  }
+  return total;
+#else
+  return send_file_copy(sock, fd, offset, count, is_pipe);
+#endif /* HAVE_SYS_SENDFILE_H */
+}
+
+/**
+ * returns a descriptor to read a file object from. open files (and so
+ * pipes and standard files) share the descriptor of their stream, which
+ * sendfile() reads from an explicit offset once the stream has written
+ * out its buffer and dropped what it read ahead. closed files are
+ * opened, as are files only open for writing, and must be closed with
+ * close_file_descriptor().
+ */
+static int file_descriptor(b_obj_file *file, bool *owned) {
+  *owned = false;
+  if (file->file != NULL) {
+    flush_file(file);
+    if (is_readable_file(file)) {
+      return fileno(file->file);
+    }
+  }
+
+  *owned = true;
+#ifdef O_CLOEXEC
+  return open(file->path->chars, O_RDONLY | O_CLOEXEC);
+#else
+  return open(file->path->chars, O_RDONLY);
+#endif
+}
+
+static void close_file_descriptor(int fd, bool owned) {
+  if (owned) {
+    int error = errno;
+    close(fd);
+    errno = error;
+  }
+}
+
+/**
+ * sends count bytes of a file object from offset (or up to the end of
+ * the file when count is -1) and returns the number of bytes sent or -1.
+ */
+static int64_t send_file_object(int sock, b_obj_file *file, int64_t offset, int64_t count) {
+  bool owned;
+  int fd = file_descriptor(file, &owned);
+  if (fd < 0) {
+    return -1;
+  }
+
+  ssize_t sent = send_file(sock, fd, (off_t) offset, (ssize_t) count);
+  close_file_descriptor(fd, owned);
+  return (int64_t) sent;
+}
+
+#else
+
+/**
+ * sends count bytes of a file object from offset (or up to the end of
+ * the file when count is -1) and returns the number of bytes sent or -1.
+ * the file is copied through a buffer from its stream, which is put back
+ * where it was afterwards.
+ */
+static int64_t send_file_object(int sock, b_obj_file *file, int64_t offset, int64_t count) {
+  if (file->file != NULL) {
+    flush_file(file);
+  }
+
+  bool owned = file->file == NULL || !is_readable_file(file);
+  FILE *fp = owned ? fopen(file->path->chars, "rb") : file->file;
+  if (fp == NULL) {
+    return -1;
+  }
+
+  bool seekable = !is_std_file(file);
+  __int64 position = seekable && !owned ? _ftelli64(fp) : 0;
+  if (seekable && _fseeki64(fp, offset, SEEK_SET) != 0) {
+    if (owned) fclose(fp);
+    return -1;
+  }
+
+  char buffer[BIGSIZ];
+  int64_t total = 0;
+  bool failed = false;
+
+  while (!failed && (count < 0 || total < count)) {
+    size_t wanted = count < 0 || count - total > BIGSIZ ? BIGSIZ : (size_t) (count - total);
+    size_t length = fread(buffer, 1, wanted, fp);
+    if (length == 0) break;
+
+    size_t sent = 0;
+    while (sent < length) {
+      int n = send(sock, buffer + sent, (int) (length - sent), SEND_FLAGS);
+      if (n == SOCKET_ERROR) {
+        failed = true;
+        break;
+      }
+      sent += n;
+    }
+    total += sent;
+  }
+
+  if (owned) {
+    fclose(fp);
+  } else if (seekable) {
+    _fseeki64(fp, position, SEEK_SET);
+  }
+  return failed && total == 0 ? -1 : total;
+}
+
+#endif /* _WIN32 */
+
+DECLARE_MODULE_METHOD(socket__sendfile) {
+  ENFORCE_ARG_COUNT(_sendfile, 4);
+  ENFORCE_ARG_TYPE(_sendfile, 0, IS_NUMBER); // the socket id
+  ENFORCE_ARG_TYPE(_sendfile, 1, IS_FILE); // the file
+  ENFORCE_ARG_TYPE(_sendfile, 2, IS_NUMBER); // offset
+  ENFORCE_ARG_TYPE(_sendfile, 3, IS_NUMBER); // count
+
+  int sock = AS_NUMBER(args[0]);
+  b_obj_file *file = AS_FILE(args[1]);
+  int64_t offset = (int64_t) AS_NUMBER(args[2]);
+  int64_t count = (int64_t) AS_NUMBER(args[3]);
+
+  if (offset < 0) {
+    RETURN_ERROR("offset cannot be negative");
+  }
+
+  RETURN_NUMBER(send_file_object(sock, file, offset, count));
+}
+
 DECLARE_MODULE_METHOD(socket__send) {
   ENFORCE_ARG_COUNT(_send, 3);
   ENFORCE_ARG_TYPE(_send, 0, IS_NUMBER); // the socket id
@@ -284,33 +526,26 @@ DECLARE_MODULE_METHOD(socket__send) {
   if (IS_STRING(data)) {
     content = AS_STRING(data)->chars;
     length = AS_STRING(data)->length;
+  } else if (IS_BYTES(data)) {
+    content = (char *) AS_BYTES(data)->bytes.bytes;
+    length = AS_BYTES(data)->bytes.count;
   } else if (IS_FILE(data)) {
-    content = read_file(realpath(AS_FILE(data)->path->chars, NULL));
-    length = (int) strlen(content);
+    // stream the whole file instead of loading it into memory
+    RETURN_NUMBER(send_file_object(sock, AS_FILE(data), 0, -1));
   } else {
     content = value_to_string(vm, data);
     length = (int) strlen(content);
   }
 
-#ifdef __linux__
-#ifdef MSG_NOSIGNAL
-  flags |= MSG_NOSIGNAL;
-#endif
-#endif
-
-  RETURN_NUMBER(send(sock, content, length, flags));
+  RETURN_NUMBER(send(sock, content, length, flags | SEND_FLAGS));
 }
 
-DECLARE_MODULE_METHOD(socket__recv) {
-  ENFORCE_ARG_COUNT(_recv, 3);
-  ENFORCE_ARG_TYPE(_recv, 0, IS_NUMBER); // the socket id
-  ENFORCE_ARG_TYPE(_recv, 1, IS_NUMBER); // length to read
-  ENFORCE_ARG_TYPE(_recv, 2, IS_NUMBER); // flags
-
-  int sock = AS_NUMBER(args[0]);
-  int length = AS_NUMBER(args[1]);
-  int flags = AS_NUMBER(args[2]);
-
+/**
+ * waits until sock has data to read for as long as its SO_RCVTIMEO
+ * allows (or 5 minutes without one). returns 1 when the socket is
+ * readable, 0 on timeout and -1 on error.
+ */
+static int wait_readable(int sock) {
   struct timeval timeout;
   int option_length = sizeof(timeout);
 
@@ -326,35 +561,155 @@ DECLARE_MODULE_METHOD(socket__recv) {
     timeout.tv_usec = 0;
   }
 
+  int status;
+#ifndef _WIN32
+  // poll() for the same reason as in _connect
+  struct pollfd poll_set = {sock, POLLIN, 0};
+  status = poll(&poll_set, 1, (int) (timeout.tv_sec * 1000 + timeout.tv_usec / 1000));
+#else
   fd_set read_set;
   FD_ZERO(&read_set);
-  if (!FD_ISSET(sock, &read_set)) {
-    FD_SET(sock, &read_set);//tcp socket
+  FD_SET(sock, &read_set);//tcp socket
+  status = select(sock + 1, &read_set, NULL, NULL, &timeout);
+#endif /* ifndef _WIN32 */
+
+  if (status == 0) {
+    errno = ETIMEDOUT;
   }
+  return status > 0 ? 1 : status;
+}
+
+/**
+ * reads at most length bytes from sock into buffer once it is readable.
+ * with MSG_WAITALL in flags, it keeps reading until length bytes arrive
+ * or the peer stops sending, even on non-blocking sockets.
+ * returns the number of bytes read, 0 at the end of the stream and -1
+ * on error or timeout.
+ */
+// whether a failed receive only needs to be tried again
+static bool recv_should_retry(void) {
+#ifndef _WIN32
+  return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+#else
+  int error = WSAGetLastError();
+  return error == WSAEINTR || error == WSAEWOULDBLOCK;
+#endif // !_WIN32
+}
 
-  int status;
-  if ((status = select(sock + 1, &read_set, NULL, NULL, &timeout)) > 0) {
+static int64_t recv_wait(int sock, char *buffer, size_t length, int flags) {
+  bool wait_all = false;
+#ifdef MSG_WAITALL
+  wait_all = (flags & MSG_WAITALL) != 0;
+  flags &= ~MSG_WAITALL;
+#endif
+
+  size_t total = 0;
+  while (total < length) {
+    if (wait_readable(sock) <= 0) {
+      return total > 0 ? (int64_t) total : -1;
+    }
+
+#ifndef _WIN32
+    int64_t count = recv(sock, buffer + total, length - total, flags);
+#else
+    int64_t count = recv(sock, buffer + total, (int) (length - total), flags);
+#endif // !_WIN32
+    if (count < 0) {
+      if (recv_should_retry()) continue;
+      return total > 0 ? (int64_t) total : -1;
+    }
+
+    total += (size_t) count;
+    if (count == 0 || !wait_all) break;
+  }
+  return (int64_t) total;
+}
+
+DECLARE_MODULE_METHOD(socket__recv) {
+  ENFORCE_ARG_COUNT(_recv, 4);
+  ENFORCE_ARG_TYPE(_recv, 0, IS_NUMBER); // the socket id
+  ENFORCE_ARG_TYPE(_recv, 1, IS_NUMBER); // length to read
+  ENFORCE_ARG_TYPE(_recv, 2, IS_NUMBER); // flags
+  ENFORCE_ARG_TYPE(_recv, 3, IS_BOOL); // return bytes
+
+  int sock = AS_NUMBER(args[0]);
+  int length = AS_NUMBER(args[1]);
+  int flags = AS_NUMBER(args[2]);
+  bool as_bytes = AS_BOOL(args[3]);
+
+  int status = wait_readable(sock);
+
+  if (status > 0) {
     int content_length;
     ioctl(sock, FIONREAD, &content_length);
 
+#ifdef MSG_WAITALL
+    // an exact read waits for the bytes that have not arrived yet
+    if (length > 0 && (flags & MSG_WAITALL) != 0)
+      content_length = length;
+#endif
+
     if (content_length > 0) {
       if (length != -1 && length < content_length)
         content_length = length;
 
       char *response = (char *) ALLOCATE(char, (size_t) content_length + 1);
-      ssize_t total_length = recv(sock, response, content_length, flags);
-      response[total_length] = '\0';
+      int64_t total_length = recv_wait(sock, response, content_length, flags);
+
+      if (total_length <= 0) {
+        FREE_ARRAY(char, response, (size_t) content_length + 1);
+        if (total_length == 0) RETURN;
+        RETURN_NUMBER(-1);
+      }
+
+      if (as_bytes) {
+        // binary data is handed over as is instead of being interned,
+        // so the bytes own exactly what they hold and no terminator.
+        response = GROW_ARRAY(char, response, (size_t) content_length + 1, (size_t) total_length);
+        RETURN_OBJ(take_bytes(vm, (unsigned char *) response, (int) total_length));
+      }
 
+      if (total_length < content_length) {
+        response = GROW_ARRAY(char, response, (size_t) content_length + 1, (size_t) total_length + 1);
+      }
+
+      response[total_length] = '\0';
       RETURN_T_STRING(response, total_length);
     }
   } else if (status == 0) {
-    errno = ETIMEDOUT;
     RETURN_NUMBER(-1);
   }
 
   RETURN;
 }
 
+DECLARE_MODULE_METHOD(socket__recv_into) {
+  ENFORCE_ARG_COUNT(_recv_into, 5);
+  ENFORCE_ARG_TYPE(_recv_into, 0, IS_NUMBER); // the socket id
+  ENFORCE_ARG_TYPE(_recv_into, 1, IS_BYTES); // the buffer
+  ENFORCE_ARG_TYPE(_recv_into, 2, IS_NUMBER); // offset
+  ENFORCE_ARG_TYPE(_recv_into, 3, IS_NUMBER); // length to read
+  ENFORCE_ARG_TYPE(_recv_into, 4, IS_NUMBER); // flags
+
+  int sock = AS_NUMBER(args[0]);
+  b_obj_bytes *buffer = AS_BYTES(args[1]);
+  int offset = AS_NUMBER(args[2]);
+  int length = AS_NUMBER(args[3]);
+  int flags = AS_NUMBER(args[4]);
+
+  if (offset < 0 || offset > buffer->bytes.count) {
+    RETURN_ERROR("offset %d out of range", offset);
+  }
+  if (length < 0 || length > buffer->bytes.count - offset) {
+    length = buffer->bytes.count - offset;
+  }
+
+  // the data must not land in storage shared with other bytes
+  unshare_bytes(vm, buffer);
+
+  RETURN_NUMBER(recv_wait(sock, (char *) buffer->bytes.bytes + offset, (size_t) length, flags));
+}
+
 DECLARE_MODULE_METHOD(socket__setsockopt) {
   ENFORCE_ARG_COUNT(_setsockopt, 3);
   ENFORCE_ARG_TYPE(_setsockopt, 0, IS_NUMBER); // the socket id
@@ -1218,6 +1573,41 @@ b_value __socket_SHUT_RDWR(b_vm *vm) {
 #endif
 }
 
+//  process out-of-band data
+b_value __socket_MSG_OOB(b_vm *vm) {
+#ifdef MSG_OOB
+  return NUMBER_VAL(MSG_OOB);
+#else
+  return NUMBER_VAL(-1);
+#endif
+}
+
+//  peek at incoming data without removing it
+b_value __socket_MSG_PEEK(b_vm *vm) {
+#ifdef MSG_PEEK
+  return NUMBER_VAL(MSG_PEEK);
+#else
+  return NUMBER_VAL(-1);
+#endif
+}
+
+//  wait until the full length has been received
+b_value __socket_MSG_WAITALL(b_vm *vm) {
+#ifdef MSG_WAITALL
+  return NUMBER_VAL(MSG_WAITALL);
+#else
+  return NUMBER_VAL(-1);
+#endif
+}
+
+//  do not block for this call only
+b_value __socket_MSG_DONTWAIT(b_vm *vm) {
+#ifdef MSG_DONTWAIT
+  return NUMBER_VAL(MSG_DONTWAIT);
+#else
+  return NUMBER_VAL(-1);
+#endif
+}
 
 //  Maximum queue length specifiable by listen.
 b_value __socket_SOMAXCONN(b_vm *vm) {
@@ -1237,7 +1627,9 @@ CREATE_MODULE_LOADER(socket) {
       {"_create",      false, GET_MODULE_METHOD(socket__create)},
       {"_connect",     false, GET_MODULE_METHOD(socket__connect)},
       {"_send",        false, GET_MODULE_METHOD(socket__send)},
+      {"_sendfile",    false, GET_MODULE_METHOD(socket__sendfile)},
       {"_recv",        false, GET_MODULE_METHOD(socket__recv)},
+      {"_recv_into",   false, GET_MODULE_METHOD(socket__recv_into)},
       {"_setsockopt",  false, GET_MODULE_METHOD(socket__setsockopt)},
       {"_getsockopt",  false, GET_MODULE_METHOD(socket__getsockopt)},
       {"_bind",        false, GET_MODULE_METHOD(socket__bind)},
@@ -1353,6 +1745,14 @@ CREATE_MODULE_LOADER(socket) {
       {"SHUT_WR", true, __socket_SHUT_WR},
       {"SHUT_RDWR", true, __socket_SHUT_RDWR},
 
+      /**
+       * flags for send and receive.
+       */
+      {"MSG_OOB", true, __socket_MSG_OOB},
+      {"MSG_PEEK", true, __socket_MSG_PEEK},
+      {"MSG_WAITALL", true, __socket_MSG_WAITALL},
+      {"MSG_DONTWAIT", true, __socket_MSG_DONTWAIT},
+
       /**
        * Maximum queue length specifiable by listen.
        */
@@ -1373,4 +1773,5 @@ CREATE_MODULE_LOADER(socket) {
 }
 
 #undef BIGSIZ
+#undef SEND_FLAGS
 #undef SMALLSIZ
\ No newline at end of file
@@ -7,6 +7,8 @@
 #include "standard/math.h"
 #include "standard/os.h"
 #include "standard/socket.h"
+#include "standard/event.h"
 #include "standard/hash.h"
+#include "standard/reflect.h"
 
 #endif // BLADE_STANDARD_H
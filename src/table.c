@@ -147,6 +147,23 @@ bool table_set(b_vm *vm, b_table *table, b_value key, b_value value) {
   return is_new;
 }
 
+/**
+ * returns the index of the entry holding key in table->entries or -1.
+ *
+ * the index stays valid until the table is resized, so callers may
+ * cache it as long as they check that the entry still holds key.
+ */
+int table_find_slot(b_table *table, b_value key) {
+  if (table->count == 0 || table->entries == NULL)
+    return -1;
+
+  b_entry *entry = find_entry(table->entries, table->capacity, key);
+  if (IS_EMPTY(entry->key))
+    return -1;
+
+  return (int) (entry - table->entries);
+}
+
 bool table_delete(b_table *table, b_value key) {
   if (table->count == 0)
     return false;
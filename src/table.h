@@ -27,6 +27,8 @@ bool table_get(b_table *table, b_value key, b_value *value);
 
 bool table_delete(b_table *table, b_value key);
 
+int table_find_slot(b_table *table, b_value key);
+
 void table_add_all(b_vm *vm, b_table *from, b_table *to);
 
 b_obj_string *table_find_string(b_table *table, const char *chars, int length,
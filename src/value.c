@@ -377,7 +377,8 @@ static uint32_t hash_object(b_obj *object) {
       return ((b_obj_string *) object)->hash;
 
     default:
-      return 0;
+      // every other object compares by identity, so hash the identity too
+      return hash_bits((uint64_t) (uintptr_t) object);
   }
 }
 
@@ -385,6 +386,9 @@ uint32_t hash_value(b_value value) {
 #if defined(USE_NAN_BOXING) && USE_NAN_BOXING
   if (IS_OBJ(value))
     return hash_object(AS_OBJ(value));
+  // -0 equals 0, so it has to hash like 0 as well
+  if (IS_NUMBER(value) && AS_NUMBER(value) == 0)
+    return hash_double(0);
   return hash_bits(value);
 #else
   switch (value.type) {
@@ -395,7 +399,8 @@ uint32_t hash_value(b_value value) {
     return 7;
 
   case VAL_NUMBER:
-    return hash_double(AS_NUMBER(value));
+    // -0 equals 0, so it has to hash like 0 as well
+    return hash_double(AS_NUMBER(value) == 0 ? 0 : AS_NUMBER(value));
 
   case VAL_OBJ:
     return hash_object(AS_OBJ(value));
@@ -461,7 +466,7 @@ static b_value find_max_value(b_value a, b_value b) {
 /**
  * sorts values in an array using the bubble-sort algorithm
  */
-void sort_values(b_value *values, int count) {
+void sort_values(b_vm *vm, b_value *values, int count) {
   for (int i = 0; i < count; i++) {
     for (int j = 0; j < count; j++) {
       if (values_equal(values[j], find_max_value(values[i], values[j]))) {
@@ -469,13 +474,19 @@ void sort_values(b_value *values, int count) {
         values[i] = values[j];
         values[j] = temp;
 
-        if (IS_LIST(values[i]))
-          sort_values(AS_LIST(values[i])->items.values,
+        // nested views are copied out so that the lists they share
+        // storage with keep their order
+        if (IS_LIST(values[i])) {
+          unshare_list(vm, AS_LIST(values[i]));
+          sort_values(vm, AS_LIST(values[i])->items.values,
                       AS_LIST(values[i])->items.count);
+        }
 
-        if (IS_LIST(values[j]))
-          sort_values(AS_LIST(values[j])->items.values,
+        if (IS_LIST(values[j])) {
+          unshare_list(vm, AS_LIST(values[j]));
+          sort_values(vm, AS_LIST(values[j])->items.values,
                       AS_LIST(values[j])->items.count);
+        }
       }
     }
   }
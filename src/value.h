@@ -149,7 +149,7 @@ uint32_t hash_string(const char *key, int length);
 
 uint32_t hash_value(b_value value);
 
-void sort_values(b_value *values, int count);
+void sort_values(b_vm *vm, b_value *values, int count);
 
 #define STRING_VAL(val) OBJ_VAL(copy_string(vm, val, (int)strlen(val)))
 #define STRING_L_VAL(val, l) OBJ_VAL(copy_string(vm, val, l))
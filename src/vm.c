@@ -13,6 +13,7 @@
 #include "blade_list.h"
 #include "blade_string.h"
 #include "blade_range.h"
+#include "blade_set.h"
 #include "util.h"
 
 #include <math.h>
@@ -22,6 +23,7 @@
 
 // for debugging...
 #include "debug.h"
+#include "jit.h"
 
 static inline void reset_stack(b_vm *vm) {
   vm->stack_top = vm->stack;
@@ -29,18 +31,81 @@ static inline void reset_stack(b_vm *vm) {
   vm->open_up_values = NULL;
 }
 
-static b_value get_stack_trace(b_vm *vm) {
-  char *trace = (char *) calloc(1, sizeof(char));
+static void *grow_vm_array(void *pointer, size_t size) {
+  void *result = realloc(pointer, size);
+  if (result == NULL) {
+    fflush(stdout); // flush out anything on stdout first
+    fprintf(stderr, "stack overflow: out of memory\n");
+    exit(1);
+  }
+  return result;
+}
 
-  if (trace != NULL) {
+/**
+ * grows the value stack until at least needed more values fit.
+ * frame slots, open upvalues and the stack top point into the stack,
+ * so they are moved along with it.
+ */
+static void grow_stack(b_vm *vm, int needed) {
+  int count = (int) (vm->stack_top - vm->stack);
+  int capacity = vm->stack_capacity;
+  while (capacity < count + needed) {
+    capacity = GROW_CAPACITY(capacity);
+  }
+
+  b_value *old_stack = vm->stack;
+  vm->stack = (b_value *) grow_vm_array(vm->stack, sizeof(b_value) * capacity);
+  vm->stack_capacity = capacity;
+  vm->stack_end = vm->stack + capacity;
+  vm->stack_top = vm->stack + count;
 
+  if (vm->stack != old_stack) {
     for (int i = 0; i < vm->frame_count; i++) {
-      b_call_frame *frame = &vm->frames[i];
-      b_obj_func *function = frame->closure->function;
+      vm->frames[i].slots = vm->stack + (vm->frames[i].slots - old_stack);
+    }
+    for (b_obj_up_value *up_value = vm->open_up_values; up_value != NULL; up_value = up_value->next) {
+      up_value->location = vm->stack + (up_value->location - old_stack);
+    }
+  }
+}
 
-      // -1 because the IP is sitting on the next instruction to be executed
-      size_t instruction = frame->ip - function->blob.code - 1;
-      int line = function->blob.lines[instruction];
+void grow_gc_protection(b_vm *vm) {
+  vm->gc_protected_capacity = GROW_CAPACITY(vm->gc_protected_capacity);
+  vm->gc_protected_objects = (b_obj **) grow_vm_array(
+      vm->gc_protected_objects, sizeof(b_obj *) * vm->gc_protected_capacity);
+}
+
+static inline void ensure_stack(b_vm *vm, int needed) {
+  if (vm->stack_top + needed > vm->stack_end) {
+    grow_stack(vm, needed);
+  }
+}
+
+/**
+ * records the active call frames without formatting them.
+ * exceptions raised and caught a few lines later never pay for the text.
+ */
+static b_value capture_stack_trace(b_vm *vm) {
+  b_obj_stack_trace *trace = new_stack_trace(vm, vm->frame_count);
+
+  for (int i = 0; i < vm->frame_count; i++) {
+    b_call_frame *frame = &vm->frames[i];
+    trace->frames[i].function = frame->closure->function;
+    // -1 because the IP is sitting on the next instruction to be executed
+    trace->frames[i].ip = (int) (frame->ip - frame->closure->function->blob.code - 1);
+  }
+
+  return OBJ_VAL(trace);
+}
+
+static b_value format_stack_trace(b_vm *vm, b_obj_stack_trace *stack_trace) {
+  char *trace = (char *) calloc(1, sizeof(char));
+
+  if (trace != NULL) {
+
+    for (int i = 0; i < stack_trace->count; i++) {
+      b_obj_func *function = stack_trace->frames[i].function;
+      int line = function->blob.lines[stack_trace->frames[i].ip];
 
       const char *trace_start = "    File: %s, Line: %d, In: ";
       size_t trace_start_length = snprintf(NULL, 0, trace_start, function->module->file, line);
@@ -53,10 +118,10 @@ static b_value get_stack_trace(b_vm *vm) {
 
       if (function->name == NULL) {
         trace_part = append_strings(
-            trace_part, i < vm->frame_count - 1 ? "<script>\n" : "<script>");
+            trace_part, i < stack_trace->count - 1 ? "<script>\n" : "<script>");
       } else {
         trace_part = append_strings(trace_part, function->name->chars);
-        trace_part = append_strings(trace_part, i < vm->frame_count - 1 ? "()\n" : "()");
+        trace_part = append_strings(trace_part, i < stack_trace->count - 1 ? "()\n" : "()");
       }
 
       trace = append_strings(trace, trace_part);
@@ -67,19 +132,53 @@ static b_value get_stack_trace(b_vm *vm) {
   return OBJ_VAL(copy_string(vm, "", 0));
 }
 
+b_value resolve_property(b_vm *vm, b_obj_instance *instance, b_value name, b_value value) {
+  if (IS_STACK_TRACE(value)) {
+    value = format_stack_trace(vm, AS_STACK_TRACE(value));
+    push(vm, value);
+    table_set(vm, &instance->properties, name, value);
+    pop(vm);
+  }
+  return value;
+}
+
+static inline void close_up_values(b_vm *vm, const b_value *last) {
+  while (vm->open_up_values != NULL && vm->open_up_values->location >= last) {
+    b_obj_up_value *up_value = vm->open_up_values;
+    up_value->closed = *up_value->location;
+    up_value->location = &up_value->closed;
+    vm->open_up_values = up_value->next;
+  }
+}
+
+/**
+ * discards whatever the try body left on the stack and the values held
+ * by GC() so that the exception lands in the slot of the catch variable.
+ * closures keep the locals they captured from the discarded slots.
+ */
+static inline void unwind_to_handler(b_vm *vm, b_call_frame *frame,
+                                     b_exception_frame *handler, b_obj_instance *exception) {
+  close_up_values(vm, frame->slots + handler->stack_depth);
+  vm->stack_top = frame->slots + handler->stack_depth;
+  vm->gc_protected = 0;
+  push(vm, OBJ_VAL(exception));
+}
+
 bool propagate_exception(b_vm *vm) {
   b_obj_instance *exception = AS_INSTANCE(peek(vm, 0));
 
   while (vm->frame_count > 0) {
     b_call_frame *frame = &vm->frames[vm->frame_count - 1];
     for (int i = frame->handlers_count; i > 0; i--) {
-      b_exception_frame handler = frame->handlers[i - 1];
+      b_exception_frame handler = vm->handlers[frame->handlers_base + i - 1];
       b_obj_func *function = frame->closure->function;
 
       if (handler.address != 0 && is_instance_of(exception->klass, handler.klass->name->chars)) {
+        unwind_to_handler(vm, frame, &handler, exception);
         frame->ip = &function->blob.code[handler.address];
         return true;
       } else if (handler.finally_address != 0) {
+        unwind_to_handler(vm, frame, &handler, exception);
         push(vm, TRUE_VAL); // continue propagating once the finally block completes
         frame->ip = &function->blob.code[handler.finally_address];
         return true;
@@ -100,6 +199,7 @@ bool propagate_exception(b_vm *vm) {
   }
 
   if (table_get(&exception->properties, STRING_L_VAL("stacktrace", 10), &trace)) {
+    trace = resolve_property(vm, exception, STRING_L_VAL("stacktrace", 10), trace);
     fprintf(stderr, "  StackTrace:\n%s\n", value_to_string(vm, trace));
   }
 
@@ -112,9 +212,19 @@ bool push_exception_handler(b_vm *vm, b_obj_class *type, int address, int finall
     _runtime_error(vm, "too many nested exception handlers in one function");
     return false;
   }
-  frame->handlers[frame->handlers_count].address = address;
-  frame->handlers[frame->handlers_count].finally_address = finally_address;
-  frame->handlers[frame->handlers_count].klass = type;
+
+  int index = frame->handlers_base + frame->handlers_count;
+  if (index == vm->handlers_capacity) {
+    vm->handlers_capacity = GROW_CAPACITY(vm->handlers_capacity);
+    vm->handlers = (b_exception_frame *) grow_vm_array(
+        vm->handlers, sizeof(b_exception_frame) * vm->handlers_capacity);
+  }
+
+  b_exception_frame *handler = &vm->handlers[index];
+  handler->address = address;
+  handler->finally_address = finally_address;
+  handler->stack_depth = (int) (vm->stack_top - frame->slots);
+  handler->klass = type;
   frame->handlers_count++;
   return true;
 }
@@ -130,8 +240,10 @@ bool throw_exception(b_vm *vm, const char *format, ...) {
   b_obj_instance *instance = create_exception(vm, take_string(vm, message, length));
   push(vm, OBJ_VAL(instance));
 
-  b_value stacktrace = get_stack_trace(vm);
+  b_value stacktrace = capture_stack_trace(vm);
+  push(vm, stacktrace);
   table_set(vm, &instance->properties, STRING_L_VAL("stacktrace", 10), stacktrace);
+  pop(vm);
   return propagate_exception(vm);
 }
 
@@ -184,6 +296,7 @@ static void initialize_exceptions(b_vm *vm, b_obj_module *module) {
   table_set(vm, &klass->properties, STRING_L_VAL("stacktrace", 10), NIL_VAL);
 
   table_set(vm, &vm->globals, OBJ_VAL(class_name), OBJ_VAL(klass));
+  seal_class(vm, klass);
   vm->exception_class = klass;
 }
 
@@ -235,6 +348,9 @@ void _runtime_error(b_vm *vm, const char *format, ...) {
 }
 
 inline void push(b_vm *vm, b_value value) {
+  if (vm->stack_top == vm->stack_end) {
+    grow_stack(vm, 1);
+  }
   *vm->stack_top = value;
   vm->stack_top++;
 }
@@ -291,6 +407,7 @@ static void init_builtin_functions(b_vm *vm) {
   DEFINE_NATIVE(is_string);
   DEFINE_NATIVE(is_bytes);
   DEFINE_NATIVE(is_file);
+  DEFINE_NATIVE(is_set);
   DEFINE_NATIVE(is_iterable);
   DEFINE_NATIVE(max);
   DEFINE_NATIVE(microtime);
@@ -299,6 +416,7 @@ static void init_builtin_functions(b_vm *vm) {
   DEFINE_NATIVE(ord);
   DEFINE_NATIVE(print);
   DEFINE_NATIVE(rand);
+  DEFINE_NATIVE(set);
   DEFINE_NATIVE(setprop);
   DEFINE_NATIVE(sum);
   DEFINE_NATIVE(time);
@@ -318,6 +436,7 @@ static void init_builtin_methods(b_vm *vm) {
 #define DEFINE_FILE_METHOD(name) DEFINE_METHOD(file, name)
 #define DEFINE_BYTES_METHOD(name) DEFINE_METHOD(bytes, name)
 #define DEFINE_RANGE_METHOD(name) DEFINE_METHOD(range, name)
+#define DEFINE_SET_METHOD(name) DEFINE_METHOD(set, name)
 
   // string methods
   DEFINE_STRING_METHOD(length);
@@ -375,6 +494,7 @@ static void init_builtin_methods(b_vm *vm) {
   DEFINE_LIST_METHOD(unique);
   DEFINE_LIST_METHOD(zip);
   DEFINE_LIST_METHOD(to_dict);
+  DEFINE_LIST_METHOD(to_set);
   define_native_method(vm, &vm->methods_list, "@iter", native_method_list__iter__);
   define_native_method(vm, &vm->methods_list, "@itern", native_method_list__itern__);
 
@@ -402,6 +522,10 @@ static void init_builtin_methods(b_vm *vm) {
   DEFINE_FILE_METHOD(close);
   DEFINE_FILE_METHOD(open);
   DEFINE_FILE_METHOD(read);
+  DEFINE_FILE_METHOD(read_line);
+  DEFINE_FILE_METHOD(mmap);
+  DEFINE_FILE_METHOD(write_all);
+  DEFINE_FILE_METHOD(set_buffer);
   DEFINE_FILE_METHOD(write);
   DEFINE_FILE_METHOD(number);
   DEFINE_FILE_METHOD(is_tty);
@@ -422,6 +546,8 @@ static void init_builtin_methods(b_vm *vm) {
   DEFINE_FILE_METHOD(tell);
   DEFINE_FILE_METHOD(mode);
   DEFINE_FILE_METHOD(name);
+  define_native_method(vm, &vm->methods_file, "@iter", native_method_file__iter__);
+  define_native_method(vm, &vm->methods_file, "@itern", native_method_file__itern__);
 
   // bytes
   DEFINE_BYTES_METHOD(length);
@@ -451,27 +577,58 @@ static void init_builtin_methods(b_vm *vm) {
   define_native_method(vm, &vm->methods_range, "@iter", native_method_range__iter__);
   define_native_method(vm, &vm->methods_range, "@itern", native_method_range__itern__);
 
+  // set
+  DEFINE_SET_METHOD(length);
+  DEFINE_SET_METHOD(add);
+  DEFINE_SET_METHOD(contains);
+  DEFINE_SET_METHOD(remove);
+  DEFINE_SET_METHOD(clear);
+  DEFINE_SET_METHOD(is_empty);
+  DEFINE_SET_METHOD(to_list);
+  DEFINE_SET_METHOD(clone);
+  DEFINE_SET_METHOD(union);
+  DEFINE_SET_METHOD(intersect);
+  DEFINE_SET_METHOD(difference);
+  DEFINE_SET_METHOD(is_subset);
+  define_native_method(vm, &vm->methods_set, "@iter", native_method_set__iter__);
+  define_native_method(vm, &vm->methods_set, "@itern", native_method_set__itern__);
+
 #undef DEFINE_STRING_METHOD
 #undef DEFINE_LIST_METHOD
 #undef DEFINE_DICT_METHOD
 #undef DEFINE_FILE_METHOD
 #undef DEFINE_BYTES_METHOD
 #undef DEFINE_RANGE_METHOD
+#undef DEFINE_SET_METHOD
 }
 
 void init_vm(b_vm *vm) {
 
+  vm->stack_capacity = STACK_INITIAL_CAPACITY;
+  vm->stack = (b_value *) grow_vm_array(NULL, sizeof(b_value) * vm->stack_capacity);
+  vm->stack_end = vm->stack + vm->stack_capacity;
+  vm->frame_capacity = FRAMES_INITIAL_CAPACITY;
+  vm->frames = (b_call_frame *) grow_vm_array(NULL, sizeof(b_call_frame) * vm->frame_capacity);
+  vm->handlers_capacity = 0;
+  vm->handlers = NULL;
+
   reset_stack(vm);
   vm->compiler = NULL;
   vm->objects = NULL;
   vm->exception_class = NULL;
+  vm->symbol_count = 0;
   vm->bytes_allocated = 0;
   vm->gc_protected = 0;
+  vm->gc_protected_capacity = 0;
+  vm->gc_protected_objects = NULL;
   vm->next_gc = DEFAULT_GC_START; // default is 1mb. Can be modified via the -g flag.
   vm->is_repl = false;
   vm->mark_value = true;
   vm->should_debug_stack = false;
   vm->should_print_bytecode = false;
+  vm->use_fused_locals = false;
+  vm->use_jit = false;
+  vm->op_profile = NULL;
 
   vm->gray_count = 0;
   vm->gray_capacity = 0;
@@ -491,6 +648,7 @@ void init_vm(b_vm *vm) {
   init_table(&vm->methods_file);
   init_table(&vm->methods_bytes);
   init_table(&vm->methods_range);
+  init_table(&vm->methods_set);
 
   init_builtin_functions(vm);
   init_builtin_methods(vm);
@@ -510,52 +668,121 @@ void free_vm(b_vm *vm) {
   free_table(vm, &vm->methods_dict);
   free_table(vm, &vm->methods_file);
   free_table(vm, &vm->methods_bytes);
+  free_table(vm, &vm->methods_range);
+  free_table(vm, &vm->methods_set);
+
+  free(vm->stack);
+  free(vm->frames);
+  free(vm->handlers);
+  free(vm->gc_protected_objects);
+  free_op_profile(vm->op_profile);
 }
 
-static bool call(b_vm *vm, b_obj_closure *closure, int arg_count) {
-  // fill empty parameters if not variadic
-  for (; !closure->function->is_variadic && arg_count < closure->function->arity; arg_count++) {
-    push(vm, NIL_VAL);
+/**
+ * lines up the arguments of a call that does not match the parameters of
+ * function exactly. missing parameters are filled with nil and the extra
+ * arguments of a variadic function become __args__.
+ */
+static void adjust_arguments(b_vm *vm, b_obj_func *function, int arg_count) {
+  if (!function->is_variadic) {
+    ensure_stack(vm, function->arity - arg_count);
+    for (; arg_count < function->arity; arg_count++) {
+      *vm->stack_top++ = NIL_VAL;
+    }
+    return;
   }
 
-  // handle variadic arguments...
-  if (closure->function->is_variadic && arg_count >= closure->function->arity - 1) {
-    int va_args_start = arg_count - closure->function->arity;
-    b_obj_list *args_list = new_list(vm);
+  int va_args_count = arg_count - (function->arity - 1);
 
-    for (int i = va_args_start; i >= 0; i--) {
-      write_value_arr(vm, &args_list->items, peek(vm, i));
-    }
-    arg_count -= va_args_start;
-    pop_n(vm, va_args_start + 1);
-    push(vm, OBJ_VAL(args_list));
+  // nothing can observe the list when the body never reads __args__
+  if (!function->uses_args) {
+    pop_n(vm, va_args_count);
+    push(vm, NIL_VAL);
+    return;
+  }
+
+  b_obj_list *args_list = new_list(vm);
+  push(vm, OBJ_VAL(args_list));
+  if (va_args_count > 0) {
+    args_list->items.values = GROW_ARRAY(b_value, args_list->items.values, 0, va_args_count);
+    args_list->items.capacity = va_args_count;
+    args_list->items.count = va_args_count;
+    memcpy(args_list->items.values, vm->stack_top - va_args_count - 1,
+           sizeof(b_value) * va_args_count);
   }
+  pop_n(vm, va_args_count + 1);
+  push(vm, OBJ_VAL(args_list));
+}
+
+static bool call(b_vm *vm, b_obj_closure *closure, int arg_count) {
+  b_obj_func *function = closure->function;
 
-  if (arg_count != closure->function->arity) {
-    pop_n(vm, arg_count);
-    if (closure->function->is_variadic) {
+  if (arg_count != function->arity || function->is_variadic) {
+    if (function->is_variadic && arg_count < function->arity - 1) {
+      pop_n(vm, arg_count);
       return throw_exception(vm, "expected at least %d arguments but got %d",
-                             closure->function->arity - 1, arg_count);
-    } else {
+                             function->arity - 1, arg_count);
+    } else if (!function->is_variadic && arg_count > function->arity) {
+      pop_n(vm, arg_count);
       return throw_exception(vm, "expected %d arguments but got %d",
-                             closure->function->arity, arg_count);
+                             function->arity, arg_count);
     }
+
+    adjust_arguments(vm, function, arg_count);
+    arg_count = function->arity;
+  }
+
+  if (vm->frame_count == vm->frame_capacity) {
+    vm->frame_capacity = GROW_CAPACITY(vm->frame_capacity);
+    vm->frames = (b_call_frame *) grow_vm_array(
+        vm->frames, sizeof(b_call_frame) * vm->frame_capacity);
   }
 
-  if (vm->frame_count == FRAMES_MAX) {
-    pop_n(vm, arg_count);
-    return throw_exception(vm, "stack overflow");
+  if (vm->use_jit && function->jit == NULL) {
+    function->hot_count++;
   }
 
   b_call_frame *frame = &vm->frames[vm->frame_count++];
   frame->closure = closure;
-  frame->ip = closure->function->blob.code;
+  frame->ip = function->blob.code;
 
   frame->slots = vm->stack_top - arg_count - 1;
+  frame->handlers_count = 0;
+  if (vm->frame_count > 1) {
+    b_call_frame *caller = &vm->frames[vm->frame_count - 2];
+    frame->handlers_base = caller->handlers_base + caller->handlers_count;
+  } else {
+    frame->handlers_base = 0;
+  }
   return true;
 }
 
+/**
+ * runs the loop the frame is about to start another iteration of as
+ * machine code, compiling its function first once it gets hot.
+ * see jit.h.
+ */
+static void run_compiled_loop(b_vm *vm, b_call_frame *frame) {
+  b_obj_func *function = frame->closure->function;
+  if (function->jit == NULL) {
+    if (++function->hot_count < JIT_HOT_THRESHOLD)
+      return;
+    jit_compile(vm, function);
+  }
+
+  b_jit_code *jit = function->jit;
+  int offset = (int) (frame->ip - function->blob.code);
+  if (jit->code == NULL || jit->entries[offset] == NULL)
+    return;
+
+  ensure_stack(vm, jit->max_push);
+  frame->ip = function->blob.code + jit_execute(vm, jit, frame->slots, offset);
+}
+
 static inline bool call_native_method(b_vm *vm, b_obj_native *native, int arg_count) {
+  // natives hold on to args, so the few values some of them push for
+  // a moment must not move the stack. GC() does not use the stack.
+  ensure_stack(vm, UINT8_COUNT);
   if (native->function(vm, arg_count, vm->stack_top - arg_count)) {
     CLEAR_GC();
     vm->stack_top -= arg_count;
@@ -615,10 +842,21 @@ static inline b_func_type get_method_type(b_value method) {
   }
 }
 
+// sealed classes answer from their vtable, see seal_class.
+static inline bool find_method(b_obj_class *klass, b_obj_string *name,
+                               b_value *method) {
+  b_entry *entry = vtable_entry(klass, name);
+  if (entry != NULL) {
+    *method = entry->value;
+    return true;
+  }
+  return table_get(&klass->methods, OBJ_VAL(name), method);
+}
+
 inline bool invoke_from_class(b_vm *vm, b_obj_class *klass, b_obj_string *name,
                        int arg_count) {
   b_value method;
-  if (table_get(&klass->methods, OBJ_VAL(name), &method)) {
+  if (find_method(klass, name, &method)) {
     if (get_method_type(method) == TYPE_PRIVATE) {
       return throw_exception(vm, "cannot call private method '%s' from instance of %s",
                              name->chars, klass->name->chars);
@@ -637,7 +875,7 @@ static bool invoke_self(b_vm *vm, b_obj_string *name, int arg_count) {
   if (IS_INSTANCE(receiver)) {
     b_obj_instance *instance = AS_INSTANCE(receiver);
 
-    if (table_get(&instance->klass->methods, OBJ_VAL(name), &value)) {
+    if (find_method(instance->klass, name, &value)) {
       return call_value(vm, value, arg_count);
     }
 
@@ -646,7 +884,7 @@ static bool invoke_self(b_vm *vm, b_obj_string *name, int arg_count) {
       return call_value(vm, value, arg_count);
     }
   } else if (IS_CLASS(receiver)) {
-    if (table_get(&AS_CLASS(receiver)->methods, OBJ_VAL(name), &value)) {
+    if (find_method(AS_CLASS(receiver), name, &value)) {
       if (get_method_type(value) == TYPE_STATIC) {
         return call_value(vm, value, arg_count);
       }
@@ -680,7 +918,7 @@ static bool invoke(b_vm *vm, b_obj_string *name, int arg_count) {
         break;
       }
       case OBJ_CLASS: {
-        if (table_get(&AS_CLASS(receiver)->methods, OBJ_VAL(name), &value)) {
+        if (find_method(AS_CLASS(receiver), name, &value)) {
           if (get_method_type(value) == TYPE_PRIVATE) {
             return throw_exception(vm, "cannot call private method %s() on %s",
                                    name->chars, AS_CLASS(receiver)->name->chars);
@@ -738,6 +976,12 @@ static bool invoke(b_vm *vm, b_obj_string *name, int arg_count) {
         }
         return throw_exception(vm, "Bytes has no method %s()", name->chars);
       }
+      case OBJ_SET: {
+        if (table_get(&vm->methods_set, OBJ_VAL(name), &value)) {
+          return call_native_method(vm, AS_NATIVE(value), arg_count);
+        }
+        return throw_exception(vm, "Set has no method %s()", name->chars);
+      }
       default: {
         return throw_exception(vm, "cannot call method %s on object of type %s",
                                name->chars, value_type(receiver));
@@ -748,7 +992,7 @@ static bool invoke(b_vm *vm, b_obj_string *name, int arg_count) {
 
 static inline bool bind_method(b_vm *vm, b_obj_class *klass, b_obj_string *name) {
   b_value method;
-  if (table_get(&klass->methods, OBJ_VAL(name), &method)) {
+  if (find_method(klass, name, &method)) {
     if (get_method_type(method) == TYPE_PRIVATE) {
       return throw_exception(vm, "cannot get private property '%s' from instance", name->chars);
     }
@@ -786,13 +1030,28 @@ static b_obj_up_value *capture_up_value(b_vm *vm, b_value *local) {
   return created_up_value;
 }
 
-static inline void close_up_values(b_vm *vm, const b_value *last) {
-  while (vm->open_up_values != NULL && vm->open_up_values->location >= last) {
-    b_obj_up_value *up_value = vm->open_up_values;
-    up_value->closed = *up_value->location;
-    up_value->location = &up_value->closed;
-    vm->open_up_values = up_value->next;
-  }
+/**
+ * hands the frame of a function that ended in a tail call over to the
+ * callee. the callee and its arguments slide down into the caller's
+ * slots so tail recursion runs in constant frame and stack space.
+ */
+static inline void replace_frame(b_vm *vm, int frame_count) {
+  // natives and classes without an initializer have already returned.
+  if (vm->frame_count != frame_count + 1)
+    return;
+
+  b_call_frame *frame = &vm->frames[frame_count - 1];
+  b_call_frame *callee = &vm->frames[frame_count];
+  close_up_values(vm, frame->slots);
+
+  int count = (int) (vm->stack_top - callee->slots);
+  memmove(frame->slots, callee->slots, sizeof(b_value) * count);
+  vm->stack_top = frame->slots + count;
+
+  callee->slots = frame->slots;
+  callee->handlers_base = frame->handlers_base;
+  *frame = *callee;
+  vm->frame_count--;
 }
 
 static inline void define_method(b_vm *vm, b_obj_string *name) {
@@ -800,6 +1059,10 @@ static inline void define_method(b_vm *vm, b_obj_string *name) {
   b_obj_class *klass = AS_CLASS(peek(vm, 1));
 
   table_set(vm, &klass->methods, OBJ_VAL(name), method);
+  b_entry *entry = vtable_entry(klass, name);
+  if (entry != NULL) {
+    entry->value = method;
+  }
   if (get_method_type(method) == TYPE_INITIALIZER) {
     klass->initializer = method;
   }
@@ -840,6 +1103,10 @@ inline bool is_false(b_value value) {
   if (IS_DICT(value))
     return AS_DICT(value)->names.count == 0;
 
+  // Non-empty sets are true, empty sets are false.
+  if (IS_SET(value))
+    return AS_SET(value)->count == 0;
+
   // All classes are true
   // All closures are true
   // All bound methods are true
@@ -1094,11 +1361,18 @@ static bool bytes_get_ranged_index(b_vm *vm, b_obj_bytes *bytes, bool will_assig
   if (upper_index > bytes->bytes.count)
     upper_index = bytes->bytes.count;
 
+  b_obj_bytes *slice;
+  if (upper_index - lower_index >= MIN_SLICE_VIEW_LENGTH) {
+    slice = new_bytes_view(vm, bytes, lower_index, upper_index - lower_index);
+  } else {
+    slice = copy_bytes(vm, bytes->bytes.bytes + lower_index,
+                       upper_index - lower_index);
+  }
+
   if (!will_assign) {
     pop_n(vm, 3); // +1 for the list itself
   }
-  push(vm, OBJ_VAL(copy_bytes(vm, bytes->bytes.bytes + lower_index,
-                              upper_index - lower_index)));
+  push(vm, OBJ_VAL(slice));
   return true;
 }
 
@@ -1157,10 +1431,16 @@ static bool list_get_ranged_index(b_vm *vm, b_obj_list *list, bool will_assign)
   if (upper_index > list->items.count)
     upper_index = list->items.count;
 
-  b_obj_list *n_list = new_list(vm);
-
-  for (int i = lower_index; i < upper_index; i++) {
-    write_value_arr(vm, &n_list->items, list->items.values[i]);
+  b_obj_list *n_list;
+  if (upper_index - lower_index >= MIN_SLICE_VIEW_LENGTH) {
+    n_list = new_list_view(vm, list, lower_index, upper_index - lower_index);
+  } else {
+    n_list = new_list(vm);
+    push(vm, OBJ_VAL(n_list));
+    for (int i = lower_index; i < upper_index; i++) {
+      write_value_arr(vm, &n_list->items, list->items.values[i]);
+    }
+    pop(vm);
   }
 
   if (!will_assign) {
@@ -1189,6 +1469,7 @@ static bool list_set_index(b_vm *vm, b_obj_list *list, b_value index, b_value va
   int position = _position < 0 ? list->items.count + _position : _position;
 
   if (position < list->items.count && position > -(list->items.count)) {
+    unshare_list(vm, list);
     list->items.values[position] = value;
     pop_n(vm, 3); // pop the value, index and list out
 
@@ -1217,6 +1498,7 @@ static bool bytes_set_index(b_vm *vm, b_obj_bytes *bytes, b_value index, b_value
   int position = _position < 0 ? bytes->bytes.count + _position : _position;
 
   if (position < bytes->bytes.count && position > -(bytes->bytes.count)) {
+    unshare_bytes(vm, bytes);
     bytes->bytes.bytes[position] = (unsigned char) byte;
     pop_n(vm, 3); // pop the value, index and bytes out
 
@@ -1303,8 +1585,36 @@ static inline int floor_div(double a, double b) {
   return d - ((d * b == a) & ((a < 0) ^ (b < 0)));
 }
 
+/**
+ * applies the arithmetic operator of a register instruction to two
+ * numbers, leaving the result in a. the operator byte may have been
+ * quickened to its numeric form already.
+ */
+static inline bool register_arith(uint8_t op, b_value *a, b_value b) {
+  switch (op) {
+    case OP_ADD:
+    case OP_ADD_NUM:
+      *a = NUMBER_VAL(AS_NUMBER(*a) + AS_NUMBER(b));
+      return true;
+    case OP_SUBTRACT:
+    case OP_SUBTRACT_NUM:
+      *a = NUMBER_VAL(AS_NUMBER(*a) - AS_NUMBER(b));
+      return true;
+    case OP_MULTIPLY:
+    case OP_MULTIPLY_NUM:
+      *a = NUMBER_VAL(AS_NUMBER(*a) * AS_NUMBER(b));
+      return true;
+    case OP_DIVIDE:
+      *a = NUMBER_VAL(AS_NUMBER(*a) / AS_NUMBER(b));
+      return true;
+    default:
+      return false;
+  }
+}
+
 b_ptr_result run(b_vm *vm) {
   b_call_frame *frame = &vm->frames[vm->frame_count - 1];
+  bool is_tracing = vm->should_debug_stack || vm->op_profile != NULL;
 
 #define READ_BYTE() (*frame->ip++)
 
@@ -1331,6 +1641,46 @@ b_ptr_result run(b_vm *vm) {
     push(vm, type(a op b));                                                    \
   } while (false)
 
+// a module variable's index in its module table is remembered in the
+// operand that follows its name. the hint is only trusted while the
+// entry at that index still holds the same name.
+#define IS_GLOBAL_SLOT(table, slot, name)                                      \
+  ((int) (slot) < (table)->capacity &&                                         \
+   IS_OBJ((table)->entries[slot].key) &&                                       \
+   AS_OBJ((table)->entries[slot].key) == (b_obj *) (name))
+
+#define CACHE_GLOBAL_SLOT(index)                                               \
+  do {                                                                         \
+    if ((index) < UINT16_MAX) {                                                \
+      frame->ip[-2] = (uint8_t) (((index) >> 8) & 0xff);                       \
+      frame->ip[-1] = (uint8_t) ((index) & 0xff);                              \
+    }                                                                          \
+  } while (false)
+
+// rewrites the instruction being executed in place.
+#define QUICKEN(code) (frame->ip[-1] = (uint8_t) (code))
+
+// turns a number-specialised instruction back into its generic
+// form and makes the generic form the next instruction to run.
+#define DEOPTIMIZE(code) (frame->ip[-1] = (uint8_t) (code), frame->ip--)
+
+#define IS_NUMBER_PAIR() (IS_NUMBER(vm->stack_top[-1]) && IS_NUMBER(vm->stack_top[-2]))
+
+// reads a short operand of the instructions following a superinstruction.
+#define PEEK_SHORT(n) ((uint16_t) ((frame->ip[n] << 8) | frame->ip[(n) + 1]))
+
+#define NUMBER_OP(generic, type, op)                                           \
+  do {                                                                         \
+    if (!IS_NUMBER_PAIR()) {                                                   \
+      DEOPTIMIZE(generic);                                                     \
+      break;                                                                   \
+    }                                                                          \
+    double b = AS_NUMBER(vm->stack_top[-1]);                                   \
+    double a = AS_NUMBER(vm->stack_top[-2]);                                   \
+    vm->stack_top--;                                                           \
+    vm->stack_top[-1] = type(a op b);                                          \
+  } while (false)
+
 #define BINARY_BIT_OP(type, op)                                                \
   do {                                                                         \
     if ((!IS_NUMBER(peek(vm, 0)) && !IS_BOOL(peek(vm, 0))) ||                  \
@@ -1369,17 +1719,24 @@ b_ptr_result run(b_vm *vm) {
       return PTR_RUNTIME_ERR;
     }
 
-    if (vm->should_debug_stack) {
-      printf("          ");
-      for (b_value *slot = vm->stack; slot < vm->stack_top; slot++) {
-        printf("[ ");
-        print_value(*slot);
-        printf(" ]");
-      }
-      printf("\n");
-      disassemble_instruction(
-          &frame->closure->function->blob,
-          (int) (frame->ip - frame->closure->function->blob.code));
+    // one check covers every per-instruction debugging aid
+    if (is_tracing) {
+      if (vm->should_debug_stack) {
+        printf("          ");
+        for (b_value *slot = vm->stack; slot < vm->stack_top; slot++) {
+          printf("[ ");
+          print_value(*slot);
+          printf(" ]");
+        }
+        printf("\n");
+        disassemble_instruction(
+            &frame->closure->function->blob,
+            (int) (frame->ip - frame->closure->function->blob.code));
+      }
+
+      if (vm->op_profile != NULL) {
+        profile_opcode(vm->op_profile, *frame->ip);
+      }
     }
 
     uint8_t instruction;
@@ -1393,7 +1750,10 @@ b_ptr_result run(b_vm *vm) {
       }
 
       case OP_ADD: {
-        if (IS_STRING(peek(vm, 0)) || IS_STRING(peek(vm, 1))) {
+        if (IS_NUMBER_PAIR()) {
+          QUICKEN(OP_ADD_NUM);
+          BINARY_OP(NUMBER_VAL, +);
+        } else if (IS_STRING(peek(vm, 0)) || IS_STRING(peek(vm, 1))) {
           if (!concatenate(vm)) {
             runtime_error("unsupported operand + for %s and %s", value_type(peek(vm, 0)), value_type(peek(vm, 1)));
             break;
@@ -1414,11 +1774,18 @@ b_ptr_result run(b_vm *vm) {
         break;
       }
       case OP_SUBTRACT: {
+        if (IS_NUMBER_PAIR()) {
+          QUICKEN(OP_SUBTRACT_NUM);
+        }
         BINARY_OP(NUMBER_VAL, -);
         break;
       }
       case OP_MULTIPLY: {
-        if (IS_STRING(peek(vm, 1)) && IS_NUMBER(peek(vm, 0))) {
+        if (IS_NUMBER_PAIR()) {
+          QUICKEN(OP_MULTIPLY_NUM);
+          BINARY_OP(NUMBER_VAL, *);
+          break;
+        } else if (IS_STRING(peek(vm, 1)) && IS_NUMBER(peek(vm, 0))) {
           double number = AS_NUMBER(peek(vm, 0));
           b_obj_string *string = AS_STRING(peek(vm, 1));
           b_value result = OBJ_VAL(multiply_string(vm, string, number));
@@ -1497,20 +1864,58 @@ b_ptr_result run(b_vm *vm) {
 
         // comparisons
       case OP_EQUAL: {
+        if (IS_NUMBER_PAIR()) {
+          QUICKEN(OP_EQUAL_NUM);
+        }
         b_value b = pop(vm);
         b_value a = pop(vm);
-        push(vm, BOOL_VAL(values_equal(a, b)));
+        if (IS_SET(a) && IS_SET(b)) {
+          push(vm, BOOL_VAL(sets_equal(AS_SET(a), AS_SET(b))));
+        } else {
+          push(vm, BOOL_VAL(values_equal(a, b)));
+        }
         break;
       }
       case OP_GREATER: {
+        if (IS_NUMBER_PAIR()) {
+          QUICKEN(OP_GREATER_NUM);
+        }
         BINARY_OP(BOOL_VAL, >);
         break;
       }
       case OP_LESS: {
+        if (IS_NUMBER_PAIR()) {
+          QUICKEN(OP_LESS_NUM);
+        }
         BINARY_OP(BOOL_VAL, <);
         break;
       }
 
+      case OP_EQUAL_NUM: {
+        NUMBER_OP(OP_EQUAL, BOOL_VAL, ==);
+        break;
+      }
+      case OP_GREATER_NUM: {
+        NUMBER_OP(OP_GREATER, BOOL_VAL, >);
+        break;
+      }
+      case OP_LESS_NUM: {
+        NUMBER_OP(OP_LESS, BOOL_VAL, <);
+        break;
+      }
+      case OP_ADD_NUM: {
+        NUMBER_OP(OP_ADD, NUMBER_VAL, +);
+        break;
+      }
+      case OP_SUBTRACT_NUM: {
+        NUMBER_OP(OP_SUBTRACT, NUMBER_VAL, -);
+        break;
+      }
+      case OP_MULTIPLY_NUM: {
+        NUMBER_OP(OP_MULTIPLY, NUMBER_VAL, *);
+        break;
+      }
+
       case OP_NOT:
         push(vm, BOOL_VAL(is_false(pop(vm))));
         break;
@@ -1542,6 +1947,9 @@ b_ptr_result run(b_vm *vm) {
       case OP_LOOP: {
         uint16_t offset = READ_SHORT();
         frame->ip -= offset;
+        if (vm->use_jit) {
+          run_compiled_loop(vm, frame);
+        }
         break;
       }
 
@@ -1599,12 +2007,26 @@ b_ptr_result run(b_vm *vm) {
 
       case OP_GET_GLOBAL: {
         b_obj_string *name = READ_STRING();
+        uint16_t slot = READ_SHORT();
+        b_table *table = &frame->closure->function->module->values;
+
+        if (IS_GLOBAL_SLOT(table, slot, name)) {
+          push(vm, table->entries[slot].value);
+          break;
+        }
+
+        int index = table_find_slot(table, OBJ_VAL(name));
+        if (index != -1) {
+          CACHE_GLOBAL_SLOT(index);
+          push(vm, table->entries[index].value);
+          break;
+        }
+
+        // builtins are not cached as a module may define the name later
         b_value value;
-        if (!table_get(&frame->closure->function->module->values, OBJ_VAL(name), &value)) {
-          if (!table_get(&vm->globals, OBJ_VAL(name), &value)) {
-            runtime_error("'%s' is undefined in this scope", name->chars);
-            break;
-          }
+        if (!table_get(&vm->globals, OBJ_VAL(name), &value)) {
+          runtime_error("'%s' is undefined in this scope", name->chars);
+          break;
         }
         push(vm, value);
         break;
@@ -1612,12 +2034,21 @@ b_ptr_result run(b_vm *vm) {
 
       case OP_SET_GLOBAL: {
         b_obj_string *name = READ_STRING();
+        uint16_t slot = READ_SHORT();
         b_table *table = &frame->closure->function->module->values;
-        if (table_set(vm, table, OBJ_VAL(name), peek(vm, 0))) {
-          table_delete(table, OBJ_VAL(name));
+
+        if (IS_GLOBAL_SLOT(table, slot, name)) {
+          table->entries[slot].value = peek(vm, 0);
+          break;
+        }
+
+        int index = table_find_slot(table, OBJ_VAL(name));
+        if (index == -1) {
           runtime_error("%s is undefined in this scope", name->chars);
           break;
         }
+        CACHE_GLOBAL_SLOT(index);
+        table->entries[index].value = peek(vm, 0);
         break;
       }
 
@@ -1626,6 +2057,49 @@ b_ptr_result run(b_vm *vm) {
         push(vm, frame->slots[slot]);
         break;
       }
+
+      // each superinstruction either runs its whole sequence or does
+      // the work of g_loc alone and lets the rest run as usual.
+      case OP_ADD_LOCALS: {
+        b_value a = frame->slots[READ_SHORT()];
+        b_value b = frame->slots[PEEK_SHORT(1)];
+        if (IS_NUMBER(a) && IS_NUMBER(b)) {
+          push(vm, NUMBER_VAL(AS_NUMBER(a) + AS_NUMBER(b)));
+          frame->ip += 4; // g_loc, add
+        } else {
+          push(vm, a);
+        }
+        break;
+      }
+      case OP_LESS_CONSTANT_JUMP: {
+        b_value a = frame->slots[READ_SHORT()];
+        b_value b = frame->closure->function->blob.constants.values[PEEK_SHORT(1)];
+        if (IS_NUMBER(a) && IS_NUMBER(b)) {
+          if (AS_NUMBER(a) < AS_NUMBER(b)) {
+            frame->ip += 8; // load, less, f_jump, pop
+          } else {
+            push(vm, FALSE_VAL); // popped at the jump target
+            frame->ip += 7 + PEEK_SHORT(5);
+          }
+        } else {
+          push(vm, a);
+        }
+        break;
+      }
+      case OP_GET_LOCAL_PROPERTY: {
+        b_value receiver = frame->slots[READ_SHORT()];
+        push(vm, receiver);
+        if (IS_INSTANCE(receiver)) {
+          b_obj_string *name = AS_STRING(frame->closure->function->blob.constants.values[PEEK_SHORT(1)]);
+          b_value value;
+          if (name->chars[0] != '_' && table_get(&AS_INSTANCE(receiver)->properties, OBJ_VAL(name), &value) &&
+              !IS_STACK_TRACE(value)) {
+            vm->stack_top[-1] = value;
+            frame->ip += 3; // g_prop
+          }
+        }
+        break;
+      }
       case OP_SET_LOCAL: {
         uint16_t slot = READ_SHORT();
         frame->slots[slot] = peek(vm, 0);
@@ -1656,7 +2130,7 @@ b_ptr_result run(b_vm *vm) {
               break;
             }
             case OBJ_CLASS: {
-              if (table_get(&AS_CLASS(peek(vm, 0))->methods, OBJ_VAL(name), &value)) {
+              if (find_method(AS_CLASS(peek(vm, 0)), name, &value)) {
                 if (get_method_type(value) == TYPE_STATIC) {
                   if (name->length > 0 && name->chars[0] == '_') {
                     runtime_error("cannot call private property '%s' of class %s",
@@ -1690,6 +2164,7 @@ b_ptr_result run(b_vm *vm) {
                                 name->chars, instance->klass->name->chars);
                   break;
                 }
+                value = resolve_property(vm, instance, OBJ_VAL(name), value);
                 pop(vm); // pop the instance...
                 push(vm, value);
                 break;
@@ -1762,6 +2237,16 @@ b_ptr_result run(b_vm *vm) {
               runtime_error("class Bytes has no named property '%s'", name->chars);
               break;
             }
+            case OBJ_SET: {
+              if (table_get(&vm->methods_set, OBJ_VAL(name), &value)) {
+                pop(vm); // pop the set...
+                push(vm, value);
+                break;
+              }
+
+              runtime_error("class Set has no named property '%s'", name->chars);
+              break;
+            }
             case OBJ_FILE: {
               if (table_get(&vm->methods_file, OBJ_VAL(name), &value)) {
                 pop(vm); // pop the list...
@@ -1791,6 +2276,7 @@ b_ptr_result run(b_vm *vm) {
         if (IS_INSTANCE(peek(vm, 0))) {
           b_obj_instance *instance = AS_INSTANCE(peek(vm, 0));
           if (table_get(&instance->properties, OBJ_VAL(name), &value)) {
+            value = resolve_property(vm, instance, OBJ_VAL(name), value);
             pop(vm); // pop the instance...
             push(vm, value);
             break;
@@ -1807,7 +2293,7 @@ b_ptr_result run(b_vm *vm) {
           break;
         } else if (IS_CLASS(peek(vm, 0))) {
           b_obj_class *klass = AS_CLASS(peek(vm, 0));
-          if (table_get(&klass->methods, OBJ_VAL(name), &value)) {
+          if (find_method(klass, name, &value)) {
             if (get_method_type(value) == TYPE_STATIC) {
               pop(vm); // pop the class...
               push(vm, value);
@@ -1871,8 +2357,12 @@ b_ptr_result run(b_vm *vm) {
           uint8_t is_local = READ_BYTE();
           int index = READ_SHORT();
 
-          if (is_local) {
-            closure->up_values[i] = capture_up_value(vm, frame->slots + index);
+          if (is_local == 2) {
+            // never assigned after capture, so a copy is enough.
+            closure->up_values[i].value = frame->slots[index];
+          } else if (is_local) {
+            closure->up_values[i].up_value =
+                capture_up_value(vm, frame->slots + index);
           } else {
             closure->up_values[i] =
                 ((b_obj_closure *) frame->closure)->up_values[index];
@@ -1883,12 +2373,14 @@ b_ptr_result run(b_vm *vm) {
       }
       case OP_GET_UP_VALUE: {
         int index = READ_SHORT();
-        push(vm, *((b_obj_closure *) frame->closure)->up_values[index]->location);
+        b_capture *capture = &((b_obj_closure *) frame->closure)->up_values[index];
+        push(vm, capture->up_value != NULL ? *capture->up_value->location
+                                           : capture->value);
         break;
       }
       case OP_SET_UP_VALUE: {
         int index = READ_SHORT();
-        *((b_obj_closure *) frame->closure)->up_values[index]->location =
+        *((b_obj_closure *) frame->closure)->up_values[index].up_value->location =
             peek(vm, 0);
         break;
       }
@@ -1901,6 +2393,47 @@ b_ptr_result run(b_vm *vm) {
         frame = &vm->frames[vm->frame_count - 1];
         break;
       }
+      case OP_ARITH_LOCALS:
+      case OP_ARITH_CONSTANT: {
+        b_value a = frame->slots[READ_SHORT()];
+        b_value b = *frame->ip == OP_CONSTANT
+                    ? frame->closure->function->blob.constants.values[PEEK_SHORT(1)]
+                    : frame->slots[PEEK_SHORT(1)];
+        if (IS_NUMBER(a) && IS_NUMBER(b) && register_arith(frame->ip[3], &a, b)) {
+          frame->slots[PEEK_SHORT(5)] = a;
+          frame->ip += 8; // g_loc/load, <op>, s_loc, pop
+        } else {
+          push(vm, a);
+        }
+        break;
+      }
+      case OP_INCREMENT_LOCAL: {
+        b_value a = frame->slots[READ_SHORT()];
+        if (IS_NUMBER(a)) {
+          frame->slots[PEEK_SHORT(3)] = NUMBER_VAL(AS_NUMBER(a) + 1);
+          frame->ip += 6; // one, add, s_loc, pop
+        } else {
+          push(vm, a);
+        }
+        break;
+      }
+      case OP_MOVE_LOCAL: {
+        b_value a = frame->slots[READ_SHORT()];
+        frame->slots[PEEK_SHORT(1)] = a;
+        frame->ip += 4; // s_loc, pop
+        break;
+      }
+      case OP_STORE_LOCAL: {
+        frame->slots[READ_SHORT()] = pop(vm);
+        frame->ip++; // pop
+        break;
+      }
+
+      case OP_GET_LOCAL_INVOKE: {
+        push(vm, frame->slots[READ_SHORT()]);
+        frame->ip++; // invk
+      }
+      // fall through
       case OP_INVOKE: {
         b_obj_string *method = READ_STRING();
         int arg_count = READ_BYTE();
@@ -1920,6 +2453,41 @@ b_ptr_result run(b_vm *vm) {
         break;
       }
 
+      // the op_return after a tail call only runs when the callee
+      // returned in place.
+      case OP_TAIL_CALL: {
+        int arg_count = READ_BYTE();
+        int frame_count = vm->frame_count;
+        if (!call_value(vm, peek(vm, arg_count), arg_count)) {
+          EXIT_VM();
+        }
+        replace_frame(vm, frame_count);
+        frame = &vm->frames[vm->frame_count - 1];
+        break;
+      }
+      case OP_TAIL_INVOKE: {
+        b_obj_string *method = READ_STRING();
+        int arg_count = READ_BYTE();
+        int frame_count = vm->frame_count;
+        if (!invoke(vm, method, arg_count)) {
+          EXIT_VM();
+        }
+        replace_frame(vm, frame_count);
+        frame = &vm->frames[vm->frame_count - 1];
+        break;
+      }
+      case OP_TAIL_INVOKE_SELF: {
+        b_obj_string *method = READ_STRING();
+        int arg_count = READ_BYTE();
+        int frame_count = vm->frame_count;
+        if (!invoke_self(vm, method, arg_count)) {
+          EXIT_VM();
+        }
+        replace_frame(vm, frame_count);
+        frame = &vm->frames[vm->frame_count - 1];
+        break;
+      }
+
       case OP_CLASS: {
         b_obj_string *name = READ_STRING();
         push(vm, OBJ_VAL(new_class(vm, name)));
@@ -1936,6 +2504,11 @@ b_ptr_result run(b_vm *vm) {
         define_property(vm, name, is_static == 1);
         break;
       }
+      case OP_END_CLASS: {
+        seal_class(vm, AS_CLASS(peek(vm, 0)));
+        pop(vm);
+        break;
+      }
       case OP_INHERIT: {
         if (!IS_CLASS(peek(vm, 1))) {
           runtime_error("cannot inherit from non-class object");
@@ -2298,9 +2871,11 @@ b_ptr_result run(b_vm *vm) {
           break;
         }
 
-        b_value stacktrace = get_stack_trace(vm);
+        b_value stacktrace = capture_stack_trace(vm);
         b_obj_instance *instance = AS_INSTANCE(peek(vm, 0));
+        push(vm, stacktrace);
         table_set(vm, &instance->properties, STRING_L_VAL("stacktrace", 10), stacktrace);
+        pop(vm);
         if (propagate_exception(vm)) {
           frame = &vm->frames[vm->frame_count - 1];
           break;
@@ -2309,14 +2884,16 @@ b_ptr_result run(b_vm *vm) {
       }
 
       case OP_TRY: {
-        b_obj_string *type = READ_STRING();
+        // a try without catch has no type constant to read.
+        uint16_t type = READ_SHORT();
         uint16_t address = READ_SHORT();
         uint16_t finally_address = READ_SHORT();
 
         if (address != 0) {
           b_value value;
-          if (!table_get(&vm->globals, OBJ_VAL(type), &value) || !IS_CLASS(value)) {
-            runtime_error("object of type '%s' is not an exception", type->chars);
+          b_value name = frame->closure->function->blob.constants.values[type];
+          if (!table_get(&vm->globals, name, &value) || !IS_CLASS(value)) {
+            runtime_error("object of type '%s' is not an exception", AS_STRING(name)->chars);
             break;
           }
           push_exception_handler(vm, AS_CLASS(value), address, finally_address);
@@ -2384,6 +2961,13 @@ b_ptr_result run(b_vm *vm) {
 #undef READ_LSTRING
 #undef BINARY_OP
 #undef BINARY_MOD_OP
+#undef IS_GLOBAL_SLOT
+#undef CACHE_GLOBAL_SLOT
+#undef QUICKEN
+#undef DEOPTIMIZE
+#undef IS_NUMBER_PAIR
+#undef NUMBER_OP
+#undef PEEK_SHORT
 }
 
 b_ptr_result interpret(b_vm *vm, b_obj_module *module, const char *source) {
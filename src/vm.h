@@ -6,6 +6,7 @@ typedef struct s_compiler b_compiler;
 #include "blob.h"
 #include "compiler.h"
 #include "config.h"
+#include "debug.h"
 #include "object.h"
 #include "table.h"
 #include "value.h"
@@ -19,6 +20,7 @@ typedef enum {
 typedef struct {
   uint16_t address;
   uint16_t finally_address;
+  int stack_depth; // stack slots in use by the frame when the try began
   b_obj_class *klass;
 } b_exception_frame;
 
@@ -26,28 +28,38 @@ typedef struct {
   b_obj_closure *closure;
   uint8_t *ip;
   b_value *slots;
+  int handlers_base; // index of the frame's first handler in vm->handlers
   int handlers_count;
-  b_exception_frame handlers[MAX_EXCEPTION_HANDLERS];
 } b_call_frame;
 
 struct s_vm {
-  b_call_frame frames[FRAMES_MAX];
+  b_call_frame *frames;
   int frame_count;
+  int frame_capacity;
 
   b_blob *blob;
   uint8_t *ip;
-  b_value stack[STACK_MAX];
+  b_value *stack;
   b_value *stack_top;
+  b_value *stack_end;
+  int stack_capacity;
   b_obj_up_value *open_up_values;
 
+  // exception handlers of all active frames, innermost last.
+  b_exception_frame *handlers;
+  int handlers_capacity;
+
   b_obj *objects;
   b_compiler *compiler;
   b_obj_class *exception_class;
+  int symbol_count; // method slots handed out so far
 
   // gc
   int gray_count;
   int gray_capacity;
   int gc_protected;
+  int gc_protected_capacity;
+  b_obj **gc_protected_objects; // values held by GC() in natives
   b_obj **gray_stack;
   size_t bytes_allocated;
   size_t next_gc;
@@ -65,6 +77,7 @@ struct s_vm {
   b_table methods_file;
   b_table methods_bytes;
   b_table methods_range;
+  b_table methods_set;
 
   char **std_args;
   int std_args_count;
@@ -75,6 +88,11 @@ struct s_vm {
   // for switching through the command line args...
   bool should_debug_stack;
   bool should_print_bytecode;
+  bool use_fused_locals;
+  bool use_jit;
+
+  // set when opcode sequences are being profiled.
+  b_op_profile *op_profile;
 };
 
 void init_vm(b_vm *vm);
@@ -128,6 +146,8 @@ void _runtime_error(b_vm *vm, const char *format, ...);
 
 b_obj_instance *create_exception(b_vm *vm, b_obj_string *message);
 
+b_value resolve_property(b_vm *vm, b_obj_instance *instance, b_value name, b_value value);
+
 #define EXIT_VM() return PTR_RUNTIME_ERR
 
 #define runtime_error(...)                                                     \
@@ -136,16 +156,19 @@ b_obj_instance *create_exception(b_vm *vm, b_obj_string *message);
   }
 
 
+void grow_gc_protection(b_vm *vm);
+
+// protected objects are kept off the value stack, so protecting them
+// never moves the stack under the args of the running native.
 static inline b_obj *gc_protect(b_vm *vm, b_obj *object) {
-  push(vm, OBJ_VAL(object));
-  vm->gc_protected++;
+  if (vm->gc_protected == vm->gc_protected_capacity) {
+    grow_gc_protection(vm);
+  }
+  vm->gc_protected_objects[vm->gc_protected++] = object;
   return object;
 }
 
 static inline void gc_clear_protection(b_vm *vm) {
-  if (vm->gc_protected > 0) {
-    vm->stack_top -= vm->gc_protected;
-  }
   vm->gc_protected = 0;
 }
 
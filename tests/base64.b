@@ -0,0 +1,71 @@
+import base64
+import _base64
+
+def same(a, b) {
+  if a == nil or a.length() != b.length() return false
+  iter var i = 0; i < a.length(); i++ {
+    if a[i] != b[i] return false
+  }
+  return true
+}
+
+# RFC 4648 test vectors
+var vectors = []
+for text in ['', 'f', 'fo', 'foo', 'foob', 'fooba', 'foobar'] {
+  vectors.append(base64.encode(text.to_bytes()))
+}
+echo vectors
+
+var odd = bytes([0xfb, 0xff, 0xbf, 0xfe])
+echo base64.encode(odd)
+echo base64.encode(odd, true)
+echo same(base64.decode('+/+//g=='), odd)
+echo same(base64.decode('-_-__g', true), odd)
+
+# long enough for the vector code, with every tail length
+var data = bytes(0)
+iter var i = 0; i < 300; i++ {
+  data.append((i * 73 + 11) % 256)
+}
+
+var ok = true
+iter var n = 250; n < 300; n++ {
+  var part = data[0, n]
+  if !same(base64.decode(base64.encode(part)), part) ok = false
+  if !same(base64.decode(base64.encode(part, true), true), part) ok = false
+}
+echo ok
+
+# chunks that split the groups anywhere, and MIME style lines
+var text = base64.encode(data)
+var encoder = base64.Encoder(), chunked = ''
+iter var i = 0; i < data.length(); i += 7 {
+  chunked += encoder.update(data[i, min(i + 7, data.length())])
+}
+echo chunked + encoder.finish() == text
+
+var lines = ''
+iter var i = 0; i < text.length(); i += 76 {
+  lines += text[i, min(i + 76, text.length())] + '\r\n'
+}
+
+var decoder = base64.Decoder(), decoded = bytes(0)
+iter var i = 0; i < lines.length(); i += 13 {
+  decoded.extend(decoder.update(lines[i, min(i + 13, lines.length())]))
+}
+decoded.extend(decoder.finish())
+echo same(decoded, data)
+
+# a single character cannot be decoded
+decoder.update('QUJD' + 'R')
+echo decoder.finish()
+
+# a coder state that shares its storage is copied before it is written
+var state_path = 'base64_state.bin'
+file(state_path, 'wb').write(bytes(4))
+var mapped = file(state_path, 'rb').mmap()
+echo _base64.encode_update(mapped, 'abcd') + _base64.encode_finish(mapped)
+mapped = file(state_path, 'rb').mmap()
+echo _base64.decode_update(mapped, 'YWJj').extend(_base64.decode_finish(mapped)).to_string()
+echo file(state_path, 'rb').read().to_list()
+file(state_path).delete()
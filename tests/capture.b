@@ -0,0 +1,70 @@
+# captured variables that are never reassigned are copied into the closure
+def adders() {
+  var result = []
+  iter var i = 0; i < 3; i++ {
+    var step = i * 10
+    result.append(|x| { return x + step })
+  }
+  return result
+}
+
+var fns = adders()
+echo [fns[0](1), fns[1](1), fns[2](1)]
+
+# assignments before the capture keep sharing the variable
+def counters() {
+  var result = []
+  var n = 0
+  while n < 3 {
+    n++
+    result.append(|| { return n })
+  }
+  return result
+}
+
+var cs = counters()
+echo [cs[0](), cs[1](), cs[2]()]
+
+# assignments from an inner closure are seen by every closure
+def shared() {
+  var count = 0
+  def inc() {
+    def bump() {
+      count++
+    }
+    bump()
+  }
+  def get() {
+    return count
+  }
+  inc()
+  inc()
+  return get()
+}
+
+echo shared()
+
+# copies are passed through nested closures
+def outer(a) {
+  var b = a * 2
+  def middle() {
+    def inner() {
+      return a + b
+    }
+    return inner
+  }
+  return middle()
+}
+
+echo outer(7)()
+
+# local recursive functions capture themselves
+def fib_of(n) {
+  def fib(x) {
+    if x < 2 return x
+    return fib(x - 1) + fib(x - 2)
+  }
+  return || { return fib(n) }
+}
+
+echo fib_of(20)()
@@ -0,0 +1,14 @@
+# classes that become garbage are freed without taking their name along
+def make(n) {
+  class Shortlived {
+    value() { return n }
+  }
+  return Shortlived()
+}
+
+var total = 0
+iter var i = 0; i < 20000; i++ {
+  total += make(i).value()
+  var filler = [i, '${i}', {}]
+}
+echo total
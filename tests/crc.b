@@ -0,0 +1,32 @@
+import hash
+
+echo hash.crc32('123456789')
+echo hash.crc32c('123456789')
+echo hash.crc32('')
+echo hash.crc32c(bytes(0))
+
+# long enough to take the folding and sse4.2 paths with
+# every possible unaligned start and tail length
+var text = ''
+iter var i = 0; i < 300; i++ {
+  text += chr(((i * 7) + 13) % 95 + 32)
+}
+
+# sums of the checksums of every slice, precomputed with zlib and a
+# bitwise crc32c implementation
+var crc32_sum = 0, crc32c_sum = 0
+iter var start = 0; start < 9; start++ {
+  iter var end = 250; end < 300; end += 7 {
+    var part = text[start, end]
+    crc32_sum += hash.crc32(part)
+    crc32c_sum += hash.crc32c(part)
+  }
+}
+echo crc32_sum
+echo crc32c_sum
+
+# a crc can be continued from a previous value
+var head = text[0, 100], tail = text[100, 300]
+echo hash.crc32(tail, hash.crc32(head)) == hash.crc32(text)
+echo hash.crc32c(tail, hash.crc32c(head)) == hash.crc32c(text)
+echo hash.crc32(text.to_bytes()) == hash.crc32(text)
@@ -0,0 +1,54 @@
+import _reflect
+
+# methods are dispatched through the class vtable once the class is sealed
+class Shape {
+  name() { return 'shape' }
+  describe() { return 'a ' + self.name() }
+  static unit() { return 'unit' }
+}
+
+class Square < Shape {
+  name() { return 'square' }
+  describe() { return parent.describe() + '!' }
+}
+
+class Plain < Shape {}
+
+var sq = Square()
+echo sq.describe()
+echo Plain().describe()
+echo Shape.unit()
+
+var bound = sq.name
+echo bound()
+
+# properties still shadow methods of the same name
+sq.name = || { return 'shadowed' }
+echo sq.name()
+
+# names new to a class reuse the slots other classes left free, so a
+# class declared after many methods still dispatches through its vtable
+class Filler {
+  f1() {} f2() {} f3() {} f4() {} f5() {} f6() {} f7() {} f8() {}
+  f9() {} f10() {} f11() {} f12() {} f13() {} f14() {} f15() {} f16() {}
+}
+
+class Far < Shape {
+  far() { return 'far' }
+}
+
+var far = Far()
+echo far.far()
+echo far.describe()
+echo _reflect.vtable_method(Far, 'far') and _reflect.vtable_method(Far, 'describe')
+
+# names that got the same slot in different classes cannot both sit in
+# the vtable of a class that has them both, so one of them answers from
+# the methods table
+class Left { left_only() { return 'left' } }
+class Right { right_only() { return 'right' } }
+class Both < Left { right_only() { return 'both right' } }
+
+var both = Both()
+echo both.left_only() + ' ' + both.right_only()
+echo _reflect.vtable_method(Both, 'left_only') != _reflect.vtable_method(Both, 'right_only')
@@ -0,0 +1,55 @@
+import event { EventLoop }
+import socket { * }
+
+var loop = EventLoop()
+var order = []
+
+loop.set_timeout(|| { order.append('b') }, 20)
+loop.set_timeout(|| { order.append('a') }, 5)
+var cleared = loop.set_timeout(|| { order.append('x') }, 10)
+loop.clear_timer(cleared)
+
+var ticks = 0
+var interval = loop.set_interval(|| {
+  ticks++
+  if ticks == 3 loop.clear_timer(interval)
+}, 2)
+
+loop.run()
+echo order
+echo ticks
+
+var server = Socket()
+server.set_option(SO_REUSEADDR, true)
+server.bind(IP_LOCAL, 0)
+server.listen()
+var port = server.info().port
+
+loop.watch(server, |s| {
+  var conn = s.accept()
+  loop.watch(conn, |c| {
+    var data = c.receive()
+    if data {
+      c.send('echo:${data}')
+    } else {
+      loop.unwatch(c)
+      c.close()
+    }
+  })
+})
+
+var client = Socket()
+client.connect(IP_LOCAL, port)
+client.send('ping')
+
+loop.watch(client, |c| {
+  echo c.receive()
+  loop.unwatch(c)
+  c.close()
+  loop.stop()
+}, nil, true)
+
+loop.run()
+loop.unwatch(server)
+server.close()
+echo loop.close()
@@ -34,4 +34,105 @@ def sin(n) {
 }
 
 echo sin()
-echo 'Sin 10 = ${sin(10)}'
\ No newline at end of file
+echo 'Sin 10 = ${sin(10)}'
+def plus(a, b) {
+  return a + b
+}
+echo plus(1, 2)
+echo plus('a', 'b')
+echo plus(3, 4)
+
+def depth(n) {
+  if n == 0 return 0
+  return depth(n - 1) + 1
+}
+echo depth(100000)
+
+def count_with(n) {
+  var total = 0
+  var add = |x| {
+    total += x
+  }
+  def recurse(k) {
+    if k == 0 return
+    add(1)
+    recurse(k - 1)
+  }
+  recurse(n)
+  return total
+}
+echo count_with(50000)
+
+def collect(first, ...) {
+  __args__.append(first)
+  return __args__
+}
+echo collect(1)
+echo collect(1, 2, 3)
+
+def ignore(a, b, ...) {
+  return [a, b]
+}
+echo ignore(1, 2)
+echo ignore(1, 2, 3, 4)
+
+def nested(...) {
+  return || {
+    return __args__.length()
+  }
+}
+echo nested(5, 6, 7)()
+
+def mix(a, b) {
+  return a + b
+}
+def below(v) {
+  if v < 3 return 'yes'
+  return 'no'
+}
+def field(p) {
+  return p.name
+}
+class Named {
+  var name = 'inst'
+}
+echo mix(1, 2)
+echo mix('x', 'y')
+echo below(1)
+echo below(5)
+echo field(Named())
+echo field({name: 'dict'})
+
+# tail calls reuse the caller's frame
+def count_to(n, acc) {
+  if n == 0 return acc
+  return count_to(n - 1, acc + 1)
+}
+class Walker {
+  step(n) {
+    if n == 0 return 'walked'
+    return self.step(n - 1)
+  }
+}
+def bump(n) {
+  n = n + 1
+  var f = || { return n }
+  return call_it(f)
+}
+def call_it(f) {
+  return f()
+}
+def guarded() {
+  try {
+    return fails()
+  } catch Exception e {
+    return 'caught ${e.message}'
+  }
+}
+def fails() {
+  die Exception('here')
+}
+echo count_to(1000000, 0)
+echo Walker().step(100000)
+echo bump(41)
+echo guarded()
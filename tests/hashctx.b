@@ -0,0 +1,74 @@
+import hash
+import _hash
+
+var text = ''
+iter var i = 0; i < 1000; i++ {
+  text += chr(((i * 31) + 7) % 95 + 32)
+}
+
+var functions = {
+  adler32: [hash.adler32, hash.adler32_file],
+  crc32: [hash.crc32, hash.crc32_file],
+  crc32c: [hash.crc32c, hash.crc32c_file],
+  md2: [hash.md2, hash.md2_file],
+  md4: [hash.md4, hash.md4_file],
+  md5: [hash.md5, hash.md5_file],
+  sha1: [hash.sha1, hash.sha1_file],
+  sha224: [hash.sha224, hash.sha224_file],
+  sha256: [hash.sha256, hash.sha256_file],
+  sha384: [hash.sha384, hash.sha384_file],
+  sha512: [hash.sha512, hash.sha512_file],
+  fnv1: [hash.fnv1, hash.fnv1_file],
+  fnv1a: [hash.fnv1a, hash.fnv1a_file],
+  fnv1_64: [hash.fnv1_64, hash.fnv1_64_file],
+  fnv1a_64: [hash.fnv1a_64, hash.fnv1a_64_file],
+  whirlpool: [hash.whirlpool, hash.whirlpool_file],
+  snefru: [hash.snefru, hash.snefru_file],
+  gost: [hash.gost, hash.gost_file],
+}
+
+# feed the data in pieces of odd sizes that cross block boundaries
+var path = 'hashctx_test.txt'
+var f = file(path, 'w')
+f.write(text)
+f.close()
+
+var failed = []
+for name, fns in functions {
+  var fn = fns[0], file_fn = fns[1]
+  var ctx = hash.HashContext(name, nil)
+  var at = 0, size = 1
+  while at < text.length() {
+    ctx.update(text[at, min(at + size, text.length())])
+    at += size
+    size = size * 3 + 1
+  }
+  var expected = fn(text)
+  if ctx.digest() != expected or ctx.digest() != expected failed.append(name)
+  if hash.HashContext(name, nil).digest() != fn('') failed.append(name + ' empty')
+  if file_fn(file(path)) != expected failed.append(name + ' file')
+}
+echo failed
+
+# digest() does not end the context and copy() forks it
+var ctx = hash.sha256_ctx().update('hello, ')
+var fork = ctx.copy()
+echo ctx.digest() == hash.sha256('hello, ')
+echo ctx.update('world').digest() == hash.sha256('hello, world')
+echo fork.update(bytes([119, 111, 114, 108, 100])).digest() == hash.sha256('hello, world')
+
+var key = 'secret'
+var sip = hash.siphash_ctx(key).update(text[0, 13]).update(text[13, 1000])
+echo sip.digest() == hash.siphash(key, text)
+echo hash.siphash_file(key, file(path)) == hash.siphash(key, text)
+echo hash.md5_file(file(path)) == hash.md5(text)
+echo hash.crc32_file(file(path)) == hash.crc32(text)
+
+file(path).delete()
+
+# the state of a context is native data that scripts cannot change
+var state = _hash.new_context('sha256')
+echo typeof(state)
+_hash.update_context(state, 'abc')
+echo _hash.context_digest(state) == hash.sha256('abc')
+_hash.update_context(bytes(40), 'abc')
@@ -0,0 +1,100 @@
+def sum(n) {
+  var total = 0
+  iter var i = 0; i < n; i++ {
+    total += i * 2 - 1
+  }
+  return total
+}
+
+echo sum(100000)
+
+def sieve(n) {
+  var flags = [true] * (n + 1)
+  var count = 0
+  iter var i = 2; i <= n; i++ {
+    if flags[i] {
+      count++
+      iter var j = i * 2; j <= n; j += i {
+        flags[j] = false
+      }
+    }
+  }
+  return count
+}
+
+echo sieve(100000)
+
+# values the machine code does not handle go back to the interpreter
+def change_type(n) {
+  var a = 1
+  iter var i = 0; i < n; i++ {
+    if i == n - 3 a = 'x'
+    a = a + 1
+  }
+  return a
+}
+
+echo change_type(3000)
+
+def operators(n) {
+  var r = 0, k = -1
+  iter var i = 0; i < n; i++ {
+    r = -r + i / 4 - (i ** 2) % 11 + (i & 3) + (i | 1) + (i ^ 5) + (i << 1) + (i >> 1)
+    if i > 10 and k < 0 k = i
+  }
+  return [r, k]
+}
+
+echo operators(5000)
+
+def counters(n) {
+  var l = [0] * 10
+  iter var i = 0; i < n; i++ {
+    l[i % 10]++
+    l[-1] = l[0] == l[1] ? l[0] : -1
+  }
+  return l
+}
+
+echo counters(20005)
+
+def nan_compare(n) {
+  var nan = 0 / 0, c = 0
+  iter var i = 0; i < n; i++ {
+    if nan < i c++
+    if nan > i c++
+    if nan == nan c++
+    if !(i != i) c++
+  }
+  return c
+}
+
+echo nan_compare(3000)
+
+# fields and module variables are read and written by the machine code,
+# anything else about them is left to the interpreter
+class Point {
+  Point(x) {
+    self.x = x
+  }
+
+  advance(n) {
+    iter var i = 0; i < n; i++ {
+      self.x = self.x + 2
+    }
+    return self.x
+  }
+}
+
+var points = [Point(0), Point(1)]
+
+def move(n) {
+  iter var i = 0; i < n; i++ {
+    var p = points[i % 2]
+    p.x = p.x + 1
+    if i == n - 1 p.y = i
+  }
+  return [points[0].x, points[1].x, points[1].y, points[0].advance(n)]
+}
+
+echo move(3000)
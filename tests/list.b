@@ -28,4 +28,28 @@ var list2 = [
 ]
 
 echo list2[0][2]++
-echo list2
\ No newline at end of file
+echo list2
+var queue = [1, 2, 3, 4, 5]
+queue.insert(0, 0)
+echo queue.shift()
+echo queue.shift(2)
+queue.append(6)
+echo queue
+
+var numbers = []
+for i in 0..100 {
+  numbers.append(i)
+}
+var window = numbers[10, 60]
+numbers[10] = 'changed'
+window[1] = 'changed'
+echo '${window[0]} ${numbers[11]} ${window.length()}'
+
+# sorting a list of views leaves the lists they came from in order
+var descending = []
+iter var i = 40; i > 0; i-- {
+  descending.append(i)
+}
+var views = [descending[0, 35], descending[5, 40]]
+views.sort()
+echo '${descending[0]} ${descending[39]} ${views[0][0]} ${views[1][34]}'
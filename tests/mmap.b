@@ -0,0 +1,15 @@
+import io
+
+var path = 'mmap_test.txt'
+file(path, 'w').write('hello mapped world')
+
+var mapped = file(path).mmap(io.MMAP_SEQUENTIAL)
+echo mapped.length()
+echo mapped[6,12].to_string()
+
+# writes copy the bytes out of the mapping
+mapped[0] = 72
+echo mapped.to_string()
+echo file(path).read()
+
+file(path).delete()
@@ -40,4 +40,10 @@ echo 'Time taken for recursive fibonacci: ${time() - start}s'
 
 start = time()
 echo fib2(60)
-echo 'Time taken for non-recursive fibonacci: ${time() - start}s'
\ No newline at end of file
+echo 'Time taken for non-recursive fibonacci: ${time() - start}s'
+# natives that protect more values with GC() than the stack has room
+# for must still return into their own slot
+var s = 'ab' * 400
+var matches = s.matches('/a(b)/')
+echo matches[0].length()
+echo matches[1][399]
@@ -0,0 +1,28 @@
+var path = 'readline_test.txt'
+file(path, 'w').write('alpha\nbeta\r\n\ngamma')
+
+var f = file(path)
+echo f.read_line()
+echo f.read_line()
+echo '[${f.read_line()}]'
+echo f.read_line()
+echo f.read_line()
+f.close()
+
+for i, line in file(path) {
+  echo '${i}:${line}'
+}
+
+var chunks = file(path)
+echo chunks.read(3)
+echo chunks.tell()
+echo chunks.read_line()
+echo chunks.read()
+
+# reads longer than the file only allocate what is left of it
+var rest = file(path)
+rest.read(3)
+echo rest.read(100000000000).length()
+echo rest.read(100000000000)
+
+file(path).delete()
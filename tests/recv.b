@@ -0,0 +1,38 @@
+import socket { * }
+
+var server = Socket()
+server.set_option(SO_REUSEADDR, true)
+server.bind(IP_LOCAL, 0)
+server.listen()
+var port = server.info().port
+
+var client = Socket()
+client.connect(IP_LOCAL, port)
+var conn = server.accept()
+
+conn.send(bytes([0, 1, 2, 255]))
+var data = client.receive_bytes()
+echo is_bytes(data)
+echo data.length()
+echo data[3]
+
+var buffer = bytes([46, 46, 46, 46, 46, 46, 46, 46])
+conn.send('abcdef')
+echo client.receive_into(buffer, 2, 4)
+echo buffer.to_string()
+echo client.receive(2)
+
+# exact reads wait for the bytes still to come
+conn.send('1')
+conn.send('2')
+echo client.receive_into(buffer, 0, 2, MSG_WAITALL)
+echo buffer.to_string()
+conn.send('345')
+conn.send('67890')
+echo client.receive_bytes(6, MSG_WAITALL).to_string()
+echo client.receive(2)
+
+conn.close()
+echo client.receive_into(buffer)
+client.close()
+server.close()
@@ -0,0 +1,41 @@
+def arith(a, b) {
+  var x = 0, y
+  x = a + b
+  x = x * b
+  x = x - a
+  x = x / 2
+  y = x
+  y += 10
+  y++
+  return [x, y]
+}
+
+echo arith(3, 4)
+
+# non-numeric operands take the generic path
+def join(a, b) {
+  var s = ''
+  s = a + b
+  s += '!'
+  return s
+}
+
+echo join('reg', 'ister')
+
+def concat(a, b) {
+  var l = []
+  l = a + b
+  return l
+}
+
+echo concat([1], [2])
+
+def sum(n) {
+  var total = 0
+  iter var i = 0; i < n; i++ {
+    total = total + i
+  }
+  return total
+}
+
+echo sum(1000)
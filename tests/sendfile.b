@@ -0,0 +1,35 @@
+import socket { * }
+import io
+
+var path = 'sendfile_test.txt'
+file(path, 'w').write('0123456789abcdefghij')
+
+var server = Socket()
+server.set_option(SO_REUSEADDR, true)
+server.bind(IP_LOCAL, 0)
+server.listen()
+var port = server.info().port
+
+var client = Socket()
+client.connect(IP_LOCAL, port)
+var conn = server.accept()
+
+echo conn.send_file(file(path))
+echo client.receive()
+echo conn.send_file(file(path), 10, 6)
+echo client.receive()
+echo conn.send(file(path))
+echo client.receive()
+
+# writes the file still buffers go out with it
+var pending = file(path, 'a')
+pending.set_buffer(io.BUFFER_FULL)
+pending.write('klmno')
+echo conn.send_file(pending, 18)
+echo client.receive()
+pending.close()
+
+conn.close()
+client.close()
+server.close()
+file(path).delete()
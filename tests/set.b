@@ -0,0 +1,33 @@
+var items = [3, 1, 3, 'a', nil, 1, 'a', nil, 2]
+echo items.unique()
+
+# -0 equals 0, so it is not kept as a value of its own
+echo [0, -0].unique()
+echo [0, -0].to_set().length()
+
+var seen = items.compact().to_set()
+echo seen.length()
+echo seen.contains('a')
+echo seen.add(1)
+echo seen.add(4)
+seen.remove(3)
+echo seen.contains(3)
+echo seen.length()
+
+var a = set([1, 2, 3, 4])
+var b = set([3, 4, 5])
+echo a.union(b).length()
+echo a.intersect(b) == set([4, 3])
+echo a.difference(b) == set([1, 2])
+echo set([3]).is_subset(b)
+echo a.is_subset(b)
+echo a == a.clone()
+
+var total = 0
+for x in a {
+  total += x
+}
+echo total
+
+# like lists and dicts, a set is false when it is empty
+echo !set() and set([1]) ? 'empty is false' : 'wrong'
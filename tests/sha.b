@@ -0,0 +1,29 @@
+import hash
+
+echo hash.sha1('abc')
+echo hash.sha256('abc')
+
+# several blocks, so whole blocks are compressed straight from the input
+var block = ''
+iter var i = 0; i < 1000; i++ {
+  block += chr(i % 95 + 32)
+}
+echo hash.sha1(block)
+echo hash.sha256(block)
+
+echo hash.hmac_sha256('key', 'The quick brown fox jumps over the lazy dog')
+echo hash.hmac_sha1('key', 'The quick brown fox jumps over the lazy dog')
+
+# more messages than a multi-buffer batch holds, with lengths that
+# cross the padding boundaries
+var messages = ['', bytes(0)]
+iter var i = 0; i < 130; i += 11 {
+  messages.append(block[0, i])
+}
+
+var many = hash.sha256_many(messages), same = true
+iter var i = 0; i < messages.length(); i++ {
+  if many[i] != hash.sha256(messages[i]) same = false
+}
+echo many.length()
+echo same
@@ -0,0 +1,13 @@
+# importing socket must not fail on the platform lookup
+import socket { Socket, IP_LOCAL, SO_REUSEADDR }
+
+var server = Socket()
+server.set_option(SO_REUSEADDR, true)
+server.bind(IP_LOCAL, 0)
+server.listen()
+echo server.is_listening
+
+# binding to port 0 takes any free port
+echo server.info().port > 0
+server.close()
+echo server.is_closed
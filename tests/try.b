@@ -33,6 +33,51 @@ try {
   echo 'Exception trace: ${e.stacktrace}'
 }
 
+def fail(n) {
+  if n == 0 die Exception('failed')
+  return fail(n - 1)
+}
+
+var caught = 0
+iter var i = 0; i < 5000; i++ {
+  try {
+    fail(3)
+  } catch Exception e {
+    caught++
+  }
+}
+echo 'caught ${caught}'
+
+try {
+  fail(1)
+} catch Exception e {
+  echo getprop(e, 'stacktrace') == e.stacktrace
+}
+
+# locals of the try body do not take the slot of the catch variable
+iter var x = 0; x < 3; x++ {
+  try {
+    var c = 5
+    die Exception('boom ${x}')
+  } catch Exception e {
+    echo e.message
+  }
+}
+
+def captured() {
+  var saved
+  try {
+    var count = 5
+    count++
+    saved = || { return count }
+    die Exception('boom')
+  } catch Exception e {
+    var other = e
+    return saved()
+  }
+}
+echo captured()
+
 try {
   echo '\nTry block called'
 } finally {
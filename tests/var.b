@@ -5,4 +5,18 @@ var b = 20
 echo b
 
 var c = true
-echo c
\ No newline at end of file
+echo c
+var counter = 0
+def bump() {
+  counter += 1
+}
+bump()
+var d = 1
+var e = 2
+var f = 3
+var g = 4
+var h = 5
+var i = 6
+var j = 7
+bump()
+echo counter
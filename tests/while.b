@@ -11,4 +11,21 @@ while x >= 0 {
   if x == 50 break
   echo 'x = ${x}'
   x = x - 1
-}
\ No newline at end of file
+}
+# break must only discard the locals declared inside the loop
+def find(limit) {
+  var found = 7
+  if limit > 0 {
+    var i = 0
+    while true {
+      var next = i + 1
+      if next >= limit break
+      i = next
+    }
+  }
+  var after = 9
+  return '${found} ${after}'
+}
+
+var kept = 1
+echo 'kept ${find(3)} ${kept}'
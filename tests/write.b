@@ -0,0 +1,48 @@
+import io
+
+var path = 'write_test.txt'
+
+var f = file(path, 'w')
+f.set_buffer(io.BUFFER_FULL, 1024)
+f.write('one\n')
+f.write('')
+echo file(path).read().length()
+f.flush()
+echo file(path).read()
+f.write_all(['two\n', 'three\n'])
+echo f.tell()
+f.write('four\n')
+f.close()
+echo file(path).read()
+
+var g = file(path, 'a')
+echo g.write_all(['five', '\n'])
+echo file(path).read().split('\n').length()
+
+var b = file(path, 'wb')
+b.set_buffer(io.BUFFER_LINE)
+b.write_all([bytes([104, 105]), bytes(0), bytes([10])])
+b.close()
+echo file(path).read()
+
+# a buffer set once the file is in use takes over where it stopped
+var w = file(path, 'w')
+w.set_buffer(io.BUFFER_FULL)
+w.write('abc')
+w.set_buffer(io.BUFFER_LINE)
+w.write('def\n')
+w.close()
+echo file(path).read()
+
+var r = file(path)
+echo r.read(2)
+r.set_buffer(io.BUFFER_FULL)
+echo r.read()
+r.close()
+
+# an empty write closes the file like any other write
+var e = file(path, 'w')
+e.write('')
+echo e.is_open()
+
+file(path).delete()